@@ -0,0 +1,315 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "benchmark_data.hpp"
+#include "app.hpp"
+#include "cram_reader.hpp"
+#include "sa_tag_scanner.hpp"
+#include "synthetic_data.hpp"
+#include "htslib/sam.h"
+#include "htslib/thread_pool.h"
+
+namespace fs = std::filesystem;
+
+/************************************************************
+ * Count heap allocations to report allocations per record. *
+ ***********************************************************/
+static std::atomic<int64_t> n_heap_allocs{0};
+
+void* operator new(std::size_t size){
+  n_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+  if(void* ptr = std::malloc(size ? size : 1)){
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Report average heap allocations per record since start_count, for records_per_iteration each iteration.
+static void report_allocs(benchmark::State& state, const int64_t start_count, const int64_t records_per_iteration = 1){
+  state.counters["allocs_per_record"] = benchmark::Counter(
+      static_cast<double>(n_heap_allocs.load() - start_count) / records_per_iteration,
+      benchmark::Counter::kAvgIterations);
+}
+
+/*
+ * Write a BGZF compressed BAM of the records in the committed test SAM repeated copies times.
+ * Copies are not coordinate sorted, which does not matter for sequential reads.
+ * Existing output is reused between benchmark runs.
+ */
+std::string inflate_sam_to_bam(const std::string& sample_name, const int copies){
+  fs::path sam_path{fs::path{CRAM_SUMM_TEST_DATA_DIR} / (sample_name + ".sam")};
+  fs::path bam_path{fs::path{BENCHMARK_SCRATCH_DIR} / (sample_name + "_x" + std::to_string(copies) + ".bam")};
+
+  if(fs::is_regular_file(bam_path)){
+    return bam_path.string();
+  }
+
+  htsFile* infile{sam_open(sam_path.c_str(), "r")};
+  if(!infile){
+    throw std::runtime_error(std::string("Failed to open: ") + sam_path.string());
+  }
+  sam_hdr_t* header{sam_hdr_read(infile)};
+
+  std::vector<bam1_t*> records{};
+  bam1_t* record{bam_init1()};
+  while(sam_read1(infile, header, record) >= 0){
+    records.push_back(record);
+    record = bam_init1();
+  }
+  bam_destroy1(record);
+
+  htsFile* outfile{sam_open(bam_path.c_str(), "wb")};
+  if(!outfile || sam_hdr_write(outfile, header) < 0){
+    throw std::runtime_error(std::string("Failed to write: ") + bam_path.string());
+  }
+  for(int copy{0}; copy < copies; copy++){
+    for(bam1_t* rec : records){
+      sam_write1(outfile, header, rec);
+    }
+  }
+
+  hts_close(outfile);
+  for(bam1_t* rec : records){
+    bam_destroy1(rec);
+  }
+  sam_hdr_destroy(header);
+  hts_close(infile);
+
+  return bam_path.string();
+}
+
+/****************************************************
+ * Records per second scaling with shared pool size *
+ ***************************************************/
+static void BM_NextAlignmentThreads(benchmark::State& state, const std::string& sample_name, const int copies){
+  const std::string bam_path{inflate_sam_to_bam(sample_name, copies)};
+  const int n_threads{static_cast<int>(state.range(0))};
+
+  // One worker is no better than decoding on the main thread.
+  htsThreadPool pool{n_threads > 1 ? hts_tpool_init(n_threads) : nullptr, 0};
+  int64_t n_records{0};
+
+  for(auto _ : state){
+    AlignmentReader reader{bam_path, ""};
+    reader.attach_thread_pool(pool.pool ? &pool : nullptr);
+    while(reader.next_alignment()){ n_records++; }
+  }
+
+  state.SetItemsProcessed(n_records);
+  state.counters["threads"] = n_threads;
+
+  if(pool.pool){
+    hts_tpool_destroy(pool.pool);
+  }
+}
+BENCHMARK_CAPTURE(BM_NextAlignmentThreads, dup_1, std::string("dup_1_sample_1"), 300)
+  ->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_NextAlignmentThreads, del_1, std::string("del_1_sample_1"), 10000)
+  ->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/************************
+ * CIGAR reference span *
+ ***********************/
+constexpr std::string_view BENCH_CIGAR{"20S30M2I40M5D10N6X38H"};
+
+static void BM_CigarSpanTokenized(benchmark::State& state){
+  int64_t start_count{n_heap_allocs.load()};
+  for(auto _ : state){
+    std::vector<std::pair<int, char>> tokens{AlignmentReader::tokenize_cigar(BENCH_CIGAR)};
+    benchmark::DoNotOptimize(AlignmentReader::reference_span_from_tokens(tokens));
+  }
+  report_allocs(state, start_count);
+}
+BENCHMARK(BM_CigarSpanTokenized);
+
+static void BM_CigarSpanView(benchmark::State& state){
+  int64_t start_count{n_heap_allocs.load()};
+  for(auto _ : state){
+    benchmark::DoNotOptimize(AlignmentReader::reference_span(BENCH_CIGAR));
+  }
+  report_allocs(state, start_count);
+}
+BENCHMARK(BM_CigarSpanView);
+
+static void BM_CigarSpanBinary(benchmark::State& state){
+  const uint32_t cigar[]{
+    bam_cigar_gen(20, BAM_CSOFT_CLIP), bam_cigar_gen(30, BAM_CMATCH), bam_cigar_gen(2, BAM_CINS),
+    bam_cigar_gen(40, BAM_CMATCH), bam_cigar_gen(5, BAM_CDEL), bam_cigar_gen(10, BAM_CREF_SKIP),
+    bam_cigar_gen(6, BAM_CDIFF), bam_cigar_gen(38, BAM_CHARD_CLIP)};
+
+  int64_t start_count{n_heap_allocs.load()};
+  for(auto _ : state){
+    benchmark::DoNotOptimize(AlignmentReader::reference_span(cigar, 8));
+  }
+  report_allocs(state, start_count);
+}
+BENCHMARK(BM_CigarSpanBinary);
+
+/******************
+ * SA tag parsing *
+ *****************/
+constexpr std::string_view BENCH_SA_TAG{
+  "chr1,50179101,+,50S101M,60,0;chr1,50186563,-,30M2D70M51S,20,3;chr5,1200345,+,120S31M,9,1;"};
+constexpr int64_t BENCH_SA_RECORDS{3};
+
+static void BM_SaParseRecords(benchmark::State& state){
+  int64_t start_count{n_heap_allocs.load()};
+  for(auto _ : state){
+    std::string_view remaining{BENCH_SA_TAG};
+    for(size_t delim{remaining.find(';')}; delim != std::string_view::npos; delim = remaining.find(';')){
+      std::vector<std::string_view> fields{parse_sa_record(remaining.substr(0, delim))};
+      benchmark::DoNotOptimize(AlignmentReader::reference_span(fields[3]));
+      remaining.remove_prefix(delim + 1);
+    }
+  }
+  report_allocs(state, start_count, BENCH_SA_RECORDS);
+}
+BENCHMARK(BM_SaParseRecords);
+
+static void BM_SaTagScanner(benchmark::State& state){
+  int64_t start_count{n_heap_allocs.load()};
+  for(auto _ : state){
+    SaTagScanner scanner{BENCH_SA_TAG};
+    SaRecord record{};
+    while(scanner.next(record)){
+      benchmark::DoNotOptimize(record.ref_span);
+    }
+  }
+  report_allocs(state, start_count, BENCH_SA_RECORDS);
+}
+BENCHMARK(BM_SaTagScanner);
+
+/**********************************
+ * Grouping alignments for output *
+ *********************************/
+// Pairs of alignments sharing a query name, as in a coordinate sorted file.
+static std::vector<SimpleAlignment> make_bench_alignments(const int n_pairs){
+  std::vector<SimpleAlignment> alignments{};
+  alignments.reserve(2 * n_pairs);
+  for(int i{0}; i < n_pairs; i++){
+    alignments.emplace_back("A00123:8:H7XXXDSXX:1:1101:" + std::to_string(i), "chr1", i, i + 150, true);
+  }
+  for(int i{0}; i < n_pairs; i++){
+    alignments.emplace_back("A00123:8:H7XXXDSXX:1:1101:" + std::to_string(i), "chr1", i + 400, i + 550, false);
+  }
+  return alignments;
+}
+
+static void BM_GroupJsonDocument(benchmark::State& state){
+  std::vector<SimpleAlignment> alignments{make_bench_alignments(state.range(0))};
+  int64_t start_count{n_heap_allocs.load()};
+
+  for(auto _ : state){
+    bj::object all_data{init_top_level_json()};
+    for(auto& sa : alignments){
+      add_alignment(all_data, sa, AlnType::PAIRED);
+    }
+    benchmark::DoNotOptimize(all_data);
+  }
+
+  state.SetItemsProcessed(state.iterations() * alignments.size());
+  state.counters["allocs_per_record"] = benchmark::Counter(
+      static_cast<double>(n_heap_allocs.load() - start_count) / alignments.size(),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GroupJsonDocument)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// As BM_GroupJsonDocument with the document built from an arena, including its teardown.
+static void BM_GroupJsonDocumentArena(benchmark::State& state){
+  std::vector<SimpleAlignment> alignments{make_bench_alignments(state.range(0))};
+  int64_t start_count{n_heap_allocs.load()};
+
+  for(auto _ : state){
+    bj::monotonic_resource arena{};
+    bj::object all_data{init_top_level_json(&arena)};
+    for(auto& sa : alignments){
+      add_alignment(all_data, sa, AlnType::PAIRED);
+    }
+    benchmark::DoNotOptimize(all_data);
+  }
+
+  state.SetItemsProcessed(state.iterations() * alignments.size());
+  state.counters["allocs_per_record"] = benchmark::Counter(
+      static_cast<double>(n_heap_allocs.load() - start_count) / alignments.size(),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GroupJsonDocumentArena)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_GroupAlignmentStore(benchmark::State& state){
+  std::vector<SimpleAlignment> alignments{make_bench_alignments(state.range(0))};
+  int64_t start_count{n_heap_allocs.load()};
+  size_t memory_usage{0};
+
+  for(auto _ : state){
+    AlignmentStore store{};
+    for(auto& sa : alignments){
+      store.add(sa, AlnType::PAIRED);
+    }
+    memory_usage = store.memory_usage();
+    benchmark::DoNotOptimize(store);
+  }
+
+  state.SetItemsProcessed(state.iterations() * alignments.size());
+  state.counters["allocs_per_record"] = benchmark::Counter(
+      static_cast<double>(n_heap_allocs.load() - start_count) / alignments.size(),
+      benchmark::Counter::kAvgIterations);
+  state.counters["bytes_per_alignment"] = static_cast<double>(memory_usage) / alignments.size();
+}
+BENCHMARK(BM_GroupAlignmentStore)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+/*******************************************
+ * Whole summary of synthetic BAM and CRAM *
+ ******************************************/
+// Write synthetic alignments with elevated split and discordant rates. Existing output is reused.
+static std::string synthetic_alignments(const std::string& extension){
+  fs::path out_path{fs::path{BENCHMARK_SCRATCH_DIR} / ("synthetic_alignments" + extension)};
+  if(!fs::is_regular_file(out_path)){
+    AlignmentSynthesis params{};
+    params.split_rate = 0.05;
+    params.discordant_rate = 0.05;
+    write_synthetic_alignments(out_path.string(), params);
+  }
+  return out_path.string();
+}
+
+static void BM_SummarizeSynthetic(benchmark::State& state, const std::string& extension){
+  const std::string path{synthetic_alignments(extension)};
+  const std::string ref_path{extension == ".cram" ? path + ".fa" : ""};
+  int64_t n_records{0};
+
+  for(auto _ : state){
+    AlignmentReader reader{path, ref_path};
+    AlignmentStore store{reader.get_contig_names()};
+    Accounting counts{};
+    summarize_records(reader, counts,
+        [&store](const AlignmentRecord& rec, const SaRecord* sa_record, AlnType aln_type){
+          if(sa_record){
+            store.add(rec.get_query_name_view(), *sa_record, aln_type);
+          } else {
+            store.add(rec, aln_type);
+          }
+        });
+    n_records += counts.total + counts.qc_fail + counts.unmapped + counts.duplicate + counts.bad_mapq;
+  }
+
+  state.SetItemsProcessed(n_records);
+}
+BENCHMARK_CAPTURE(BM_SummarizeSynthetic, bam, std::string(".bam"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SummarizeSynthetic, cram, std::string(".cram"))->Unit(benchmark::kMillisecond);
+
+// As BM_SummarizeSynthetic with --stats timing on, to compare its overhead. Stats stay enabled once on,
+//   so this is registered after every other benchmark in this file.
+static void BM_SummarizeSyntheticStats(benchmark::State& state, const std::string& extension){
+  RunStats::instance().enable();
+  BM_SummarizeSynthetic(state, extension);
+}
+BENCHMARK_CAPTURE(BM_SummarizeSyntheticStats, bam, std::string(".bam"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SummarizeSyntheticStats, cram, std::string(".cram"))->Unit(benchmark::kMillisecond);
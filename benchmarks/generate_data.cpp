@@ -0,0 +1,79 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "boost/program_options.hpp"
+#include "synthetic_data.hpp"
+
+namespace po = boost::program_options;
+
+/*
+ * Write synthetic inputs for benchmarking without access to real data.
+ *   gen_bench_data alignments OUT.bam|OUT.cram [OPTIONS]
+ *   gen_bench_data variants OUT.bcf|OUT.vcf.gz|OUT.vcf [OPTIONS]
+ */
+int main(const int argc, const char* argv[]){
+  std::string kind{};
+  std::string out_path{};
+  AlignmentSynthesis aln_params{};
+  VariantSynthesis var_params{};
+
+  po::options_description desc{"OPTIONS"};
+  po::options_description hidden{"Hidden positional options"};
+  po::options_description full_opts{"All options"};
+  po::positional_options_description pos_opts{};
+  po::variables_map vm{};
+
+  desc.add_options()
+      ("help,h", "Print usage and exit.")
+      ("seed", po::value(&aln_params.seed), "Seed for random data. Default 1.")
+      ("pairs", po::value(&aln_params.n_pairs), "alignments: Number of read pairs. Default 100000.")
+      ("contigs", po::value(&aln_params.n_contigs), "alignments: Number of contigs. Default 2.")
+      ("contig-length", po::value(&aln_params.contig_length), "alignments: Length of each contig. Default 10000000.")
+      ("read-length", po::value(&aln_params.read_length), "alignments: Read length. Default 150.")
+      ("insert-size", po::value(&aln_params.insert_size), "alignments: Insert size. Default 400.")
+      ("split-rate", po::value(&aln_params.split_rate), "alignments: Fraction of pairs with a split read. Default 0.01.")
+      ("discordant-rate", po::value(&aln_params.discordant_rate),
+        "alignments: Fraction of pairs with discordant mates. Default 0.01.")
+      ("samples", po::value(&var_params.n_samples), "variants: Number of samples. Default 1000.")
+      ("variants", po::value(&var_params.n_variants), "variants: Number of variants. Default 1000.")
+      ("het-freq", po::value(&var_params.het_freq), "variants: Frequency of het genotypes. Default 0.05.")
+      ("hom-freq", po::value(&var_params.hom_freq), "variants: Frequency of hom alt genotypes. Default 0.01.")
+      ("missing-freq", po::value(&var_params.missing_freq), "variants: Frequency of missing genotypes. Default 0.")
+  ;
+
+  hidden.add_options()
+      ("kind", po::value(&kind), "alignments or variants")
+      ("out", po::value(&out_path), "Output path")
+  ;
+
+  pos_opts.add("kind", 1);
+  pos_opts.add("out", 1);
+  full_opts.add(desc);
+  full_opts.add(hidden);
+
+  try{
+    po::store(po::command_line_parser{argc, argv}.options(full_opts).positional(pos_opts).run(), vm);
+    po::notify(vm);
+
+    if(vm.count("help") || out_path.empty() || (kind != "alignments" && kind != "variants")){
+      std::cout
+        << "Usage:" << "\n"
+        << "  gen_bench_data alignments OUT.bam|OUT.cram [OPTIONS]" << "\n"
+        << "  gen_bench_data variants OUT.bcf|OUT.vcf.gz|OUT.vcf [OPTIONS]" << "\n"
+        << desc << "\n";
+      return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(kind == "alignments"){
+      write_synthetic_alignments(out_path, aln_params);
+    } else {
+      var_params.seed = aln_params.seed;
+      write_synthetic_variants(out_path, var_params);
+    }
+  } catch(std::exception& ex){
+    std::cerr << "error: " << ex.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
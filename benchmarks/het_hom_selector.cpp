@@ -0,0 +1,302 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "benchmark_data.hpp"
+#include "app.hpp"
+#include "bcf_reader.hpp"
+#include "genotype_kernel.hpp"
+#include "het_hom_index.hpp"
+#include "synthetic_data.hpp"
+#include "htslib/vcf.h"
+
+namespace fs = std::filesystem;
+
+// Keep genotype count of each synthetic file near 20 million regardless of sample count.
+static constexpr int64_t GENOTYPES_PER_FILE{20000000};
+
+/* Write synthetic BCF of n_samples. Existing output is reused between benchmark runs. */
+static std::string synthetic_bcf(const int n_samples){
+  fs::path bcf_path{fs::path{BENCHMARK_SCRATCH_DIR} / ("synthetic_" + std::to_string(n_samples) + ".bcf")};
+  if(!fs::is_regular_file(bcf_path)){
+    VariantSynthesis params{};
+    params.n_samples = n_samples;
+    params.n_variants = std::max<int64_t>(20, GENOTYPES_PER_FILE / n_samples);
+    write_synthetic_variants(bcf_path.string(), params);
+  }
+  return bcf_path.string();
+}
+
+/********************************************
+ * Variants per second scaling with samples *
+ *******************************************/
+static void BM_NextVariant(benchmark::State& state){
+  const int n_samples{static_cast<int>(state.range(0))};
+  const std::string bcf_path{synthetic_bcf(n_samples)};
+  int64_t n_variants{0};
+
+  for(auto _ : state){
+    BcfReader reader{bcf_path};
+    while(reader.next_variant()){
+      benchmark::DoNotOptimize(reader.n_hets());
+      n_variants++;
+    }
+  }
+
+  state.SetItemsProcessed(n_variants);
+  state.counters["genotypes_per_second"] = benchmark::Counter(
+      static_cast<double>(n_variants) * n_samples, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_NextVariant)->Arg(1000)->Arg(10000)->Arg(200000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/****************************************
+ * Het/hom classification of GT vectors *
+ ***************************************/
+/* Diploid genotypes at the synthetic data default frequencies. */
+static std::vector<int32_t> synthetic_diploid_genotypes(const int n_samples){
+  std::mt19937_64 rng{1};
+  std::uniform_real_distribution<double> freq_dist{0.0, 1.0};
+
+  std::vector<int32_t> gt_data(2 * n_samples);
+  for(int sample_idx{0}; sample_idx < n_samples; sample_idx++){
+    double draw{freq_dist(rng)};
+    gt_data[2 * sample_idx] = bcf_gt_unphased(draw < 0.01 ? 1 : 0);
+    gt_data[2 * sample_idx + 1] = bcf_gt_unphased(draw < 0.06 ? 1 : 0);
+  }
+  return gt_data;
+}
+
+/* Per-allele loop BcfReader used before the genotype kernels. Baseline for comparison. */
+static void classify_genotypes_loop(const int32_t* gt_data, const int num_gt, const int num_samples,
+                                    std::vector<int>& het_idxs, std::vector<int>& hom_idxs){
+  int max_ploidy = num_gt / num_samples;
+
+  for(int sample_number=0; sample_number < num_samples; sample_number++){
+    int alt_count{0};
+    for(int allele_offset=0; allele_offset < max_ploidy; allele_offset++){
+      if(bcf_gt_allele(gt_data[sample_number * max_ploidy + allele_offset]) > 0){
+        alt_count++;
+      }
+    }
+
+    switch(alt_count){
+      case 2:
+        hom_idxs.insert(hom_idxs.end(), sample_number);
+        break;
+      case 1:
+        het_idxs.insert(het_idxs.end(), sample_number);
+        break;
+    }
+  }
+}
+
+static void BM_ClassifyGenotypesLoop(benchmark::State& state){
+  const int n_samples{static_cast<int>(state.range(0))};
+  const std::vector<int32_t> gt_data{synthetic_diploid_genotypes(n_samples)};
+
+  std::vector<int> het_idxs{};
+  std::vector<int> hom_idxs{};
+  het_idxs.reserve(n_samples);
+  hom_idxs.reserve(n_samples);
+
+  for(auto _ : state){
+    het_idxs.clear();
+    hom_idxs.clear();
+    classify_genotypes_loop(gt_data.data(), gt_data.size(), n_samples, het_idxs, hom_idxs);
+    benchmark::DoNotOptimize(het_idxs.data());
+    benchmark::DoNotOptimize(hom_idxs.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n_samples);
+}
+BENCHMARK(BM_ClassifyGenotypesLoop)->Arg(1000)->Arg(10000)->Arg(200000);
+
+/* Second arg selects kernel: 0 scalar, 1 SSE4, 2 AVX2 */
+static void BM_ClassifyGenotypes(benchmark::State& state){
+  const int n_samples{static_cast<int>(state.range(0))};
+  const GtKernel kernel{static_cast<GtKernel>(state.range(1))};
+  if(!is_gt_kernel_supported(kernel)){
+    state.SkipWithError("Kernel not supported by this CPU");
+    return;
+  }
+  const std::vector<int32_t> gt_data{synthetic_diploid_genotypes(n_samples)};
+
+  std::vector<int> het_idxs{};
+  std::vector<int> hom_idxs{};
+  het_idxs.reserve(n_samples);
+  hom_idxs.reserve(n_samples);
+
+  for(auto _ : state){
+    het_idxs.clear();
+    hom_idxs.clear();
+    classify_genotypes(gt_data.data(), gt_data.size(), n_samples, het_idxs, hom_idxs, kernel);
+    benchmark::DoNotOptimize(het_idxs.data());
+    benchmark::DoNotOptimize(hom_idxs.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n_samples);
+}
+BENCHMARK(BM_ClassifyGenotypes)
+  ->ArgNames({"samples", "kernel"})
+  ->ArgsProduct({{1000, 10000, 200000}, {static_cast<int>(GtKernel::SCALAR),
+                                         static_cast<int>(GtKernel::SSE4),
+                                         static_cast<int>(GtKernel::AVX2)}});
+
+/*********************************************************
+ * Picking 5 random hets and homs: lists vs count-locate *
+ ********************************************************/
+/* Second arg: 0 classifies into index lists then maps ranks, 1 counts then locates ranks */
+static void BM_SampleCarriers(benchmark::State& state){
+  const int n_samples{static_cast<int>(state.range(0))};
+  const bool is_count_locate{state.range(1) == 1};
+  const std::vector<int32_t> gt_data{synthetic_diploid_genotypes(n_samples)};
+  const GtKernel kernel{best_gt_kernel()};
+
+  std::vector<int> het_idxs{};
+  std::vector<int> hom_idxs{};
+  het_idxs.reserve(n_samples);
+  hom_idxs.reserve(n_samples);
+  std::vector<int> het_out{};
+  std::vector<int> hom_out{};
+
+  // Ranks spread over all carriers, as random picks are, so locating scans most of the vector.
+  classify_genotypes(gt_data.data(), gt_data.size(), n_samples, het_idxs, hom_idxs, kernel);
+  auto spread_ranks = [](const int n_carriers){
+    std::vector<int> ranks{};
+    for(int quarter{0}; quarter <= 4 && n_carriers > 0; quarter++){
+      ranks.push_back(std::min(n_carriers - 1, quarter * n_carriers / 4));
+    }
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    return ranks;
+  };
+  const std::vector<int> het_ranks{spread_ranks(het_idxs.size())};
+  const std::vector<int> hom_ranks{spread_ranks(hom_idxs.size())};
+
+  for(auto _ : state){
+    het_out.clear();
+    hom_out.clear();
+    if(is_count_locate){
+      int n_hets{0};
+      int n_homs{0};
+      count_genotypes(gt_data.data(), gt_data.size(), n_samples, n_hets, n_homs, kernel);
+      locate_genotypes(gt_data.data(), gt_data.size(), n_samples, het_ranks, hom_ranks, het_out, hom_out, kernel);
+    } else {
+      het_idxs.clear();
+      hom_idxs.clear();
+      classify_genotypes(gt_data.data(), gt_data.size(), n_samples, het_idxs, hom_idxs, kernel);
+      for(int rank : het_ranks){ het_out.push_back(het_idxs[rank]); }
+      for(int rank : hom_ranks){ hom_out.push_back(hom_idxs[rank]); }
+    }
+    benchmark::DoNotOptimize(het_out.data());
+    benchmark::DoNotOptimize(hom_out.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n_samples);
+}
+BENCHMARK(BM_SampleCarriers)
+  ->ArgNames({"samples", "count_locate"})
+  ->ArgsProduct({{1000, 10000, 200000}, {0, 1}});
+
+/*******************************************************
+ * Formatting all carriers: joined id copies vs buffer *
+ ******************************************************/
+/* Second arg: 0 copies ids and joins them as emit_selection used to, 1 appends from the name table */
+static void BM_EmitAllCarriers(benchmark::State& state){
+  const int n_samples{static_cast<int>(state.range(0))};
+  const bool is_buffered{state.range(1) == 1};
+  const std::string bcf_path{synthetic_bcf(n_samples)};
+  std::string out{};
+  out.reserve(TsvWriter::FLUSH_SIZE);
+  int64_t n_bytes{0};
+
+  auto join = [](const std::vector<std::string>& ids){
+    std::string joined{};
+    for(size_t i{0}; i < ids.size(); i++){
+      if(i > 0){ joined += ","; }
+      joined += ids[i];
+    }
+    return joined;
+  };
+
+  for(auto _ : state){
+    BcfReader reader{bcf_path};
+    while(reader.next_variant()){
+      out.clear();
+      if(is_buffered){
+        emit_selection(reader, reader.het_idxs(), reader.hom_idxs(), false, out);
+      } else {
+        std::ostringstream line{};
+        line << reader.chr() << '\t' << std::to_string(reader.pos()) << '\t'
+             << reader.ref() << '\t' << reader.alt() << '\t'
+             << join(reader.sample_idxs_to_ids(reader.hom_idxs())) << '\t'
+             << join(reader.sample_idxs_to_ids(reader.het_idxs())) << '\n';
+        out = line.str();
+      }
+      benchmark::DoNotOptimize(out.data());
+      n_bytes += out.size();
+    }
+  }
+
+  state.SetBytesProcessed(n_bytes);
+}
+BENCHMARK(BM_EmitAllCarriers)
+  ->ArgNames({"samples", "buffered"})
+  ->ArgsProduct({{1000, 200000}, {0, 1}})
+  ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/****************************************************
+ * Sampling 5 hets and homs: BCF vs het/hom index   *
+ ***************************************************/
+/* Second arg: 0 reads the BCF, 1 reads a het/hom index built from it once */
+static void BM_SampleFromIndex(benchmark::State& state){
+  const int n_samples{static_cast<int>(state.range(0))};
+  const bool is_index{state.range(1) == 1};
+  const std::string bcf_path{synthetic_bcf(n_samples)};
+  const std::string index_path{bcf_path + ".hhi"};
+
+  if(is_index && !fs::is_regular_file(index_path)){
+    BcfReader bcf{bcf_path};
+    HetHomIndexWriter index{index_path, bcf.sample_ids()};
+    while(bcf.next_variant()){
+      index.add(bcf.chr(), bcf.pos(), bcf.id(), bcf.ref(), bcf.alt(), bcf.het_idxs(), bcf.hom_idxs());
+    }
+    index.close();
+  }
+
+  AppControlData control{};
+  control.rng_mode = "counter";
+  control.num_rnd_samples = 5;
+  std::mt19937 gen{1};
+  std::string out{};
+  int64_t n_variants{0};
+
+  for(auto _ : state){
+    if(is_index){
+      HetHomIndexReader reader{index_path};
+      reader.set_collect_carriers(false);
+      while(reader.next_variant()){
+        out.clear();
+        select_variant(reader, control, gen, out);
+        n_variants++;
+      }
+    } else {
+      BcfReader reader{bcf_path};
+      reader.set_collect_carriers(false);
+      while(reader.next_variant()){
+        out.clear();
+        select_variant(reader, control, gen, out);
+        n_variants++;
+      }
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  state.SetItemsProcessed(n_variants);
+}
+BENCHMARK(BM_SampleFromIndex)
+  ->ArgNames({"samples", "index"})
+  ->ArgsProduct({{1000, 200000}, {0, 1}})
+  ->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "synthetic_data.hpp"
+#include "htslib/faidx.h"
+#include "htslib/hts.h"
+#include "htslib/sam.h"
+#include "htslib/vcf.h"
+
+// Distance beyond which a mate on the same contig is discordant.
+static constexpr int64_t DISCORDANT_DISTANCE{100000};
+static constexpr uint8_t MAPQ{60};
+static constexpr char BASE_QUALITY{30};
+
+static bool ends_with(std::string_view str, std::string_view suffix){
+  return str.size() >= suffix.size() && str.substr(str.size() - suffix.size()) == suffix;
+}
+
+static std::string contig_name(const int tid){
+  return "chr" + std::to_string(tid + 1);
+}
+
+/************************
+ * Synthetic Alignments *
+ ***********************/
+namespace {
+
+// Alignment kept until all records are generated and sorted.
+struct SynthRecord {
+  int64_t pair_idx{0};
+  int32_t tid{0};
+  int64_t pos{0};
+  uint16_t flag{0};
+  int32_t mtid{0};
+  int64_t mpos{0};
+  int64_t isize{0};
+  // 0: all matched, 1: matched then clipped (primary of split), 2: clipped then matched (supplementary)
+  int cigar_kind{0};
+  std::string sa_tag{};
+};
+
+} // namespace
+
+static std::vector<uint32_t> make_cigar(const int cigar_kind, const uint32_t read_length){
+  uint32_t half{read_length / 2};
+  switch(cigar_kind){
+    case 1:
+      return {bam_cigar_gen(half, BAM_CMATCH), bam_cigar_gen(read_length - half, BAM_CSOFT_CLIP)};
+    case 2:
+      return {bam_cigar_gen(half, BAM_CSOFT_CLIP), bam_cigar_gen(read_length - half, BAM_CMATCH)};
+    default:
+      return {bam_cigar_gen(read_length, BAM_CMATCH)};
+  }
+}
+
+static std::string sa_value(const int32_t tid, const int64_t pos, const std::string& cigar){
+  return contig_name(tid) + "," + std::to_string(pos + 1) + ",+," + cigar + "," + std::to_string(MAPQ) + ",0;";
+}
+
+static std::vector<std::string> make_reference(const AlignmentSynthesis& params, std::mt19937_64& rng){
+  constexpr std::string_view bases{"ACGT"};
+  std::uniform_int_distribution<int> base_dist{0, 3};
+  std::vector<std::string> contigs(params.n_contigs);
+
+  for(auto& contig : contigs){
+    contig.resize(params.contig_length);
+    for(auto& base : contig){
+      base = bases[base_dist(rng)];
+    }
+  }
+  return contigs;
+}
+
+static void write_fasta(const std::string& fasta_path, const std::vector<std::string>& contigs){
+  std::ofstream fasta{fasta_path};
+  for(size_t tid{0}; tid < contigs.size(); tid++){
+    fasta << ">" << contig_name(tid) << "\n";
+    for(size_t offset{0}; offset < contigs[tid].size(); offset += 60){
+      fasta << std::string_view{contigs[tid]}.substr(offset, 60) << "\n";
+    }
+  }
+  fasta.close();
+
+  if(!fasta || fai_build(fasta_path.c_str()) != 0){
+    throw std::runtime_error(std::string("Failed to write reference: ") + fasta_path);
+  }
+}
+
+static std::vector<SynthRecord> make_records(const AlignmentSynthesis& params, std::mt19937_64& rng){
+  const int64_t span{params.insert_size + params.read_length};
+  const int half{params.read_length / 2};
+  const std::string primary_cigar{std::to_string(half) + "M" + std::to_string(params.read_length - half) + "S"};
+  const std::string supplementary_cigar{std::to_string(half) + "S" + std::to_string(params.read_length - half) + "M"};
+
+  std::uniform_int_distribution<int32_t> tid_dist{0, params.n_contigs - 1};
+  std::uniform_int_distribution<int64_t> pos_dist{0, params.contig_length - span - 1};
+  std::uniform_int_distribution<int64_t> far_dist{DISCORDANT_DISTANCE, 10 * DISCORDANT_DISTANCE};
+  std::uniform_real_distribution<double> rate_dist{0.0, 1.0};
+
+  std::vector<SynthRecord> records{};
+  records.reserve(params.n_pairs * 2 * (1 + params.split_rate));
+
+  for(int64_t pair_idx{0}; pair_idx < params.n_pairs; pair_idx++){
+    SynthRecord read_1{pair_idx, tid_dist(rng), pos_dist(rng)};
+    SynthRecord read_2{read_1};
+
+    read_2.pos = read_1.pos + params.insert_size;
+    bool is_discordant{rate_dist(rng) < params.discordant_rate};
+    if(is_discordant){
+      if(params.n_contigs > 1){
+        read_2.tid = (read_1.tid + 1 + tid_dist(rng) % (params.n_contigs - 1)) % params.n_contigs;
+      } else {
+        read_2.pos = std::min(read_1.pos + far_dist(rng), params.contig_length - params.read_length - 1);
+      }
+    }
+
+    uint16_t pair_flags = BAM_FPAIRED | (is_discordant ? 0 : BAM_FPROPER_PAIR);
+    read_1.flag = pair_flags | BAM_FREAD1 | BAM_FMREVERSE;
+    read_2.flag = pair_flags | BAM_FREAD2 | BAM_FREVERSE;
+    read_1.mtid = read_2.tid;
+    read_1.mpos = read_2.pos;
+    read_2.mtid = read_1.tid;
+    read_2.mpos = read_1.pos;
+    if(!is_discordant){
+      read_1.isize = span;
+      read_2.isize = -span;
+    }
+
+    if(rate_dist(rng) < params.split_rate){
+      SynthRecord supplementary{read_1};
+      supplementary.tid = tid_dist(rng);
+      supplementary.pos = pos_dist(rng);
+      supplementary.flag = read_1.flag | BAM_FSUPPLEMENTARY;
+      supplementary.cigar_kind = 2;
+      supplementary.sa_tag = sa_value(read_1.tid, read_1.pos, primary_cigar);
+
+      read_1.cigar_kind = 1;
+      read_1.sa_tag = sa_value(supplementary.tid, supplementary.pos, supplementary_cigar);
+      records.push_back(supplementary);
+    }
+
+    records.push_back(read_1);
+    records.push_back(read_2);
+  }
+
+  std::stable_sort(records.begin(), records.end(), [](const SynthRecord& a, const SynthRecord& b){
+    return a.tid != b.tid ? a.tid < b.tid : a.pos < b.pos;
+  });
+  return records;
+}
+
+void write_synthetic_alignments(const std::string& out_path, const AlignmentSynthesis& params){
+  bool is_cram{ends_with(out_path, ".cram")};
+  if(!is_cram && !ends_with(out_path, ".bam")){
+    throw std::runtime_error(std::string("Alignment output must be .bam or .cram: ") + out_path);
+  }
+  if(params.n_contigs < 1 || params.contig_length < 2 * (params.insert_size + params.read_length) +
+      10 * DISCORDANT_DISTANCE){
+    throw std::runtime_error("Contigs are too few or too short for synthetic pairs.");
+  }
+
+  std::mt19937_64 rng{params.seed};
+  std::vector<std::string> contigs{make_reference(params, rng)};
+  std::vector<SynthRecord> records{make_records(params, rng)};
+
+  std::string header_text{"@HD\tVN:1.6\tSO:coordinate\n"};
+  for(size_t tid{0}; tid < contigs.size(); tid++){
+    header_text += "@SQ\tSN:" + contig_name(tid) + "\tLN:" + std::to_string(params.contig_length) + "\n";
+  }
+  sam_hdr_t* header{sam_hdr_init()};
+  sam_hdr_add_lines(header, header_text.c_str(), header_text.size());
+
+  htsFile* outfile{sam_open(out_path.c_str(), is_cram ? "wc" : "wb")};
+  if(is_cram && outfile){
+    std::string fasta_path{out_path + ".fa"};
+    write_fasta(fasta_path, contigs);
+    hts_set_fai_filename(outfile, fasta_path.c_str());
+  }
+  if(!outfile || sam_hdr_write(outfile, header) < 0){
+    sam_hdr_destroy(header);
+    throw std::runtime_error(std::string("Failed to write: ") + out_path);
+  }
+
+  const std::vector<char> qual(params.read_length, BASE_QUALITY);
+  bam1_t* alignment{bam_init1()};
+  int write_status{0};
+
+  for(auto& rec : records){
+    std::string qname{"SYN:" + std::to_string(rec.pair_idx)};
+    std::vector<uint32_t> cigar{make_cigar(rec.cigar_kind, params.read_length)};
+    const char* seq{contigs[rec.tid].data() + rec.pos};
+
+    write_status = bam_set1(alignment, qname.size(), qname.c_str(), rec.flag, rec.tid, rec.pos, MAPQ,
+                            cigar.size(), cigar.data(), rec.mtid, rec.mpos, rec.isize,
+                            params.read_length, seq, qual.data(), rec.sa_tag.empty() ? 0 : rec.sa_tag.size() + 4);
+    if(write_status >= 0 && !rec.sa_tag.empty()){
+      write_status = bam_aux_append(alignment, "SA", 'Z', rec.sa_tag.size() + 1,
+                                    reinterpret_cast<const uint8_t*>(rec.sa_tag.c_str()));
+    }
+    if(write_status < 0 || sam_write1(outfile, header, alignment) < 0){
+      break;
+    }
+  }
+
+  bam_destroy1(alignment);
+  sam_hdr_destroy(header);
+  int close_status{hts_close(outfile)};
+
+  if(write_status < 0 || close_status != 0 || sam_index_build(out_path.c_str(), 0) != 0){
+    throw std::runtime_error(std::string("Failed to write: ") + out_path);
+  }
+}
+
+/**********************
+ * Synthetic Variants *
+ *********************/
+void write_synthetic_variants(const std::string& out_path, const VariantSynthesis& params){
+  bool is_bcf{ends_with(out_path, ".bcf")};
+  bool is_bgzf{ends_with(out_path, ".vcf.gz")};
+
+  bcf_hdr_t* header{bcf_hdr_init("w")};
+  bcf_hdr_append(header, "##fileformat=VCFv4.2");
+  bcf_hdr_append(header, "##contig=<ID=chr1,length=248956422>");
+  bcf_hdr_append(header, "##ALT=<ID=DEL,Description=\"Deletion\">");
+  bcf_hdr_append(header, "##INFO=<ID=SVTYPE,Number=1,Type=String,Description=\"Type of structural variant\">");
+  bcf_hdr_append(header, "##INFO=<ID=SVLEN,Number=1,Type=Integer,Description=\"Length of structural variant\">");
+  bcf_hdr_append(header, "##INFO=<ID=END,Number=1,Type=Integer,Description=\"End position of variant\">");
+  bcf_hdr_append(header, "##INFO=<ID=AC,Number=A,Type=Integer,Description=\"Alternate allele count\">");
+  bcf_hdr_append(header, "##INFO=<ID=AN,Number=1,Type=Integer,Description=\"Total number of alleles\">");
+  bcf_hdr_append(header, "##INFO=<ID=AF,Number=A,Type=Float,Description=\"Alternate allele frequency\">");
+  bcf_hdr_append(header, "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">");
+
+  for(int sample_idx{0}; sample_idx < params.n_samples; sample_idx++){
+    std::string sample_id{std::to_string(sample_idx)};
+    sample_id = "SYN" + std::string(7 - std::min<size_t>(sample_id.size(), 7), '0') + sample_id;
+    bcf_hdr_add_sample(header, sample_id.c_str());
+  }
+  bcf_hdr_sync(header);
+
+  htsFile* outfile{bcf_open(out_path.c_str(), is_bcf ? "wb" : (is_bgzf ? "wz" : "w"))};
+  if(!outfile || bcf_hdr_write(outfile, header) != 0){
+    bcf_hdr_destroy(header);
+    throw std::runtime_error(std::string("Failed to write: ") + out_path);
+  }
+
+  std::mt19937_64 rng{params.seed};
+  std::uniform_real_distribution<double> freq_dist{0.0, 1.0};
+  std::vector<int32_t> genotypes(2 * params.n_samples);
+  bcf1_t* variant{bcf_init()};
+  int write_status{0};
+
+  for(int variant_idx{0}; variant_idx < params.n_variants && write_status == 0; variant_idx++){
+    int32_t allele_count{0};
+    int32_t allele_number{0};
+
+    for(int sample_idx{0}; sample_idx < params.n_samples; sample_idx++){
+      double draw{freq_dist(rng)};
+      int32_t* gt{&genotypes[2 * sample_idx]};
+
+      if(draw < params.missing_freq){
+        gt[0] = gt[1] = bcf_gt_missing;
+        continue;
+      }
+      draw -= params.missing_freq;
+
+      int n_alt{draw < params.hom_freq ? 2 : (draw < params.hom_freq + params.het_freq ? 1 : 0)};
+      gt[0] = bcf_gt_unphased(n_alt == 2 ? 1 : 0);
+      gt[1] = bcf_gt_unphased(n_alt > 0 ? 1 : 0);
+      allele_count += n_alt;
+      allele_number += 2;
+    }
+
+    int64_t pos{10000 + int64_t{variant_idx} * 1000};
+    int32_t sv_len{-500};
+    int32_t end{static_cast<int32_t>(pos + 500)};
+    float allele_freq{allele_number > 0 ? static_cast<float>(allele_count) / allele_number : 0.0f};
+    std::string variant_id{"SYN_DEL_" + std::to_string(variant_idx)};
+
+    bcf_clear(variant);
+    variant->rid = 0;
+    variant->pos = pos;
+    bcf_update_id(header, variant, variant_id.c_str());
+    bcf_update_alleles_str(header, variant, "N,<DEL>");
+    bcf_update_info_string(header, variant, "SVTYPE", "DEL");
+    bcf_update_info_int32(header, variant, "SVLEN", &sv_len, 1);
+    bcf_update_info_int32(header, variant, "END", &end, 1);
+    bcf_update_info_int32(header, variant, "AC", &allele_count, 1);
+    bcf_update_info_int32(header, variant, "AN", &allele_number, 1);
+    bcf_update_info_float(header, variant, "AF", &allele_freq, 1);
+    bcf_update_genotypes(header, variant, genotypes.data(), genotypes.size());
+
+    write_status = bcf_write(outfile, header, variant);
+  }
+
+  bcf_destroy(variant);
+  bcf_hdr_destroy(header);
+  int close_status{hts_close(outfile)};
+
+  if(write_status != 0 || close_status != 0 ||
+      ((is_bcf || is_bgzf) && bcf_index_build(out_path.c_str(), 14) != 0)){
+    throw std::runtime_error(std::string("Failed to write: ") + out_path);
+  }
+}
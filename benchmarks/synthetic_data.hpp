@@ -0,0 +1,49 @@
+#ifndef SYNTHETIC_DATA
+#define SYNTHETIC_DATA
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Parameters of synthetic paired end alignments.
+ * Reads are sequences of a random reference, so CRAM output compresses like real data.
+ */
+struct AlignmentSynthesis {
+  int64_t n_pairs{100000};
+  int n_contigs{2};
+  int64_t contig_length{10000000};
+  int read_length{150};
+  int64_t insert_size{400};
+  // Fraction of pairs whose first read is split, with an SA tag and a supplementary record.
+  double split_rate{0.01};
+  // Fraction of pairs whose mate maps to another contig or far from the expected insert size.
+  double discordant_rate{0.01};
+  uint64_t seed{1};
+};
+
+/**
+ * Parameters of synthetic biallelic deletions with diploid genotypes.
+ */
+struct VariantSynthesis {
+  int n_samples{1000};
+  int n_variants{1000};
+  double het_freq{0.05};
+  double hom_freq{0.01};
+  double missing_freq{0.0};
+  uint64_t seed{1};
+};
+
+/*
+ * Write coordinate sorted alignments and an index. Format follows extension: .bam or .cram
+ * CRAM output also writes its reference fasta and fai to out_path + ".fa".
+ * Throws runtime_error on write failure.
+ */
+void write_synthetic_alignments(const std::string& out_path, const AlignmentSynthesis& params);
+
+/*
+ * Write variants. Format follows extension: .bcf, .vcf.gz, or .vcf
+ * Throws runtime_error on write failure.
+ */
+void write_synthetic_variants(const std::string& out_path, const VariantSynthesis& params);
+
+#endif /* SYNTHETIC_DATA */
@@ -0,0 +1,116 @@
+#ifndef RUN_STATS
+#define RUN_STATS
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Stages of a run that time is attributed to. */
+enum Stage : int { OPEN, DECODE, FILTER, BUILD, EMIT, N_STAGES };
+
+/* Names of stages in stats output, in Stage order. */
+extern const std::array<const char*, N_STAGES> STAGE_NAMES;
+
+/* Wall and thread CPU nanoseconds spent in each stage. */
+struct StageTimes {
+  std::array<int64_t, N_STAGES> wall_ns{};
+  std::array<int64_t, N_STAGES> cpu_ns{};
+
+  StageTimes& operator+=(const StageTimes& other);
+};
+
+/**
+ * Process wide collection of stage times and counters for --stats.
+ * Each thread accumulates stage times in its own thread local counters, which are added to the
+ *   process totals when the thread exits. Nothing reads a clock until stats are enabled.
+ */
+class RunStats {
+  public:
+    static RunStats& instance();
+
+    RunStats(const RunStats&) = delete;
+    RunStats& operator=(const RunStats&) = delete;
+
+    /* Start timing the run, clearing times and counters of any earlier run.
+     * Call before starting worker threads.
+     */
+    void enable();
+    bool is_enabled() const;
+
+    /* Add records read and named counters. Called once per loop, not per record. */
+    void add_records(const int64_t n_records);
+    void add_count(const std::string& name, const int64_t count);
+
+    /* Add stage times of an exiting thread. */
+    void add_times(const StageTimes& times);
+
+    /* Write JSON of run wall and CPU time, peak RSS, bytes read, records per second, stage times,
+     *   and counters. Stage times are those of exited threads plus the calling thread.
+     * bytes_read is null where /proc/self/io is unavailable. Throws runtime_error if path cannot be written.
+     */
+    void write(const std::string& path, const std::string& tool, const std::string& input_path);
+
+  private:
+    RunStats() = default;
+
+    bool m_is_enabled{false};
+    int64_t m_start_ns{0};
+
+    std::mutex m_mutex{};
+    int64_t m_records{0};
+    StageTimes m_times{};
+    // Counters in order first added.
+    std::vector<std::pair<std::string, int64_t>> m_counts{};
+};
+
+/* Time one stage on the calling thread from construction to destruction.
+ * Use around coarse sections, such as opening input. Timers must not nest.
+ */
+class StageTimer {
+  public:
+    explicit StageTimer(const Stage stage);
+    ~StageTimer();
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+  private:
+    Stage m_stage{OPEN};
+    bool m_is_on{false};
+    int64_t m_wall_start{0};
+    int64_t m_cpu_start{0};
+};
+
+/**
+ * Attribute the time of a per-record loop on the calling thread to stages.
+ * The loop's total wall and CPU time is measured exactly. Every SAMPLE_INTERVAL-th record is lapped
+ *   with stage_lap() between stages, and the total is split between stages in proportion to the laps.
+ * Unsampled records read no clocks.
+ */
+class SampledLoop {
+  public:
+    static constexpr uint32_t SAMPLE_INTERVAL{64};
+
+    SampledLoop();
+    ~SampledLoop();
+
+    SampledLoop(const SampledLoop&) = delete;
+    SampledLoop& operator=(const SampledLoop&) = delete;
+
+    /* Call at the start of each record. */
+    void next_record();
+
+  private:
+    bool m_is_on{false};
+    uint32_t m_n_records{0};
+    int64_t m_wall_start{0};
+    int64_t m_cpu_start{0};
+};
+
+/* On a sampled record, attribute wall time since the previous lap to stage. No-op otherwise. */
+void stage_lap(const Stage stage);
+
+#endif /* RUN_STATS */
@@ -0,0 +1,236 @@
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <sys/resource.h>
+#include "run_stats.hpp"
+
+const std::array<const char*, N_STAGES> STAGE_NAMES{"open", "decode", "filter", "build", "emit"};
+
+StageTimes& StageTimes::operator+=(const StageTimes& other){
+  for(int stage{0}; stage < N_STAGES; stage++){
+    wall_ns[stage] += other.wall_ns[stage];
+    cpu_ns[stage] += other.cpu_ns[stage];
+  }
+  return *this;
+}
+
+static int64_t wall_now_ns(){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t thread_cpu_ns(){
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/* Stage times and lap state of one thread. Times are handed to RunStats when the thread exits. */
+struct ThreadStats {
+  StageTimes times{};
+
+  // Set while the current record of a SampledLoop is sampled.
+  bool is_lapping{false};
+  int64_t lap_start{0};
+  std::array<int64_t, N_STAGES> lap_ns{};
+
+  ~ThreadStats(){
+    if(RunStats::instance().is_enabled()){
+      RunStats::instance().add_times(times);
+    }
+  }
+};
+
+static thread_local ThreadStats thread_stats{};
+
+RunStats& RunStats::instance(){
+  static RunStats stats{};
+  return stats;
+}
+
+void RunStats::enable(){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_is_enabled = true;
+  m_start_ns = wall_now_ns();
+  m_records = 0;
+  m_times = StageTimes{};
+  m_counts.clear();
+  thread_stats.times = StageTimes{};
+}
+
+bool RunStats::is_enabled() const{
+  return m_is_enabled;
+}
+
+void RunStats::add_records(const int64_t n_records){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_records += n_records;
+}
+
+void RunStats::add_count(const std::string& name, const int64_t count){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  for(auto& [count_name, value] : m_counts){
+    if(count_name == name){
+      value += count;
+      return;
+    }
+  }
+  m_counts.emplace_back(name, count);
+}
+
+void RunStats::add_times(const StageTimes& times){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_times += times;
+}
+
+/* Bytes read by the process from /proc/self/io rchar, or -1 when unavailable. */
+static int64_t process_bytes_read(){
+  std::ifstream io{"/proc/self/io"};
+  std::string key{};
+  int64_t value{0};
+  while(io >> key >> value){
+    if(key == "rchar:"){ return value; }
+  }
+  return -1;
+}
+
+static void write_json_string(std::ostream& out, const std::string& text){
+  out << '"';
+  for(unsigned char c : text){
+    if(c == '"' || c == '\\'){
+      out << '\\' << c;
+    }else if(c < 0x20){
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    }else{
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+void RunStats::write(const std::string& path, const std::string& tool, const std::string& input_path){
+  const double wall_s{(wall_now_ns() - m_start_ns) / 1e9};
+
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  const double cpu_s{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                     (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6};
+  const int64_t bytes_read{process_bytes_read()};
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+  StageTimes times{m_times};
+  times += thread_stats.times;
+
+  std::ofstream out{path};
+  if(!out){
+    throw std::runtime_error(std::string("Failed to open stats file: ") + path);
+  }
+
+  out << std::fixed << std::setprecision(6) << "{\n  \"tool\": ";
+  write_json_string(out, tool);
+  out << ",\n  \"input\": ";
+  write_json_string(out, input_path);
+  out << ",\n  \"wall_s\": " << wall_s
+      << ",\n  \"cpu_s\": " << cpu_s
+      // Linux reports maximum resident set size in kilobytes.
+      << ",\n  \"peak_rss_kb\": " << usage.ru_maxrss
+      << ",\n  \"bytes_read\": ";
+  if(bytes_read < 0){
+    out << "null";
+  }else{
+    out << bytes_read;
+  }
+  out << ",\n  \"records\": " << m_records
+      << ",\n  \"records_per_sec\": " << (wall_s > 0 ? m_records / wall_s : 0.0)
+      << ",\n  \"stages\": {";
+  for(int stage{0}; stage < N_STAGES; stage++){
+    out << (stage > 0 ? "," : "") << "\n    \"" << STAGE_NAMES[stage] << "\": {\"wall_s\": "
+        << times.wall_ns[stage] / 1e9 << ", \"cpu_s\": " << times.cpu_ns[stage] / 1e9 << "}";
+  }
+  out << "\n  },\n  \"counts\": {";
+  for(size_t i{0}; i < m_counts.size(); i++){
+    out << (i > 0 ? "," : "") << "\n    ";
+    write_json_string(out, m_counts[i].first);
+    out << ": " << m_counts[i].second;
+  }
+  out << "\n  }\n}\n";
+
+  out.close();
+  if(!out){
+    throw std::runtime_error(std::string("Failed to write stats file: ") + path);
+  }
+}
+
+StageTimer::StageTimer(const Stage stage)
+  : m_stage{stage},
+    m_is_on{RunStats::instance().is_enabled()}
+{
+  if(m_is_on){
+    m_wall_start = wall_now_ns();
+    m_cpu_start = thread_cpu_ns();
+  }
+}
+
+StageTimer::~StageTimer(){
+  if(m_is_on){
+    thread_stats.times.wall_ns[m_stage] += wall_now_ns() - m_wall_start;
+    thread_stats.times.cpu_ns[m_stage] += thread_cpu_ns() - m_cpu_start;
+  }
+}
+
+SampledLoop::SampledLoop()
+  : m_is_on{RunStats::instance().is_enabled()}
+{
+  if(m_is_on){
+    m_wall_start = wall_now_ns();
+    m_cpu_start = thread_cpu_ns();
+    thread_stats.lap_ns.fill(0);
+  }
+}
+
+SampledLoop::~SampledLoop(){
+  if(!m_is_on){ return; }
+
+  thread_stats.is_lapping = false;
+  const int64_t wall_ns{wall_now_ns() - m_wall_start};
+  const int64_t cpu_ns{thread_cpu_ns() - m_cpu_start};
+
+  int64_t lapped_ns{0};
+  for(int64_t lap : thread_stats.lap_ns){ lapped_ns += lap; }
+
+  // A loop that read nothing spent its time looking for the first record.
+  if(lapped_ns == 0){
+    thread_stats.times.wall_ns[DECODE] += wall_ns;
+    thread_stats.times.cpu_ns[DECODE] += cpu_ns;
+    return;
+  }
+
+  for(int stage{0}; stage < N_STAGES; stage++){
+    double share{static_cast<double>(thread_stats.lap_ns[stage]) / lapped_ns};
+    thread_stats.times.wall_ns[stage] += static_cast<int64_t>(share * wall_ns);
+    thread_stats.times.cpu_ns[stage] += static_cast<int64_t>(share * cpu_ns);
+  }
+}
+
+void SampledLoop::next_record(){
+  if(!m_is_on){ return; }
+
+  // The first record is sampled so short loops are still split between stages.
+  thread_stats.is_lapping = m_n_records++ % SAMPLE_INTERVAL == 0;
+  if(thread_stats.is_lapping){
+    thread_stats.lap_start = wall_now_ns();
+  }
+}
+
+void stage_lap(const Stage stage){
+  if(!thread_stats.is_lapping){ return; }
+
+  int64_t now{wall_now_ns()};
+  thread_stats.lap_ns[stage] += now - thread_stats.lap_start;
+  thread_stats.lap_start = now;
+}
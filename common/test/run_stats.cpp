@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include "test_support.hpp"
+#include "run_stats.hpp"
+
+/* Seconds of a stage in stats JSON, or -1 if absent. */
+static double stage_wall_s(const std::string& json, const std::string& stage){
+  const std::string key{"\"" + stage + "\": {\"wall_s\": "};
+  size_t key_pos{json.find(key)};
+  if(key_pos == std::string::npos){ return -1; }
+  return std::stod(json.substr(key_pos + key.size()));
+}
+
+TEST(RunStats, SampledLoopSplitsTimeBetweenStages){
+  TestTempDir temp_dir{};
+  std::filesystem::path path{temp_dir.path("loop_stats.json")};
+  RunStats::instance().enable();
+
+  {
+    SampledLoop loop{};
+    for(int record{0}; record < 4 * SampledLoop::SAMPLE_INTERVAL; record++){
+      loop.next_record();
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      stage_lap(DECODE);
+      std::this_thread::sleep_for(std::chrono::microseconds(150));
+      stage_lap(EMIT);
+    }
+  }
+  {
+    StageTimer timer{OPEN};
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  RunStats::instance().add_records(256);
+  RunStats::instance().add_count("variants", 200);
+  RunStats::instance().add_count("variants", 56);
+  RunStats::instance().write(path.string(), "testing_app", "in.bcf");
+
+  std::string json{read_text(path)};
+  double decode_s{stage_wall_s(json, "decode")};
+  double emit_s{stage_wall_s(json, "emit")};
+  EXPECT_GT(decode_s, 0);
+  EXPECT_GT(emit_s, decode_s);
+  EXPECT_EQ(stage_wall_s(json, "filter"), 0);
+  EXPECT_GE(stage_wall_s(json, "open"), 0.005);
+  EXPECT_NE(json.find("\"records\": 256"), std::string::npos);
+  EXPECT_NE(json.find("\"variants\": 256"), std::string::npos);
+  EXPECT_NE(json.find("\"peak_rss_kb\": "), std::string::npos);
+}
+
+TEST(RunStats, EscapesStrings){
+  TestTempDir temp_dir{};
+  std::filesystem::path path{temp_dir.path("escaped_stats.json")};
+  RunStats::instance().enable();
+  RunStats::instance().add_count("quote\"count", 1);
+  RunStats::instance().write(path.string(), "testing_app", "dir\\in\n.bcf");
+
+  std::string json{read_text(path)};
+  EXPECT_NE(json.find("\"input\": \"dir\\\\in\\u000a.bcf\""), std::string::npos);
+  EXPECT_NE(json.find("\"quote\\\"count\": 1"), std::string::npos);
+}
@@ -0,0 +1,62 @@
+#ifndef TEST_SUPPORT
+#define TEST_SUPPORT
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/* Directory for a test's temporary files.
+ * Unique to the process and the running test, so tests may run in parallel.
+ * Removed with its contents on destruction. */
+class TestTempDir {
+  public:
+    TestTempDir(){
+      static std::atomic<int> n_dirs{0};
+      const testing::TestInfo* info{testing::UnitTest::GetInstance()->current_test_info()};
+      std::string test_name{info ? std::string(info->test_suite_name()) + "_" + info->name() : "no_test"};
+      std::replace(test_name.begin(), test_name.end(), '/', '_');
+
+      m_dir = std::filesystem::temp_directory_path() /
+              ("structvar_test_" + std::to_string(getpid()) + "_" + std::to_string(n_dirs++) + "_" + test_name);
+      std::filesystem::create_directories(m_dir);
+    }
+
+    ~TestTempDir(){
+      std::error_code ec{};
+      std::filesystem::remove_all(m_dir, ec);
+    }
+
+    TestTempDir(const TestTempDir&) = delete;
+    TestTempDir& operator=(const TestTempDir&) = delete;
+
+    /* Path of file name in the directory. */
+    std::filesystem::path path(const std::string& name) const { return m_dir / name; }
+
+  private:
+    std::filesystem::path m_dir;
+};
+
+/* Contents of the file at path. */
+inline std::string read_text(const std::filesystem::path& path){
+  std::ifstream in{path};
+  std::stringstream text{};
+  text << in.rdbuf();
+  return text.str();
+}
+
+/* Lines of the file at path without line endings. */
+inline std::vector<std::string> read_lines(const std::filesystem::path& path){
+  std::ifstream in{path};
+  std::vector<std::string> lines{};
+  for(std::string line{}; std::getline(in, line);){ lines.push_back(line); }
+  return lines;
+}
+
+#endif /* TEST_SUPPORT */
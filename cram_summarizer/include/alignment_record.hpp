@@ -0,0 +1,70 @@
+#ifndef ALIGNMENT_RECORD
+#define ALIGNMENT_RECORD
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "htslib/sam.h"
+
+/**
+ * Read only view of one alignment and the header it was read with.
+ * Neither is owned. Both must outlive the view.
+ */
+class AlignmentRecord {
+  public:
+    AlignmentRecord(const sam_hdr_t* header, const bam1_t* alignment);
+
+    /* Status checking */
+    bool has_sa_tag() const;
+    bool is_mapq_sufficent() const;
+    bool meets_split_criteria() const;
+    bool meets_pair_criteria() const;
+    bool expects_mate() const;
+
+    /* Flag checking */
+    bool is_paired() const;
+    bool is_proper_pair() const;
+    bool is_unmapped() const;
+    bool is_mate_unmapped() const;
+    bool is_reverse_strand() const;
+    bool is_mate_reverse_strand() const;
+    bool is_read_1() const;
+    bool is_read_2() const;
+    bool is_secondary() const;
+    bool is_qc_fail() const;
+    bool is_duplicate() const;
+    bool is_supplementary() const;
+
+    /* Field accessors */
+    uint32_t get_n_cigar() const;
+    std::string get_cigar_string() const;
+    std::string get_query_name() const;
+    // View of query name into record valid until next alignment.
+    std::string_view get_query_name_view() const;
+    std::string get_chrom() const;
+    // Value of SA tag without "SA:Z:" prefix. View into record valid until next alignment.
+    std::string_view get_sa_tag() const;
+    bool is_forward_strand() const;
+    int32_t get_tid() const;
+    int64_t get_start() const;
+    int32_t get_mate_tid() const;
+    int64_t get_mate_start() const;
+
+    /* Process data */
+    // Calculate number of base pairs on reference that the aligment spans by
+    //   sum of base pair counts of matches, deletions, skips, and mismatches. (MDNX)
+    // Binary and string_view forms parse in place without allocating.
+    static int64_t reference_span(const uint32_t* cigar, const uint32_t n_cigar);
+    static int reference_span(const std::string& cigar);
+    static int reference_span(const std::string_view& cigar);
+    static int reference_span_from_tokens(const std::vector<std::pair<int, char>>& tokens);
+    static std::vector<std::pair<int, char>> tokenize_cigar(const std::string_view cigar);
+    int count_sa_tag() const;
+    int64_t get_end() const;
+
+  protected:
+    const sam_hdr_t* m_header{nullptr};
+    const bam1_t*    m_alignment{nullptr};
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef ALIGNMENT_STORE
+#define ALIGNMENT_STORE
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "alignment_record.hpp"
+#include "aln_type.hpp"
+#include "sa_tag_scanner.hpp"
+#include "simple_alignment.hpp"
+#include "boost/json.hpp"
+
+/**
+ * Compact store of alignments grouped by type and query name.
+ * Renders the same document as adding each SimpleAlignment to the top level json object.
+ *
+ * Alignments are kept as columns of 32-bit fields (16 bytes each). Query names are written once
+ *   per group into a shared arena and contig names once per contig.
+ * Given the contig names of the input's header, records are added straight from their tid without
+ *   copying their query or contig names.
+ */
+class AlignmentStore {
+  public:
+    AlignmentStore();
+    /* Store for records of a header with contig names indexed by tid, as from AlignmentReader::get_contig_names().
+     * Names must stay valid while alignments are added. */
+    explicit AlignmentStore(const std::vector<std::string_view>& tid_names);
+
+    /* Id of contig. Names are matched exactly, so "chr1" and "1" are different contigs. */
+    uint32_t intern_contig(std::string_view chr);
+
+    void add(std::string_view qname, AlnType aln_type, uint32_t contig_id,
+             int32_t start, int32_t end, bool is_forward_strand);
+    void add(const SimpleAlignment& sa, AlnType aln_type);
+    /* Add alignment of record. Throws runtime_error if its tid is not in the names the store was made with. */
+    void add(const AlignmentRecord& record, AlnType aln_type);
+    /* Add alignment of an SA tag record of the record named qname. */
+    void add(std::string_view qname, const SaRecord& sa_record, AlnType aln_type);
+
+    size_t n_alignments() const;
+    size_t n_groups(AlnType aln_type) const;
+    // Bytes held by the store including unused capacity.
+    size_t memory_usage() const;
+
+    // Document of all_splits and all_pairs, query names in order of first appearance.
+    // All values are allocated from sp.
+    bj::object to_json(bj::storage_ptr sp = {}) const;
+
+  private:
+    // Columns for one alignment type. Indexes of groups are order of first appearance.
+    struct TypeTable {
+      // Per alignment
+      std::vector<uint32_t> group{};
+      std::vector<uint32_t> contig_strand{};
+      std::vector<int32_t>  start{};
+      std::vector<int32_t>  end{};
+      // Per group, offset of NUL terminated query name in arena
+      std::vector<uint32_t> qname_offset{};
+      // Open addressing (linear probe) of group index + 1. Zero is empty.
+      std::vector<uint32_t> slots{};
+    };
+
+    // Id of contig of tid, interned on first use so SA tag alignments naming the same contig share it.
+    uint32_t tid_contig(const int32_t tid);
+    uint32_t find_or_add_group(TypeTable& table, std::string_view qname);
+    void grow_slots(TypeTable& table);
+    std::string_view group_qname(const TypeTable& table, uint32_t group_idx) const;
+
+    std::array<TypeTable, 2> m_tables{};
+    std::vector<char> m_qname_arena{};
+
+    // Contig name to id and id to name.
+    std::map<std::string, uint32_t, std::less<>> m_contig_ids{};
+    std::vector<std::string> m_contig_names{};
+    uint32_t m_last_contig{0};
+
+    // Header contig names and their ids by tid. NO_CONTIG until first used.
+    static constexpr uint32_t NO_CONTIG{UINT32_MAX};
+    std::vector<std::string_view> m_tid_names{};
+    std::vector<uint32_t> m_tid_contig_ids{};
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef ALN_TYPE
+#define ALN_TYPE
+
+#include <array>
+#include <string_view>
+
+// Classify alignments as split or paired end for output json object.
+enum AlnType : int { SPLIT, PAIRED };
+
+// Top level json key of each alignment type, indexed by AlnType.
+inline constexpr std::array<std::string_view, 2> AlnTypeJsonKeys{"all_splits", "all_pairs"};
+
+#endif
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <random>
+#include <cstdint>
 
 /**
  * Application flow control data
@@ -16,11 +17,90 @@ struct AppControlData {
    */
   std::string input_path{};
 
+  /**
+   * Path to manifest of samples to summarize together instead of a single input file.
+   * Tab delimited: sample, path, and optional comma delimited regions.
+   * Samples are processed concurrently by the given number of workers.
+   */
+  std::string manifest_path{};
+  int workers{1};
+
+  /**
+   * Directory of compressed summaries keyed by input, regions, and version. Empty caches none.
+   * Least recently used summaries are removed once they total more than cache_size_mb.
+   */
+  std::string cache_dir{};
+  int64_t cache_size_mb{1024};
+
+  /**
+   * Path of Unix domain socket to answer region queries on for samples of the manifest.
+   * Empty runs once instead. At most max_open readers are kept open between queries.
+   * Connections sending no request for idle_timeout seconds are closed. 0 keeps them open.
+   */
+  std::string serve_path{};
+  int max_open{64};
+  int idle_timeout{60};
+
   /**
    * Path to reference fasta on disk required for reading cram files.
    */
   std::string ref_path{};
 
+  /**
+   * Regions to restrict reading to using the input's index.
+   * Region strings (chr:start-end) and/or BED file path.  Empty reads the entire input.
+   */
+  std::vector<std::string> regions{};
+  std::string regions_path{};
+
+  /**
+   * Merge regions separated by no more than this many bases into one query.
+   */
+  int64_t region_gap{0};
+
+  /**
+   * Number of threads in the shared pool used for decompression.  1 decodes on the main thread.
+   */
+  int threads{1};
+
+  /**
+   * Number of threads filtering and classifying alignments between a reader thread and the emitting thread.
+   * 0 reads, classifies, and emits on the main thread.
+   */
+  int classify_threads{0};
+
+  /**
+   * Decode only the CRAM data series the summary needs. Skips SEQ, QUAL and MD/NM regeneration.
+   */
+  bool minimal_decode{false};
+
+  /**
+   * Should read counts and reference cache statistics be printed to stderr after the run.
+   */
+  bool print_counts{false};
+
+  /**
+   * Path to write JSON of per-stage time, throughput, peak memory, and read counts of the run to.
+   * Empty writes none.
+   */
+  std::string stats_path{};
+
+  /**
+   * Stream output as one JSON line per query name group instead of one document at the end.
+   * Groups are emitted once coordinate sorted input passes where their mates can appear.
+   * Groups whose mates are further than stream_window bases away are spilled to spill_dir.
+   */
+  bool stream{false};
+  int64_t stream_window{100000};
+  std::string spill_dir{};
+
+  /**
+   * Stream paired alignments as one JSON line per mate pair instead, joined as the second mate is read.
+   * Split alignments are streamed as above. Pairs spanning more than max_insert bases are long_insert.
+   */
+  bool join_mates{false};
+  int64_t max_insert{1000};
+
   /**
    * Should version string be printed to stdout.
    * Should program exit without reading or processing data.
@@ -3,59 +3,65 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
+#include "alignment_record.hpp"
+#include "genomic_region.hpp"
 #include "htslib/hts.h"
 #include "htslib/sam.h"
 
-class AlignmentReader {
+/**
+ * Reader of SAM, BAM, or CRAM. The reader is a view of its current alignment.
+ */
+class AlignmentReader : public AlignmentRecord {
   public:
+    /* Fields the summarizer consumes: QNAME, FLAG, RNAME, POS, MAPQ, CIGAR, mate position,
+     *   and aux for the SA tag. */
+    static constexpr int SUMMARY_FIELDS{
+      SAM_QNAME | SAM_FLAG | SAM_RNAME | SAM_POS | SAM_MAPQ | SAM_CIGAR | SAM_RNEXT | SAM_PNEXT | SAM_AUX};
+
     AlignmentReader(const std::string& in_path, const std::string& ref_path, const bool silent = true);
     ~AlignmentReader();
 
-    /* Advance reader */
+    /* Advance reader. Returns false at end of input.
+     * Throws runtime_error on truncated or corrupt input. */
     bool next_alignment();
 
-    /* Status checking */
-    bool has_sa_tag();
-    bool is_mapq_sufficent();
-    bool meets_split_criteria();
-    bool meets_pair_criteria();
-
-    /* Flag checking */
-    bool is_paired();
-    bool is_proper_pair();
-    bool is_unmapped();
-    bool is_mate_unmapped();
-    bool is_reverse_strand();
-    bool is_mate_reverse_strand();
-    bool is_read_1();
-    bool is_read_2();
-    bool is_secondary();
-    bool is_qc_fail();
-    bool is_duplicate();
-    bool is_supplementary();
-
-    /* Field accessors */
-    uint32_t get_n_cigar();
-    std::string get_cigar_string();
-    std::string get_query_name();
-    std::string get_chrom();
-    std::string_view get_sa_tag();
-    bool is_forward_strand();
-    int64_t get_start();
-
-    /* Process data */
-    // Calculate number of base pairs on reference that the aligment spans by
-    //   sum of base pair counts of matches, insertions, mismatches and skips. (MDNX)
-    static int reference_span(const std::string& cigar);
-    static int reference_span(const std::string_view& cigar);
-    static int reference_span_from_tokens(const std::vector<std::pair<int, char>>& tokens);
-    static std::vector<std::pair<int, char>> tokenize_cigar(const std::string_view cigar);
-    int count_sa_tag();
-    int64_t get_end();
+    /* Read next alignment into record owned by the caller instead of the current alignment.
+     * Returns false at end of input. Throws runtime_error on truncated or corrupt input. */
+    bool read_into(bam1_t* record);
+
+    // Header of input. Valid for the lifetime of the reader.
+    const sam_hdr_t* get_header();
+
+    // Contig names of the header indexed by tid. Valid for the lifetime of the reader.
+    const std::vector<std::string_view>& get_contig_names() const;
+
+    /* Restrict reading to regions using the file index (.crai, .bai, or .csi).
+     * Regions are resolved against the header contigs, then regions that overlap or are within gap bases
+     *   are merged so each container or block is decoded once.
+     * Throws runtime_error when index is missing or a region cannot be resolved.
+     */
+    void set_regions(const std::vector<GenomicRegion>& regions, const int64_t gap = 0);
+
+    /* Share pool of decompression threads. Pool must outlive the reader.
+     * No-op for nullptr pool. Throws runtime_error if pool cannot be attached.
+     */
+    void attach_thread_pool(htsThreadPool* pool);
+
+    /* Declare the fields (SAM_* flags) that will be accessed.
+     * CRAM decoding skips data series of undeclared fields entirely, and MD/NM regeneration
+     *   unless SEQ is declared. Values of undeclared fields are unspecified.
+     * No effect on SAM or BAM input. Throws runtime_error if CRAM options cannot be set.
+     */
+    void set_required_fields(const int fields);
 
   private:
+    std::string m_in_path{};
+    std::vector<std::string_view> m_contig_names{};
     bam1_t*     alignment{};
     htsFile*    infile{nullptr};
     sam_hdr_t*  header{nullptr};
+    hts_idx_t*  index{nullptr};
+    hts_itr_t*  iterator{nullptr};
 };
 #endif
@@ -0,0 +1,65 @@
+#ifndef GENOMIC_REGION
+#define GENOMIC_REGION
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Interval on a reference contig.
+ * Coordinates are 0-based, half-open [start, end) to match htslib and BED.
+ */
+struct GenomicRegion {
+  std::string chr{};
+  int64_t start{0};
+  int64_t end{0};
+
+  // Whole region string when it may instead name an entire contig with colons in its name,
+  //   e.g. HLA-A*01:01:01:01. Empty when the region is unambiguous. See resolve_region().
+  std::string whole_contig{};
+
+  // Region string in samtools style, 1-based inclusive: {chr}:start-end
+  std::string to_string() const;
+};
+
+/*
+ * Parse samtools style region string into region.
+ *   chr            whole contig
+ *   chr:start      start (1-based) to end of contig
+ *   chr:start-end  1-based, inclusive
+ *   {chr}...       braces delimit a contig name that contains colons
+ * Unbraced names are split at the last colon. Whether the whole string names a contig instead is
+ *   only known from a header, so it is kept in whole_contig for resolve_region().
+ * Returns false when string is malformed.
+ */
+bool parse_region(std::string_view region_str, GenomicRegion& region);
+
+/*
+ * Settle a region that may name a whole contig against the contigs of a header, as hts_parse_region does.
+ * The whole string is used when it is a contig and the name before its last colon is not.
+ * Throws runtime_error when both are contigs.
+ */
+void resolve_region(GenomicRegion& region, const std::function<bool(const std::string&)>& is_contig);
+
+/*
+ * Parse comma delimited region strings, appending each to regions.
+ * Returns false when any region is malformed.
+ */
+bool parse_region_list(std::string_view regions_str, std::vector<GenomicRegion>& regions);
+
+/*
+ * Read regions from BED file. Only first three columns are used.
+ * Header, track, and comment lines are skipped.
+ * Throws runtime_error if the file cannot be read or a line is malformed.
+ */
+std::vector<GenomicRegion> read_bed_regions(const std::string& bed_path);
+
+/*
+ * Sort and merge regions on the same contig that overlap or are within gap bases of each other.
+ * Contigs are kept in order of first appearance. Regions not yet resolved only merge with the same string.
+ */
+std::vector<GenomicRegion> merge_regions(const std::vector<GenomicRegion>& regions, const int64_t gap = 0);
+
+#endif
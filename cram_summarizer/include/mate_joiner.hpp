@@ -0,0 +1,80 @@
+#ifndef MATE_JOINER
+#define MATE_JOINER
+
+#include <cstdint>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "simple_alignment.hpp"
+
+/**
+ * Joins paired alignments of coordinate sorted input into one JSON line per pair as the second mate arrives:
+ *     {"qname":"q","pair":[{alignment},{alignment}],"orientation":"FR","insert_size":350,"class":"concordant"}
+ * Mates are in order of position. Orientation is the strand of each mate in that order.
+ *   insert_size is the span of both mates on the same contig, null otherwise.
+ * Class is the first that applies of: interchromosomal, inverted (FF or RR), everted (RF),
+ *   long_insert (insert_size > max_insert), and concordant.
+ * A first mate waits until reading passes its mate's position. Mates that do not arrive by then, such as
+ *   those filtered out, are written alone with class unpaired and null orientation and insert_size.
+ * First mates whose mate is on a later contig are held in memory until that contig is read.
+ */
+class MateJoiner {
+  public:
+    MateJoiner(std::ostream& out, const int64_t max_insert);
+
+    /* Add alignment from record at tid:pos whose mate is at mate_tid:mate_pos.
+     * Pass mate_tid < 0 when the mate is unmapped.
+     * Throws runtime_error if records are not coordinate sorted.
+     */
+    void add(const SimpleAlignment& sa, const int32_t tid, const int64_t pos,
+             const int32_t mate_tid, const int64_t mate_pos);
+
+    /* Write remaining first mates as unpaired. */
+    void finish();
+
+    /* Number of first mates waiting for their mate */
+    size_t n_pending() const;
+
+    /* Number of pairs and of unpaired alignments written */
+    int64_t n_joined() const;
+    int64_t n_unpaired() const;
+
+  private:
+    struct Pending {
+      SimpleAlignment sa{};
+      int32_t tid{0};
+      uint64_t seq{0};
+    };
+
+    // Heap entry ordering pending first mates by their mate's position, then by arrival.
+    struct Expiry {
+      int32_t mate_tid{0};
+      int64_t mate_pos{0};
+      uint64_t seq{0};
+      std::string qname{};
+      bool operator>(const Expiry& other) const;
+    };
+
+    void write_pair(const SimpleAlignment& first, const int32_t first_tid,
+                    const SimpleAlignment& second, const int32_t second_tid);
+    void write_unpaired(const SimpleAlignment& sa);
+    // Write first mates whose mate was due before tid:pos as unpaired.
+    void expire_before(const int32_t tid, const int64_t pos);
+
+    std::ostream& m_out;
+    int64_t m_max_insert{0};
+
+    int32_t m_tid{-1};
+    int64_t m_pos{-1};
+    uint64_t m_seq{0};
+    int64_t m_n_joined{0};
+    int64_t m_n_unpaired{0};
+
+    std::unordered_map<std::string, Pending> m_pending{};
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> m_expiry{};
+};
+
+#endif
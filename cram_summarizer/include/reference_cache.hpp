@@ -0,0 +1,46 @@
+#ifndef REFERENCE_CACHE
+#define REFERENCE_CACHE
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include "htslib/hts.h"
+#include "htslib/sam.h"
+
+/**
+ * Process wide cache of CRAM reference sequence.
+ * Readers of CRAMs that use the same reference fasta and header contigs share one htslib
+ *   reference store, so each contig is loaded into memory once per process instead of once per reader.
+ */
+class ReferenceCache {
+  public:
+    static ReferenceCache& instance();
+
+    ReferenceCache(const ReferenceCache&) = delete;
+    ReferenceCache& operator=(const ReferenceCache&) = delete;
+    ~ReferenceCache();
+
+    /* Point CRAM file handle at shared reference for ref_path.
+     * in_path is reopened once per reference and header to anchor the shared store.
+     * Throws runtime_error if reference cannot be loaded.
+     */
+    void attach(htsFile* cram_file, const sam_hdr_t* header, const std::string& in_path,
+                const std::string& ref_path);
+
+    /* Attachments that reused or created a shared reference store */
+    int64_t hits();
+    int64_t misses();
+
+  private:
+    ReferenceCache() = default;
+
+    std::mutex m_mutex{};
+    int64_t m_hits{0};
+    int64_t m_misses{0};
+
+    // Open handles that own each shared reference store, keyed by canonical reference path and header contigs.
+    std::map<std::string, htsFile*> m_anchors{};
+};
+
+#endif
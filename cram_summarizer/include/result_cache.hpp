@@ -0,0 +1,84 @@
+#ifndef RESULT_CACHE
+#define RESULT_CACHE
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "genomic_region.hpp"
+
+/**
+ * Process wide on-disk cache of serialized summary documents.
+ * Entries are keyed by path, size, and modification time of the input and of the reference, merged regions,
+ *   program version, and summary format. The summary format stands in for the document layout and filters.
+ * Each entry is a gzip file named by the hash of its key that begins with the key, so hash collisions
+ *   read as misses. Entries are written to a temporary file and renamed into place, so processes
+ *   sharing a directory never read partial entries.
+ * Once entries exceed the size bound, least recently used entries are removed. The total size is scanned
+ *   from the directory at init and then kept running, so entries other processes add are counted at the
+ *   next eviction.
+ */
+class ResultCache {
+  public:
+    static ResultCache& instance();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /* Cache entries in dir, keeping at most max_bytes of entries.
+     * Entries of other versions or summary formats never match.
+     * Empty dir disables the cache. Throws runtime_error if dir cannot be created.
+     */
+    void init(const std::string& dir, const uint64_t max_bytes, const std::string& version,
+              const int summary_format);
+    bool is_enabled();
+
+    /* Key of summary of the input at path, read with the reference at ref_path, over merged regions.
+     * Empty regions summarize all of the input. Empty ref_path reads without a reference.
+     * Empty when the input or reference is not a regular file, such as stdin, and cannot be cached.
+     */
+    std::string make_key(const std::string& path, const std::string& ref_path,
+                         const std::vector<GenomicRegion>& regions);
+
+    /* Read document cached under key. False on a miss. */
+    bool load(const std::string& key, std::string& document);
+
+    /* Cache document under key and evict entries over the size bound.
+     * Failure to write leaves the cache unchanged.
+     */
+    void store(const std::string& key, const std::string& document);
+
+    /* Cached document of the input at path read with the reference at ref_path over regions. On a miss,
+     *   document is made by summarize and cached. Without the cache, or for uncacheable input, summarize
+     *   is called every time.
+     */
+    std::string get_or_make(const std::string& path, const std::string& ref_path,
+                            const std::vector<GenomicRegion>& regions, const std::function<std::string()>& summarize);
+
+    /* Lookups that found and did not find a cached document */
+    int64_t hits();
+    int64_t misses();
+
+  private:
+    ResultCache() = default;
+
+    // Remove least recently used entries until the total size is within bound. Requires m_mutex.
+    void evict();
+
+    std::mutex m_mutex{};
+    std::string m_dir{};
+    uint64_t m_max_bytes{0};
+    std::string m_version{};
+    int m_summary_format{0};
+    // Bytes of entries as of the last scan plus those stored since. Guarded by m_mutex.
+    uint64_t m_total_bytes{0};
+
+    std::atomic<int64_t> m_hits{0};
+    std::atomic<int64_t> m_misses{0};
+    // Distinguishes temporary files of concurrent writers in this process.
+    std::atomic<uint64_t> m_n_writes{0};
+};
+
+#endif /* RESULT_CACHE */
@@ -0,0 +1,39 @@
+#ifndef SA_TAG_SCANNER
+#define SA_TAG_SCANNER
+
+#include <cstdint>
+#include <string_view>
+
+/*
+ * Supplementary alignment from an SA tag record: rname,pos,strand,CIGAR,mapQ,NM;
+ * String fields are views into the tag value and are only valid as long as it is.
+ */
+struct SaRecord {
+  std::string_view rname{};
+  // Position as written in the tag (1-based).
+  int64_t pos{0};
+  bool is_forward_strand{true};
+  std::string_view cigar{};
+  // Bases on reference spanned by the CIGAR.
+  int64_t ref_span{0};
+  int mapq{0};
+  int nm{0};
+};
+
+/*
+ * Single pass, allocation free scanner over the value of an SA tag.
+ * Accepts the value with or without the leading "SA:Z:" identifier.
+ */
+class SaTagScanner {
+  public:
+    explicit SaTagScanner(std::string_view sa_value);
+
+    // Parse the next record into rec. Returns false when no records remain.
+    // Malformed records are skipped.
+    bool next(SaRecord& rec);
+
+  private:
+    std::string_view m_remaining{};
+};
+
+#endif
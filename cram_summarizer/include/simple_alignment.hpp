@@ -2,6 +2,7 @@
 #define SIMPLE_ALIGNMENT
 
 #include <ostream>
+#include <string_view>
 #include "boost/json.hpp"
 
 namespace bj = boost::json;
@@ -25,8 +26,14 @@ class SimpleAlignment {
 
     friend std::ostream& operator<<(std::ostream& os, const SimpleAlignment& sa);
 
-    // Create minimal json object of chr, start, end, strand
-    bj::object to_json();
+    // Create minimal json object of chr, start, end, strand. Values are allocated from sp.
+    bj::object to_json(bj::storage_ptr sp = {}) const;
 };
 
+/* Json object of one alignment: chr, start, end, is_reverse.
+ * Keys are constants and the object is sized for them up front, so it takes one allocation from sp.
+ */
+bj::object alignment_json(std::string_view chr, const int start, const int end, const bool is_reverse,
+                          bj::storage_ptr sp = {});
+
 #endif
@@ -0,0 +1,97 @@
+#ifndef STREAMING_WRITER
+#define STREAMING_WRITER
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "aln_type.hpp"
+#include "simple_alignment.hpp"
+
+/**
+ * Bounded memory output of alignments grouped by query name.
+ * For coordinate sorted input, a group is complete once reading passes the position of the last
+ *   record expected to join it, its mate. Complete groups are written as one JSON line:
+ *     {"all_pairs":{"qname":[{alignment}, ...]}}
+ * Groups with a mate on another contig or more than window bases away are spilled to hash
+ *   partitioned files and written by finish(), holding one partition in memory at a time.
+ *   Partitions larger than max_partition_bytes are split again by another hash before they are
+ *   read, so memory stays within a small multiple of max_partition_bytes unless one query name
+ *   alone spills more than that.
+ */
+class StreamingWriter {
+  public:
+    StreamingWriter(std::ostream& out, const int64_t window, const std::string& spill_dir = "",
+                    const int64_t max_partition_bytes = int64_t{1} << 28);
+    ~StreamingWriter();
+
+    /* Add alignment from record at tid:pos whose mate is expected at mate_tid:mate_pos.
+     * Pass the record's own position when no mate is expected.
+     * Throws runtime_error if records are not coordinate sorted.
+     */
+    void add(const SimpleAlignment& sa, const AlnType aln_type, const int32_t tid, const int64_t pos,
+             const int32_t mate_tid, const int64_t mate_pos);
+
+    /* Write all remaining groups including spilled groups. */
+    void finish();
+
+    /* Number of groups held in memory */
+    size_t n_pending() const;
+
+    /* Number of alignments written to spill files */
+    int64_t n_spilled() const;
+
+  private:
+    struct Group {
+      AlnType aln_type{AlnType::SPLIT};
+      std::string qname{};
+      std::vector<SimpleAlignment> alignments{};
+      // Last position on the current contig at which an alignment may join the group.
+      int64_t horizon{0};
+    };
+
+    // Heap entry ordering pending groups by horizon, then by arrival.
+    struct Expiry {
+      int64_t horizon{0};
+      uint64_t seq{0};
+      std::string key{};
+      bool operator>(const Expiry& other) const;
+    };
+
+    static constexpr int N_SPILL_PARTITIONS{16};
+    // Splits of one partition, after which it is read whatever its size.
+    static constexpr int MAX_SPLIT_DEPTH{4};
+
+    std::ostream& m_out;
+    int64_t m_window{0};
+    std::string m_spill_dir{};
+    int64_t m_max_partition_bytes{0};
+
+    int32_t m_tid{-1};
+    int64_t m_pos{-1};
+    uint64_t m_seq{0};
+    int64_t m_n_spilled{0};
+
+    std::unordered_map<std::string, Group> m_groups{};
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> m_expiry{};
+
+    // Every spill file created, removed with remove_spill_files(). Files of partitions split in finish() included.
+    std::vector<std::string> m_spill_paths{};
+    std::vector<std::ofstream> m_spill_files{};
+    std::vector<int64_t> m_spill_bytes{};
+
+    void write_group(const Group& group);
+    void expire_through(const int64_t pos);
+    void spill(const SimpleAlignment& sa, const AlnType aln_type);
+    std::string create_spill_file();
+    void open_spill_files();
+    void remove_spill_files();
+    // Write groups of the spill file at path, hashed at depth, splitting it first when too large.
+    void write_partition(const std::string& path, const int64_t n_bytes, const int depth);
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef SUMMARY_SERVER
+#define SUMMARY_SERVER
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "app.hpp"
+
+/**
+ * Least recently used set of open readers keyed by sample.
+ * A reader is leased to one query at a time. Queries of the same sample wait for its lease.
+ * A reader evicted while leased is closed when its lease is released.
+ */
+class ReaderCache {
+  private:
+    struct Slot {
+      std::mutex mutex{};
+      std::unique_ptr<AlignmentReader> reader{};
+    };
+
+  public:
+    typedef std::function<std::unique_ptr<AlignmentReader>(const std::string& sample)> Opener;
+
+    /* Exclusive use of one open reader. */
+    class Lease {
+      public:
+        AlignmentReader& reader();
+
+      private:
+        friend class ReaderCache;
+        explicit Lease(std::shared_ptr<Slot> slot);
+
+        // Declared before the lock so the lock is released before the slot can be freed.
+        std::shared_ptr<Slot> m_slot{};
+        std::unique_lock<std::mutex> m_lock{};
+    };
+
+    /* Keep at most capacity (at least 1) readers open. Opener opens the reader of a sample. */
+    ReaderCache(const size_t capacity, Opener opener);
+
+    /* Lease reader of sample, opening it when it is not open.
+     * Throws what the opener throws, in which case nothing is cached for sample.
+     */
+    Lease acquire(const std::string& sample);
+
+    /* Number of open readers, excluding evicted readers still leased. */
+    size_t size() const;
+
+    /* Acquisitions that reused an open reader and that opened one. */
+    int64_t hits() const;
+    int64_t misses() const;
+
+  private:
+    // Remove sample if slot is still the one cached for it.
+    void forget(const std::string& sample, const std::shared_ptr<Slot>& slot);
+
+    size_t m_capacity{1};
+    Opener m_opener{};
+
+    mutable std::mutex m_mutex{};
+    // Most recently acquired first.
+    std::list<std::pair<std::string, std::shared_ptr<Slot>>> m_lru{};
+    std::unordered_map<std::string, decltype(m_lru)::iterator> m_index{};
+
+    std::atomic<int64_t> m_hits{0};
+    std::atomic<int64_t> m_misses{0};
+};
+
+/**
+ * Long lived summarizer answering region queries for manifest samples on a Unix domain socket.
+ * A request is one line of sample, tab, and comma delimited regions, as in a manifest:
+ *     del_1_sample_1\tchr1:50178900-50179100
+ * Without regions, the manifest regions of the sample or command line regions are used.
+ * Each request is answered with one line of the JSON run() prints for the sample and regions, or:
+ *     {"error":"message"}
+ * A connection may send any number of requests. control.workers connections are served at a time.
+ * A connection idle for control.idle_timeout seconds is closed so its worker can serve another.
+ * Header, index, and reference of the max_open most recently queried samples stay loaded between queries.
+ */
+class SummaryServer {
+  public:
+    /* Listen on control.serve_path, replacing a stale socket there.
+     * Throws runtime_error if the socket cannot be created.
+     */
+    SummaryServer(const std::vector<BatchEntry>& entries, const AppControlData& control);
+    ~SummaryServer();
+
+    SummaryServer(const SummaryServer&) = delete;
+    SummaryServer& operator=(const SummaryServer&) = delete;
+
+    /* Answer connections until stop(). Returns once open connections are closed. */
+    void serve();
+
+    /* Make serve() return after answering requests in progress. Async signal safe. */
+    void stop();
+
+    /* Answer one request line. */
+    std::string answer(std::string_view request);
+
+    const ReaderCache& readers() const;
+
+    /* Read counts of all queries answered. */
+    Accounting counts();
+
+  private:
+    void serve_connections();
+    void serve_connection(const int fd);
+
+    // Wait until fd is readable. False once stopped or after timeout_ms, negative waits indefinitely.
+    bool wait_readable(const int fd, const int timeout_ms = -1);
+
+    AppControlData m_control{};
+    // Entries by sample, with command line regions in place of absent manifest regions.
+    std::unordered_map<std::string, BatchEntry> m_entries{};
+    ReaderCache m_readers;
+
+    std::mutex m_counts_mutex{};
+    Accounting m_counts{};
+
+    int m_listen_fd{-1};
+    // Written to by stop() to wake every waiting worker.
+    int m_stop_pipe[2]{-1, -1};
+};
+
+#endif /* SUMMARY_SERVER */
@@ -0,0 +1,36 @@
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <mutex>
+#include "htslib/hts.h"
+
+/**
+ * Process wide htslib thread pool.
+ * Every AlignmentReader and any output writer attach to the same pool so that
+ *   BGZF inflation and CRAM slice decoding share one set of worker threads.
+ */
+class SharedThreadPool {
+  public:
+    static SharedThreadPool& instance();
+
+    SharedThreadPool(const SharedThreadPool&) = delete;
+    SharedThreadPool& operator=(const SharedThreadPool&) = delete;
+    ~SharedThreadPool();
+
+    // Create pool with n_threads workers. Ignored when n_threads < 2 or pool already exists.
+    void init(const int n_threads);
+
+    // Pool to pass to hts_set_thread_pool. nullptr when pool has not been created.
+    htsThreadPool* get();
+
+    // Number of worker threads. 0 when pool has not been created.
+    int size();
+
+  private:
+    SharedThreadPool() = default;
+
+    std::mutex    m_mutex{};
+    htsThreadPool m_pool{nullptr, 0};
+};
+
+#endif
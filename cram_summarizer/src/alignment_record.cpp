@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "alignment_record.hpp"
+#include "app_utils.hpp"
+#include "htslib/sam.h"
+
+AlignmentRecord::AlignmentRecord(const sam_hdr_t* header, const bam1_t* alignment) :
+  m_header(header), m_alignment(alignment) {}
+
+/*******************
+ * Field Accessors *
+ ******************/
+uint32_t AlignmentRecord::get_n_cigar() const{
+  return m_alignment->core.n_cigar;
+}
+
+std::string AlignmentRecord::get_cigar_string() const{
+  uint32_t n_cigar{this->get_n_cigar()};
+  uint32_t* cigar{bam_get_cigar(m_alignment)};
+
+  std::ostringstream sstream;
+  uint32_t operation{};
+  uint32_t op_len{};
+  char op_chr{};
+
+  for(int i = 0; i < n_cigar; i++){
+    operation = bam_cigar_op(cigar[i]);
+    op_len = bam_cigar_oplen(cigar[i]);
+    op_chr = bam_cigar_opchr(cigar[i]);
+
+    sstream << op_len << op_chr;
+  }
+
+  return sstream.str();
+}
+
+std::string AlignmentRecord::get_query_name() const{
+  return std::string( bam_get_qname(m_alignment) );
+}
+
+std::string_view AlignmentRecord::get_query_name_view() const{
+  return std::string_view( bam_get_qname(m_alignment) );
+}
+
+std::string_view AlignmentRecord::get_sa_tag() const{
+  uint8_t* sa_aux{bam_aux_get(m_alignment, "SA")};
+  char* sa_value{sa_aux ? bam_aux2Z(sa_aux) : nullptr};
+
+  return sa_value ? std::string_view(sa_value) : "";
+}
+
+bool AlignmentRecord::is_forward_strand() const{
+  return !bam_is_rev(m_alignment);
+}
+
+int32_t AlignmentRecord::get_tid() const{
+  return m_alignment->core.tid;
+}
+
+int64_t AlignmentRecord::get_start() const{
+  return m_alignment->core.pos;
+}
+
+int32_t AlignmentRecord::get_mate_tid() const{
+  return m_alignment->core.mtid;
+}
+
+int64_t AlignmentRecord::get_mate_start() const{
+  return m_alignment->core.mpos;
+}
+
+std::string AlignmentRecord::get_chrom() const{
+  int tid = m_alignment->core.tid;
+  return std::string(m_header->target_name[tid]);
+}
+
+/****************
+ * Process Data *
+ ***************/
+
+int AlignmentRecord::count_sa_tag() const{
+  std::string_view sa_str = get_sa_tag();
+  return std::count_if(sa_str.begin(), sa_str.end(), [](char c){return c == ';';});
+}
+
+std::vector<std::pair<int, char>> AlignmentRecord::tokenize_cigar(const std::string_view cigar){
+  std::string_view digits{"0123456789"};
+  std::vector<std::pair<int, char>> tokens{};
+  size_t position{0};
+  size_t op_position{0};
+  int count{0};
+  char operation{};
+
+  while(position < cigar.length()){
+    // position of the next operation charater
+    op_position = cigar.find_first_not_of(digits, position);
+    operation = cigar.at(op_position);
+
+    // count preceeds the operation character
+    view_to_numeric(cigar.substr(position, op_position-position), count);
+
+    tokens.push_back(std::make_pair(count, operation));
+
+    position = op_position + 1;
+  }
+
+  return tokens;
+}
+
+int AlignmentRecord::reference_span_from_tokens(const std::vector<std::pair<int, char>>& tokens){
+  int sum{0};
+
+  for( auto &token : tokens ){
+    switch(std::get<char>(token)) {
+      case 'M':
+      case 'D':
+      case 'N':
+      case 'X':
+        sum += std::get<int>(token);
+      default:
+        break;
+    }
+  }
+  return sum;
+}
+
+int64_t AlignmentRecord::reference_span(const uint32_t* cigar, const uint32_t n_cigar){
+  int64_t sum{0};
+
+  for(uint32_t i{0}; i < n_cigar; i++){
+    switch(bam_cigar_op(cigar[i])) {
+      case BAM_CMATCH:
+      case BAM_CDEL:
+      case BAM_CREF_SKIP:
+      case BAM_CDIFF:
+        sum += bam_cigar_oplen(cigar[i]);
+      default:
+        break;
+    }
+  }
+  return sum;
+}
+
+int AlignmentRecord::reference_span(const std::string& cigar){
+  return reference_span(std::string_view(cigar));
+}
+
+int AlignmentRecord::reference_span(const std::string_view& cigar){
+  int sum{0};
+  int count{0};
+
+  // Accumulate digits of each count until its operation character is reached.
+  for(char chr : cigar){
+    if(chr >= '0' && chr <= '9'){
+      count = count * 10 + (chr - '0');
+      continue;
+    }
+
+    switch(chr) {
+      case 'M':
+      case 'D':
+      case 'N':
+      case 'X':
+        sum += count;
+      default:
+        break;
+    }
+    count = 0;
+  }
+  return sum;
+}
+
+int64_t AlignmentRecord::get_end() const{
+  return m_alignment->core.pos + reference_span(bam_get_cigar(m_alignment), get_n_cigar());
+}
+
+/*****************
+ * Flag Checking *
+ ****************/
+bool AlignmentRecord::is_paired() const{        return m_alignment->core.flag & BAM_FPAIRED; }
+bool AlignmentRecord::is_proper_pair() const{   return m_alignment->core.flag & BAM_FPROPER_PAIR; }
+bool AlignmentRecord::is_unmapped() const{      return m_alignment->core.flag & BAM_FUNMAP; }
+bool AlignmentRecord::is_mate_unmapped() const{       return m_alignment->core.flag & BAM_FMUNMAP; }
+bool AlignmentRecord::is_reverse_strand() const{      return m_alignment->core.flag & BAM_FREVERSE; }
+bool AlignmentRecord::is_mate_reverse_strand() const{ return m_alignment->core.flag & BAM_FMREVERSE; }
+bool AlignmentRecord::is_read_1() const{        return m_alignment->core.flag & BAM_FREAD1; }
+bool AlignmentRecord::is_read_2() const{        return m_alignment->core.flag & BAM_FREAD2; }
+bool AlignmentRecord::is_secondary() const{     return m_alignment->core.flag & BAM_FSECONDARY; }
+bool AlignmentRecord::is_qc_fail() const{       return m_alignment->core.flag & BAM_FQCFAIL; }
+bool AlignmentRecord::is_duplicate() const{     return m_alignment->core.flag & BAM_FDUP; }
+bool AlignmentRecord::is_supplementary() const{ return m_alignment->core.flag & BAM_FSUPPLEMENTARY; }
+
+/*******************
+ * Status Checking *
+ ******************/
+bool AlignmentRecord::has_sa_tag() const{
+  return bam_aux_get(m_alignment,"SA");
+}
+
+bool AlignmentRecord::is_mapq_sufficent() const{
+  return m_alignment->core.qual > 1 && m_alignment->core.qual < 255;
+}
+
+bool AlignmentRecord::meets_pair_criteria() const{
+  return !is_unmapped() && !is_secondary() && !is_supplementary() && is_paired();
+}
+
+bool AlignmentRecord::meets_split_criteria() const{
+  return !is_secondary() && !is_supplementary() && has_sa_tag();
+}
+
+bool AlignmentRecord::expects_mate() const{
+  return is_paired() && !is_mate_unmapped();
+}
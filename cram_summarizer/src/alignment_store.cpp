@@ -0,0 +1,202 @@
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include "alignment_store.hpp"
+
+// High bit of contig_strand column marks reverse strand.
+static constexpr uint32_t REVERSE_BIT{1u << 31};
+static constexpr size_t INITIAL_SLOTS{64};
+
+// FNV-1a
+static uint64_t hash_qname(std::string_view qname){
+  uint64_t hash{14695981039346656037ull};
+  for(char c : qname){
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+AlignmentStore::AlignmentStore(){
+  for(auto& table : m_tables){
+    table.slots.assign(INITIAL_SLOTS, 0);
+  }
+}
+
+AlignmentStore::AlignmentStore(const std::vector<std::string_view>& tid_names) :
+  AlignmentStore()
+{
+  m_tid_names = tid_names;
+  m_tid_contig_ids.assign(tid_names.size(), NO_CONTIG);
+}
+
+uint32_t AlignmentStore::intern_contig(std::string_view chr){
+  // Input is usually sorted, so the previous contig is the common case.
+  if(!m_contig_names.empty() && m_contig_names[m_last_contig] == chr){
+    return m_last_contig;
+  }
+
+  auto it{m_contig_ids.find(chr)};
+  if(it == m_contig_ids.end()){
+    if(m_contig_names.size() >= REVERSE_BIT){
+      throw std::runtime_error("Too many contigs for alignment store.");
+    }
+    it = m_contig_ids.emplace(std::string(chr), static_cast<uint32_t>(m_contig_names.size())).first;
+    m_contig_names.emplace_back(chr);
+  }
+
+  m_last_contig = it->second;
+  return m_last_contig;
+}
+
+uint32_t AlignmentStore::tid_contig(const int32_t tid){
+  if(tid < 0 || static_cast<size_t>(tid) >= m_tid_contig_ids.size()){
+    throw std::runtime_error(std::string("Alignment contig not in header: ") + std::to_string(tid));
+  }
+
+  uint32_t& contig_id{m_tid_contig_ids[tid]};
+  if(contig_id == NO_CONTIG){
+    contig_id = intern_contig(m_tid_names[tid]);
+  }
+  return contig_id;
+}
+
+std::string_view AlignmentStore::group_qname(const TypeTable& table, uint32_t group_idx) const{
+  return std::string_view{m_qname_arena.data() + table.qname_offset[group_idx]};
+}
+
+void AlignmentStore::grow_slots(TypeTable& table){
+  std::vector<uint32_t> slots(table.slots.size() * 2, 0);
+  size_t mask{slots.size() - 1};
+
+  for(uint32_t group_idx{0}; group_idx < table.qname_offset.size(); group_idx++){
+    size_t pos{hash_qname(group_qname(table, group_idx)) & mask};
+    while(slots[pos] != 0){
+      pos = (pos + 1) & mask;
+    }
+    slots[pos] = group_idx + 1;
+  }
+
+  table.slots.swap(slots);
+}
+
+uint32_t AlignmentStore::find_or_add_group(TypeTable& table, std::string_view qname){
+  size_t mask{table.slots.size() - 1};
+  size_t pos{hash_qname(qname) & mask};
+
+  while(table.slots[pos] != 0){
+    uint32_t group_idx{table.slots[pos] - 1};
+    if(group_qname(table, group_idx) == qname){
+      return group_idx;
+    }
+    pos = (pos + 1) & mask;
+  }
+
+  if(m_qname_arena.size() + qname.size() + 1 > std::numeric_limits<uint32_t>::max()){
+    throw std::runtime_error("Query names exceed alignment store capacity.");
+  }
+
+  uint32_t group_idx{static_cast<uint32_t>(table.qname_offset.size())};
+  table.qname_offset.push_back(static_cast<uint32_t>(m_qname_arena.size()));
+  m_qname_arena.insert(m_qname_arena.end(), qname.begin(), qname.end());
+  m_qname_arena.push_back('\0');
+  table.slots[pos] = group_idx + 1;
+
+  // Keep load factor at or below one half so probe sequences stay short.
+  if(table.qname_offset.size() * 2 > table.slots.size()){
+    grow_slots(table);
+  }
+
+  return group_idx;
+}
+
+void AlignmentStore::add(std::string_view qname, AlnType aln_type, uint32_t contig_id,
+                         int32_t start, int32_t end, bool is_forward_strand){
+  TypeTable& table{m_tables.at(aln_type)};
+
+  table.group.push_back(find_or_add_group(table, qname));
+  table.contig_strand.push_back(contig_id | (is_forward_strand ? 0 : REVERSE_BIT));
+  table.start.push_back(start);
+  table.end.push_back(end);
+}
+
+void AlignmentStore::add(const SimpleAlignment& sa, AlnType aln_type){
+  add(sa.qname, aln_type, intern_contig(sa.chr), sa.start, sa.end, sa.strand);
+}
+
+void AlignmentStore::add(const AlignmentRecord& record, AlnType aln_type){
+  add(record.get_query_name_view(), aln_type, tid_contig(record.get_tid()),
+      static_cast<int32_t>(record.get_start()), static_cast<int32_t>(record.get_end()), record.is_forward_strand());
+}
+
+void AlignmentStore::add(std::string_view qname, const SaRecord& sa_record, AlnType aln_type){
+  add(qname, aln_type, intern_contig(sa_record.rname), static_cast<int32_t>(sa_record.pos),
+      static_cast<int32_t>(sa_record.pos + sa_record.ref_span), sa_record.is_forward_strand);
+}
+
+size_t AlignmentStore::n_alignments() const{
+  return m_tables[AlnType::SPLIT].group.size() + m_tables[AlnType::PAIRED].group.size();
+}
+
+size_t AlignmentStore::n_groups(AlnType aln_type) const{
+  return m_tables.at(aln_type).qname_offset.size();
+}
+
+size_t AlignmentStore::memory_usage() const{
+  size_t n_bytes{m_qname_arena.capacity()};
+  for(auto& table : m_tables){
+    n_bytes += sizeof(uint32_t) * (table.group.capacity() + table.contig_strand.capacity() +
+                                   table.qname_offset.capacity() + table.slots.capacity());
+    n_bytes += sizeof(int32_t) * (table.start.capacity() + table.end.capacity());
+  }
+  for(auto& name : m_contig_names){
+    n_bytes += name.capacity();
+  }
+  n_bytes += sizeof(std::string_view) * m_tid_names.capacity() + sizeof(uint32_t) * m_tid_contig_ids.capacity();
+  return n_bytes;
+}
+
+bj::object AlignmentStore::to_json(bj::storage_ptr sp) const{
+  bj::object obj(AlnTypeJsonKeys.size(), sp);
+
+  for(AlnType aln_type : {AlnType::SPLIT, AlnType::PAIRED}){
+    const TypeTable& table{m_tables[aln_type]};
+    size_t n_groups{table.qname_offset.size()};
+
+    // Counting sort of alignments by group keeps insertion order within each group.
+    std::vector<uint32_t> group_begin(n_groups + 1, 0);
+    for(uint32_t group_idx : table.group){
+      group_begin[group_idx + 1]++;
+    }
+    for(size_t i{1}; i <= n_groups; i++){
+      group_begin[i] += group_begin[i - 1];
+    }
+    std::vector<uint32_t> by_group(table.group.size());
+    std::vector<uint32_t> fill{group_begin.begin(), group_begin.end() - 1};
+    for(uint32_t aln_idx{0}; aln_idx < table.group.size(); aln_idx++){
+      by_group[fill[table.group[aln_idx]]++] = aln_idx;
+    }
+
+    bj::object type_container(n_groups, sp);
+    for(uint32_t group_idx{0}; group_idx < n_groups; group_idx++){
+      // Parentheses, as braces would make an array holding a null.
+      bj::array alignments(sp);
+      alignments.reserve(group_begin[group_idx + 1] - group_begin[group_idx]);
+
+      for(uint32_t i{group_begin[group_idx]}; i < group_begin[group_idx + 1]; i++){
+        uint32_t aln_idx{by_group[i]};
+        uint32_t contig_strand{table.contig_strand[aln_idx]};
+
+        alignments.emplace_back(alignment_json(m_contig_names[contig_strand & ~REVERSE_BIT],
+            table.start[aln_idx], table.end[aln_idx], (contig_strand & REVERSE_BIT) != 0, sp));
+      }
+
+      // Query names are unique per table, so no group is looked up twice.
+      type_container.emplace(group_qname(table, group_idx), std::move(alignments));
+    }
+
+    obj.emplace(AlnTypeJsonKeys[aln_type], std::move(type_container));
+  }
+
+  return obj;
+}
@@ -1,6 +1,8 @@
 #include "app.hpp"
 #include "boost/program_options.hpp"
 #include "app_utils.hpp"
+#include <memory>
+#include <optional>
 #include <ranges>
 #include <iomanip>
 
@@ -40,6 +42,12 @@ int app_main(const int argc, const char* argv[]) {
   }
 }
 
+std::string version_string(){
+  return std::to_string(PROJECT_VERSION_MAJOR) + "." +
+         std::to_string(PROJECT_VERSION_MINOR) + "." +
+         std::to_string(PROJECT_VERSION_PATCH);
+}
+
 void emit_version_text(){
   std::cout
     << PROGRAM_TITLE << "\n"
@@ -62,6 +70,43 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
       ("help,h", "Print usage and exit.")
       ("version,v", "Print version and exit.")
       ("ref,r", po::value(&controls.ref_path),"Path to reference fasta for crams.")
+      ("manifest,m", po::value(&controls.manifest_path),
+        "Tab delimited file of sample, path, and optional regions to summarize instead of FILE.")
+      ("workers,w", po::value(&controls.workers), "Number of samples summarized concurrently. Default 1.")
+      ("region", po::value(&controls.regions)->composing(),
+        "Region to summarize (chr:start-end, or {chr}:start-end for contig names with colons). Repeatable. Requires indexed input.")
+      ("regions-file", po::value(&controls.regions_path), "BED file of regions to summarize.")
+      ("region-gap", po::value(&controls.region_gap),
+        "Merge regions within this many bases of each other. Default 0.")
+      ("threads,t", po::value(&controls.threads), "Number of decompression threads. Default 1.")
+      ("classify-threads", po::value(&controls.classify_threads),
+        "Number of threads filtering and classifying alignments. Default 0 classifies on the main thread.")
+      ("minimal-decode", po::bool_switch(&controls.minimal_decode),
+        "Skip decoding CRAM fields the summary does not use (SEQ, QUAL).")
+      ("print-counts", po::bool_switch(&controls.print_counts),
+        "Print read counts and reference cache hit rate to stderr.")
+      ("stats", po::value(&controls.stats_path),
+        "Write JSON of per-stage wall and CPU time, records/sec, bytes read, peak RSS, and read counts to this file.")
+      ("serve", po::value(&controls.serve_path),
+        "Answer region queries for manifest samples on this Unix socket instead of summarizing once.")
+      ("max-open", po::value(&controls.max_open),
+        "Max readers kept open between queries when serving. Default 64.")
+      ("idle-timeout", po::value(&controls.idle_timeout),
+        "Seconds a served connection may send nothing before it is closed. 0 never closes. Default 60.")
+      ("cache-dir", po::value(&controls.cache_dir),
+        "Directory of cached summaries reused for unchanged inputs and regions. Default none.")
+      ("cache-size", po::value(&controls.cache_size_mb),
+        "Max megabytes of cached summaries before least recently used are removed. Default 1024.")
+      ("stream", po::bool_switch(&controls.stream),
+        "Emit one JSON line per query name as soon as it is complete. Requires sorted input.")
+      ("stream-window", po::value(&controls.stream_window),
+        "Max mate distance kept in memory when streaming. Default 100000.")
+      ("spill-dir", po::value(&controls.spill_dir),
+        "Directory for long range groups when streaming. Default system temp directory.")
+      ("join-mates", po::bool_switch(&controls.join_mates),
+        "Stream one JSON line per mate pair with orientation, insert size, and class. Requires sorted input.")
+      ("max-insert", po::value(&controls.max_insert),
+        "Insert size above which joined pairs are long_insert. Default 1000.")
   ;
 
   hidden.add_options()
@@ -84,7 +129,9 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
       emit_version_text();
       std::cout
         << "Usage:" << "\n"
-        << "  " << PROGRAM_NAME << "[OPTIONS] [FILE]" << "\n"
+        << "  " << PROGRAM_NAME << " [OPTIONS] [FILE]" << "\n"
+        << "  " << PROGRAM_NAME << " [OPTIONS] --manifest MANIFEST" << "\n"
+        << "  " << PROGRAM_NAME << " [OPTIONS] --manifest MANIFEST --serve SOCKET" << "\n"
         << desc << "\n";
 
       controls.just_exit = true;
@@ -109,13 +156,32 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
   }
 }
 
-SimpleAlignment make_simple_alignment(AlignmentReader& reader){
+std::vector<GenomicRegion> collect_regions(const AppControlData& control){
+  std::vector<GenomicRegion> regions{};
+
+  for(auto& region_str : control.regions){
+    GenomicRegion region{};
+    if(!parse_region(region_str, region)){
+      throw std::runtime_error(std::string("Malformed region: ") + region_str);
+    }
+    regions.push_back(region);
+  }
+
+  if(!control.regions_path.empty()){
+    std::vector<GenomicRegion> bed_regions{read_bed_regions(control.regions_path)};
+    regions.insert(regions.end(), bed_regions.begin(), bed_regions.end());
+  }
+
+  return merge_regions(regions, control.region_gap);
+}
+
+SimpleAlignment make_simple_alignment(const AlignmentRecord& record){
   return SimpleAlignment(
-      reader.get_query_name(),
-      reader.get_chrom(),
-      reader.get_start(),
-      reader.get_end(),
-      reader.is_forward_strand());
+      record.get_query_name(),
+      record.get_chrom(),
+      record.get_start(),
+      record.get_end(),
+      record.is_forward_strand());
 }
 
 SimpleAlignment make_simple_alignment(const std::string& qname, const std::vector<std::string_view>& fields){
@@ -130,8 +196,7 @@ SimpleAlignment make_simple_alignment(const std::string& qname, const std::vecto
   int pos{0};
   view_to_numeric(fields[1], pos);
 
-  std::vector<std::pair<int, char>> tokens{AlignmentReader::tokenize_cigar(fields[3])};
-  int end{pos + AlignmentReader::reference_span_from_tokens(tokens)};
+  int end{pos + AlignmentReader::reference_span(fields[3])};
 
   return SimpleAlignment(
       std::string(qname),
@@ -141,6 +206,15 @@ SimpleAlignment make_simple_alignment(const std::string& qname, const std::vecto
       is_forward_strand);
 }
 
+SimpleAlignment make_simple_alignment(const std::string& qname, const SaRecord& record){
+  return SimpleAlignment(
+      qname,
+      std::string(record.rname),
+      record.pos,
+      record.pos + record.ref_span,
+      record.is_forward_strand);
+}
+
 std::vector<std::string_view> parse_sa_record(std::string_view record){
 	constexpr std::string_view field_delim{","};
   std::vector<std::string_view> fields{};
@@ -171,55 +245,35 @@ std::vector<std::string_view> parse_sa_record(std::string_view record){
   return fields;
 }
 
-std::vector<SimpleAlignment> sa_value_to_alignments(std::string& qname, std::string_view sa_str){
-  // Each record should be semicolon terminated with comma delimited fields.
-	constexpr std::string_view record_delim{";"};
-	constexpr std::string_view field_delim{","};
-
-  size_t count = std::count_if(sa_str.begin(), sa_str.end(), [](char c){return c == ';';});
+std::vector<SimpleAlignment> sa_value_to_alignments(const std::string& qname, std::string_view sa_str){
   std::vector<SimpleAlignment> result{};
+  SaTagScanner scanner{sa_str};
+  SaRecord record{};
 
-  // Each record should have 6 fields: rname, pos, strand, CIGAR, mapQ, NM
-  std::vector<std::string_view> records{};
-  std::vector<std::string_view> fields;
-
-  result.reserve(count);
-  records.reserve(count);
-  fields.reserve(6);
-
-  size_t record_start{0};
-  size_t record_delim_pos{sa_str.find(record_delim, record_start)};
-  std::string_view rec{};
-
-  while( record_delim_pos != std::string_view::npos && record_delim_pos < sa_str.length() ){
-    rec = sa_str.substr(record_start, record_delim_pos - record_start);
-
-    fields = parse_sa_record(rec);
-    result.push_back(make_simple_alignment(qname, fields));
-
-    record_start = record_delim_pos +1;
-    record_delim_pos = sa_str.find(record_delim, record_start);
+  while(scanner.next(record)){
+    result.push_back(make_simple_alignment(qname, record));
   }
 
   return result;
 }
 
 void add_alignment(bj::object& container, SimpleAlignment& sa,  AlnType aln_type){
+  // Values take the storage of the document, so an arena backed document allocates only from its arena.
+  const bj::storage_ptr& sp{container.storage()};
 
   // reference to top level all_splits or all_pairs
-  bj::object& aln_type_container = container[AlnTypeJsonKeyMap[aln_type]].as_object();
+  bj::object& aln_type_container{container.at(AlnTypeJsonKeys[aln_type]).as_object()};
 
-  if(!aln_type_container.contains(sa.qname)) {
-    aln_type_container[sa.qname] = bj::array{};
-  }
-  aln_type_container[sa.qname].as_array().emplace_back(sa.to_json());
+  // One lookup finds the query name's group or inserts an empty one.
+  auto group{aln_type_container.emplace(sa.qname, bj::array_kind).first};
+  group->value().as_array().emplace_back(sa.to_json(sp));
 }
 
-bj::object init_top_level_json(){
-  bj::object obj {};
+bj::object init_top_level_json(bj::storage_ptr sp){
+  bj::object obj(AlnTypeJsonKeys.size(), sp);
 
-  for(auto const& aln_kv : AlnTypeJsonKeyMap){
-    obj[ aln_kv.second ] = bj::object{};
+  for(std::string_view key : AlnTypeJsonKeys){
+    obj.emplace(key, bj::object_kind);
   }
   return obj;
 }
@@ -235,66 +289,250 @@ void print_counts(Accounting& counts, std::ostream& dest){
     <<" paired: " << counts.paired
     <<" split: " << counts.split
     <<" split_sa: " << counts.split_sa
+    <<std::endl
+    << "ref_cache_hits: " << ReferenceCache::instance().hits()
+    <<" ref_cache_misses: " << ReferenceCache::instance().misses()
+    <<" result_cache_hits: " << ResultCache::instance().hits()
+    <<" result_cache_misses: " << ResultCache::instance().misses()
     <<std::endl;
 }
 
-bool run(const AppControlData& control){
-  bj::object all_data = init_top_level_json();
-  Accounting counts;
-  std::vector<SimpleAlignment> sa_alignments;
+void write_run_stats(const Accounting& counts, const AppControlData& control){
+  if(control.stats_path.empty()){
+    return;
+  }
 
-  try{
-    AlignmentReader reader{control.input_path, control.ref_path};
+  RunStats& stats{RunStats::instance()};
+  stats.add_records(counts.total + counts.qc_fail + counts.unmapped + counts.duplicate + counts.bad_mapq);
+  stats.add_count("total", counts.total);
+  stats.add_count("qc_fail", counts.qc_fail);
+  stats.add_count("unmapped", counts.unmapped);
+  stats.add_count("duplicate", counts.duplicate);
+  stats.add_count("bad_mapq", counts.bad_mapq);
+  stats.add_count("paired", counts.paired);
+  stats.add_count("split", counts.split);
+  stats.add_count("split_sa", counts.split_sa);
+  stats.add_count("ref_cache_hits", ReferenceCache::instance().hits());
+  stats.add_count("ref_cache_misses", ReferenceCache::instance().misses());
+  stats.add_count("result_cache_hits", ResultCache::instance().hits());
+  stats.add_count("result_cache_misses", ResultCache::instance().misses());
+  stats.write(control.stats_path, PROGRAM_NAME,
+              control.manifest_path.empty() ? control.input_path : control.manifest_path);
+}
 
-    while(reader.next_alignment()){
-      // Validity checking
-      if(reader.is_qc_fail()){
-        counts.qc_fail++;
-        continue;
-      }
-      if(reader.is_unmapped()){
-        counts.unmapped++;
-        continue; }
-      if(reader.is_duplicate()){
-        counts.duplicate++;
-        continue;
-      }
-      if(!reader.is_mapq_sufficent()){
-        counts.bad_mapq++;
-        continue;
-      }
-      // Process alignment into output category.
+void classify_record(const AlignmentRecord& record, Accounting& counts, const RecordHandler& handler){
+  // Validity checking. Changes here change summaries, so bump SUMMARY_FORMAT.
+  if(record.is_qc_fail()){
+    counts.qc_fail++;
+    return;
+  }
+  if(record.is_unmapped()){
+    counts.unmapped++;
+    return;
+  }
+  if(record.is_duplicate()){
+    counts.duplicate++;
+    return;
+  }
+  if(!record.is_mapq_sufficent()){
+    counts.bad_mapq++;
+    return;
+  }
+  // Process alignment into output category.
+
+  // Laps on sampled records attribute classification to filter and handling to build.
+  if(record.meets_pair_criteria()){
+    counts.paired++;
+    stage_lap(FILTER);
+    handler(record, nullptr, AlnType::PAIRED);
+    stage_lap(BUILD);
+  }
+  if(record.meets_split_criteria()){
+    // Add the primary alignment to the output data
+    stage_lap(FILTER);
+    handler(record, nullptr, AlnType::SPLIT);
+    stage_lap(BUILD);
+    counts.split++;
+
+    // Add the supplemental alignments to the output data
+    SaTagScanner scanner{record.get_sa_tag()};
+    SaRecord sa_record{};
+    while(scanner.next(sa_record)){
+      stage_lap(FILTER);
+      handler(record, &sa_record, AlnType::SPLIT);
+      stage_lap(BUILD);
+    }
 
-      SimpleAlignment sa = make_simple_alignment(reader);
+    counts.split_sa += record.count_sa_tag();
+  }
 
-      if(reader.meets_pair_criteria()){
-        counts.paired++;
-        add_alignment(all_data, sa, AlnType::PAIRED);
-      }
-      if(reader.meets_split_criteria()){
-        // Add the primary alignment to the output data
-        add_alignment(all_data, sa, AlnType::SPLIT);
-        counts.split++;
-
-        std::string query_name = reader.get_query_name();
-        std::string_view sa_tag = reader.get_sa_tag();
-
-        // Add the supplemental alignment to the output data
-        sa_alignments = sa_value_to_alignments(query_name, sa_tag);
-        for(auto& supplemental_alignment : sa_alignments){
-          add_alignment(all_data, supplemental_alignment, AlnType::SPLIT);
+  counts.total++;
+}
+
+void classify_alignment(const AlignmentRecord& record, Accounting& counts, const AlignmentHandler& handler){
+  // The record's own alignment is built once for both types and its query name reused for SA alignments.
+  std::optional<SimpleAlignment> sa{};
+
+  classify_record(record, counts,
+      [&handler, &sa](const AlignmentRecord& rec, const SaRecord* sa_record, AlnType aln_type){
+        if(!sa){
+          sa = make_simple_alignment(rec);
+        }
+        if(!sa_record){
+          handler(rec, *sa, aln_type);
+          return;
         }
+        SimpleAlignment supplemental_alignment{make_simple_alignment(sa->qname, *sa_record)};
+        handler(rec, supplemental_alignment, aln_type);
+      });
+}
 
-        counts.split_sa += reader.count_sa_tag();
-      }
+void summarize_alignments(AlignmentReader& reader, Accounting& counts, const AlignmentHandler& handler){
+  SampledLoop loop{};
+  for(loop.next_record(); reader.next_alignment(); loop.next_record()){
+    stage_lap(DECODE);
+    classify_alignment(reader, counts, handler);
+    stage_lap(FILTER);
+  }
+}
+
+void summarize_records(AlignmentReader& reader, Accounting& counts, const RecordHandler& handler){
+  SampledLoop loop{};
+  for(loop.next_record(); reader.next_alignment(); loop.next_record()){
+    stage_lap(DECODE);
+    classify_record(reader, counts, handler);
+    stage_lap(FILTER);
+  }
+}
 
-      counts.total++;
+std::unique_ptr<AlignmentReader> open_reader(const std::string& path, const AppControlData& control){
+  auto reader{std::make_unique<AlignmentReader>(path, control.ref_path)};
+  reader->attach_thread_pool(SharedThreadPool::instance().get());
+
+  if(control.minimal_decode){
+    reader->set_required_fields(AlignmentReader::SUMMARY_FIELDS);
+  }
+  return reader;
+}
+
+std::unique_ptr<AlignmentReader> open_input(const std::string& path, const std::vector<GenomicRegion>& regions,
+                                            const AppControlData& control){
+  StageTimer timer{OPEN};
+  std::unique_ptr<AlignmentReader> reader{open_reader(path, control)};
+  if(!regions.empty()){
+    reader->set_regions(regions, control.region_gap);
+  }
+  return reader;
+}
+
+bj::object summarize_document(AlignmentReader& reader, const AppControlData& control, Accounting& counts,
+                              bj::storage_ptr sp){
+  // Alignments go to the store straight from their records, without a SimpleAlignment per alignment.
+  AlignmentStore store{reader.get_contig_names()};
+  summarize_records(reader, counts,
+      [&store](const AlignmentRecord& rec, const SaRecord* sa_record, AlnType aln_type){
+        if(sa_record){
+          store.add(rec.get_query_name_view(), *sa_record, aln_type);
+        } else {
+          store.add(rec, aln_type);
+        }
+      }, control.classify_threads);
+
+  StageTimer timer{BUILD};
+  return store.to_json(std::move(sp));
+}
+
+bool run(const AppControlData& control){
+  try{
+    ResultCache::instance().init(control.cache_dir, control.cache_size_mb << 20, version_string(), SUMMARY_FORMAT);
+  } catch(std::runtime_error& ex){
+    std::cerr<<"Error opening result cache: "<<ex.what()<<"\n";
+    return false;
+  }
+
+  if(!control.serve_path.empty()){
+    return run_server(control);
+  }
+  if(!control.manifest_path.empty()){
+    return run_batch(control);
+  }
+
+  Accounting counts;
+
+  if(!control.stats_path.empty()){
+    RunStats::instance().enable();
+  }
+
+  try{
+    {
+      StageTimer timer{OPEN};
+      SharedThreadPool::instance().init(control.threads);
     }
+    std::vector<GenomicRegion> regions{collect_regions(control)};
+
+    if(control.join_mates){
+      std::unique_ptr<AlignmentReader> input{open_input(control.input_path, regions, control)};
+
+      // Pairs are written as their second mate is read. Split alignments stream as usual.
+      MateJoiner joiner{std::cout, control.max_insert};
+      StreamingWriter writer{std::cout, control.stream_window, control.spill_dir};
+      summarize_alignments(*input, counts,
+          [&joiner, &writer](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+            if(aln_type == AlnType::PAIRED){
+              joiner.add(sa, rec.get_tid(), rec.get_start(),
+                         rec.expects_mate() ? rec.get_mate_tid() : -1, rec.get_mate_start());
+            } else {
+              writer.add(sa, aln_type, rec.get_tid(), rec.get_start(),
+                         rec.expects_mate() ? rec.get_mate_tid() : rec.get_tid(),
+                         rec.expects_mate() ? rec.get_mate_start() : rec.get_start());
+            }
+          }, control.classify_threads);
+
+      StageTimer timer{EMIT};
+      joiner.finish();
+      writer.finish();
+
+      if(RunStats::instance().is_enabled()){
+        RunStats::instance().add_count("joined_pairs", joiner.n_joined());
+        RunStats::instance().add_count("unpaired_mates", joiner.n_unpaired());
+      }
+    } else if(control.stream){
+      std::unique_ptr<AlignmentReader> input{open_input(control.input_path, regions, control)};
+
+      // Emit each query name group as soon as no more alignments can join it.
+      StreamingWriter writer{std::cout, control.stream_window, control.spill_dir};
+      summarize_alignments(*input, counts,
+          [&writer](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+            writer.add(sa, aln_type, rec.get_tid(), rec.get_start(),
+                       rec.expects_mate() ? rec.get_mate_tid() : rec.get_tid(),
+                       rec.expects_mate() ? rec.get_mate_start() : rec.get_start());
+          }, control.classify_threads);
+
+      StageTimer timer{EMIT};
+      writer.finish();
+    } else {
+      // A cached document is printed without opening the input.
+      std::string document{ResultCache::instance().get_or_make(control.input_path, control.ref_path, regions,
+          [&control, &regions, &counts](){
+            std::unique_ptr<AlignmentReader> input{open_input(control.input_path, regions, control)};
+            bj::monotonic_resource arena{};
+            bj::object document{summarize_document(*input, control, counts, &arena)};
+            StageTimer timer{EMIT};
+            return bj::serialize(document);
+          })};
+
+      StageTimer timer{EMIT};
+      std::cout<<document<<std::endl;
+    }
+
+    write_run_stats(counts, control);
   } catch(std::runtime_error& ex){
     std::cerr<<"Error creating CRAM reader: "<<ex.what()<<"\n";
     return false;
   }
 
-  std::cout<<all_data<<std::endl;
+  if(control.print_counts){
+    print_counts(counts, std::cerr);
+  }
   return true;
 }
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <fstream>
+#include <numeric>
+#include <thread>
+#include <unordered_set>
+#include "app.hpp"
+
+namespace bj = boost::json;
+namespace fs = std::filesystem;
+
+std::vector<BatchEntry> read_manifest(const std::string& manifest_path){
+  std::ifstream infile{manifest_path};
+  if(!infile){
+    throw std::runtime_error(std::string("Failed to open manifest: ") + manifest_path);
+  }
+
+  fs::path manifest_dir{fs::path{manifest_path}.parent_path()};
+  std::vector<BatchEntry> entries{};
+  std::unordered_set<std::string> samples_seen{};
+  std::string line{};
+  int line_num{0};
+
+  while(std::getline(infile, line)){
+    line_num++;
+    std::string_view view{line};
+
+    if(view.empty() || view.starts_with('#')){
+      continue;
+    }
+
+    size_t tab_1{view.find('\t')};
+    size_t tab_2{tab_1 == std::string_view::npos ? tab_1 : view.find('\t', tab_1 + 1)};
+
+    BatchEntry entry{};
+    bool is_valid{tab_1 != std::string_view::npos && tab_1 > 0};
+    if(is_valid){
+      entry.sample = std::string(view.substr(0, tab_1));
+      entry.path = std::string(view.substr(tab_1 + 1, tab_2 - tab_1 - 1));
+      is_valid = !entry.path.empty();
+    }
+
+    // Optional third column of comma delimited regions.
+    if(is_valid && tab_2 != std::string_view::npos){
+      is_valid = parse_region_list(view.substr(tab_2 + 1), entry.regions);
+    }
+
+    if(!is_valid){
+      throw std::runtime_error(
+          std::string("Malformed manifest line ") + std::to_string(line_num) + " in " + manifest_path);
+    }
+
+    if(fs::path{entry.path}.is_relative()){
+      entry.path = (manifest_dir / entry.path).string();
+    }
+
+    if(!samples_seen.insert(entry.sample).second){
+      throw std::runtime_error(std::string("Duplicate sample in manifest: ") + entry.sample);
+    }
+
+    entries.push_back(entry);
+  }
+
+  return entries;
+}
+
+/* Summarize one manifest entry into its own document. */
+static bj::object summarize_entry(const BatchEntry& entry, const AppControlData& control,
+                                  const std::vector<GenomicRegion>& default_regions, Accounting& counts){
+  std::vector<GenomicRegion> regions{
+    entry.regions.empty() ? default_regions : merge_regions(entry.regions, control.region_gap)};
+
+  if(!ResultCache::instance().is_enabled()){
+    return summarize_document(*open_input(entry.path, regions, control), control, counts);
+  }
+
+  std::string document{ResultCache::instance().get_or_make(entry.path, control.ref_path, regions,
+      [&entry, &regions, &control, &counts](){
+        bj::object document{summarize_document(*open_input(entry.path, regions, control), control, counts)};
+        StageTimer timer{EMIT};
+        return bj::serialize(document);
+      })};
+  return bj::parse(document).as_object();
+}
+
+bj::object summarize_batch(const std::vector<BatchEntry>& entries, const AppControlData& control,
+                           Accounting& counts){
+  std::vector<GenomicRegion> default_regions{collect_regions(control)};
+
+  // Hand out the largest files first so one long job does not start last and leave other workers idle.
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<uintmax_t> sizes(entries.size(), 0);
+  for(size_t i{0}; i < entries.size(); i++){
+    std::error_code ec{};
+    uintmax_t size{fs::file_size(entries[i].path, ec)};
+    sizes[i] = ec ? 0 : size;
+  }
+  std::stable_sort(order.begin(), order.end(),
+      [&sizes](size_t a, size_t b){ return sizes[a] > sizes[b]; });
+
+  // Each job writes only its own slot, so workers share nothing but the job cursor.
+  std::vector<bj::object> results(entries.size());
+  std::vector<Accounting> job_counts(entries.size());
+  std::vector<std::exception_ptr> errors(entries.size());
+  std::atomic<size_t> next_job{0};
+
+  auto worker = [&](){
+    for(size_t job{next_job++}; job < order.size(); job = next_job++){
+      size_t idx{order[job]};
+      try{
+        results[idx] = summarize_entry(entries[idx], control, default_regions, job_counts[idx]);
+      } catch(...){
+        errors[idx] = std::current_exception();
+      }
+    }
+  };
+
+  size_t n_workers{std::clamp<size_t>(control.workers, 1, std::max<size_t>(entries.size(), 1))};
+  std::vector<std::thread> workers{};
+  for(size_t i{1}; i < n_workers; i++){
+    workers.emplace_back(worker);
+  }
+  worker();
+  for(auto& thread : workers){
+    thread.join();
+  }
+
+  bj::object batch_data{};
+  for(size_t i{0}; i < entries.size(); i++){
+    if(errors[i]){
+      try{
+        std::rethrow_exception(errors[i]);
+      } catch(std::exception& ex){
+        throw std::runtime_error(std::string("Sample ") + entries[i].sample + ": " + ex.what());
+      }
+    }
+
+    counts += job_counts[i];
+    batch_data[entries[i].sample] = std::move(results[i]);
+  }
+
+  return batch_data;
+}
+
+bool run_batch(const AppControlData& control){
+  if(control.stream || control.join_mates){
+    std::cerr<<"Streaming output is not supported with a manifest.\n";
+    return false;
+  }
+
+  Accounting counts;
+
+  if(!control.stats_path.empty()){
+    RunStats::instance().enable();
+  }
+
+  try{
+    SharedThreadPool::instance().init(control.threads);
+
+    std::vector<BatchEntry> entries{read_manifest(control.manifest_path)};
+    bj::object batch_data{summarize_batch(entries, control, counts)};
+    {
+      StageTimer timer{EMIT};
+      std::cout<<batch_data<<std::endl;
+    }
+
+    write_run_stats(counts, control);
+  } catch(std::runtime_error& ex){
+    std::cerr<<"Error summarizing batch: "<<ex.what()<<"\n";
+    return false;
+  }
+
+  if(control.print_counts){
+    print_counts(counts, std::cerr);
+  }
+  return true;
+}
@@ -1,17 +1,14 @@
-#include <iostream>
 #include <string>
 #include <stdexcept>
-#include <sstream>
 #include <vector>
-#include <algorithm>
-#include <cctype>
 #include "cram_reader.hpp"
-#include "app_utils.hpp"
+#include "reference_cache.hpp"
 #include "htslib/hts_log.h"
 #include "htslib/hts.h"
 #include "htslib/sam.h"
 
-AlignmentReader::AlignmentReader(const std::string& in_path, const std::string& ref_path, const bool silent)
+AlignmentReader::AlignmentReader(const std::string& in_path, const std::string& ref_path, const bool silent) :
+  AlignmentRecord(nullptr, nullptr)
 {
   if(silent){
     hts_set_log_level(HTS_LOG_OFF);
@@ -22,172 +19,130 @@ AlignmentReader::AlignmentReader(const std::string& in_path, const std::string&
     throw std::runtime_error(std::string("Failed to open file: ") + in_path);
   }
 
+  m_in_path = in_path;
+
   header = sam_hdr_read(infile);
+  if(!header){
+    hts_close(infile);
+    throw std::runtime_error(std::string("Failed to read header: ") + in_path);
+  }
+
+  // Decode CRAMs against the given fasta using reference sequence shared by all readers.
+  if(!ref_path.empty() && hts_get_format(infile)->format == cram){
+    try{
+      ReferenceCache::instance().attach(infile, header, in_path, ref_path);
+    } catch(std::runtime_error& ex){
+      sam_hdr_destroy(header);
+      hts_close(infile);
+      throw;
+    }
+  }
+
+  // Contig names by tid, so alignments can be placed without copying their contig name.
+  m_contig_names.reserve(sam_hdr_nref(header));
+  for(int tid{0}; tid < sam_hdr_nref(header); tid++){
+    m_contig_names.emplace_back(sam_hdr_tid2name(header, tid));
+  }
+
   alignment = bam_init1();
+  m_header = header;
+  m_alignment = alignment;
 }
 
 AlignmentReader::~AlignmentReader(){
+  hts_itr_destroy(iterator);
+  hts_idx_destroy(index);
   bam_destroy1(alignment);
   sam_hdr_destroy(header);
   hts_close(infile);
 }
 
 bool AlignmentReader::next_alignment(){
-
-  int ret_val{0};
-
-  ret_val = sam_read1(infile, header, alignment);
-  return ret_val == -1 ? false: true;
+  return read_into(alignment);
 }
 
+bool AlignmentReader::read_into(bam1_t* record){
 
-/*******************
- * Field Accessors *
- ******************/
-uint32_t AlignmentReader::get_n_cigar(){
-  return alignment->core.n_cigar;
-}
-
-std::string AlignmentReader::get_cigar_string(){
-  uint32_t n_cigar{this->get_n_cigar()};
-  uint32_t* cigar{bam_get_cigar(alignment)};
-
-  std::ostringstream sstream;
-  uint32_t operation{};
-  uint32_t op_len{};
-  char op_chr{};
-
-  for(int i = 0; i < n_cigar; i++){
-    operation = bam_cigar_op(cigar[i]);
-    op_len = bam_cigar_oplen(cigar[i]);
-    op_chr = bam_cigar_opchr(cigar[i]);
+  int ret_val{0};
 
-    sstream << op_len << op_chr;
+  if(iterator){
+    ret_val = sam_itr_next(infile, iterator, record);
+  } else {
+    ret_val = sam_read1(infile, header, record);
   }
-
-  return sstream.str();
-}
-
-std::string AlignmentReader::get_query_name(){
-  return std::string( bam_get_qname(alignment) );
-}
-
-std::string_view AlignmentReader::get_sa_tag(){
-  kstring_t kstr;
-  ks_initialize(&kstr);
-  int retcode = bam_aux_get_str(alignment,"SA", &kstr);
-
-  return retcode == 1 ? std::string_view(kstr.s) : "";
-}
-
-bool AlignmentReader::is_forward_strand(){
-  return !bam_is_rev(alignment);
-}
-
-int64_t AlignmentReader::get_start(){
-  return alignment->core.pos;
+  if(ret_val == -1){
+    return false;
+  }else if(ret_val < -1){
+    throw std::runtime_error(std::string("Error reading next alignment: ") + m_in_path);
+  }
+  return true;
 }
 
-std::string AlignmentReader::get_chrom(){
-  int tid = alignment->core.tid;
-  return std::string(header->target_name[tid]);
+const sam_hdr_t* AlignmentReader::get_header(){
+  return header;
 }
 
-/****************
- * Process Data *
- ***************/
-
-int AlignmentReader::count_sa_tag(){
-  std::string_view sa_str = get_sa_tag();
-  return std::count_if(sa_str.begin(), sa_str.end(), [](char c){return c == ';';});
+const std::vector<std::string_view>& AlignmentReader::get_contig_names() const{
+  return m_contig_names;
 }
 
-std::vector<std::pair<int, char>> AlignmentReader::tokenize_cigar(const std::string_view cigar){
-  std::string_view digits{"0123456789"};
-  std::vector<std::pair<int, char>> tokens{};
-  size_t position{0};
-  size_t op_position{0};
-  int count{0};
-  char operation{};
-
-  while(position < cigar.length()){
-    // position of the next operation charater
-    op_position = cigar.find_first_not_of(digits, position);
-    operation = cigar.at(op_position);
-
-    // count preceeds the operation character
-    view_to_numeric(cigar.substr(position, op_position-position), count);
+void AlignmentReader::set_regions(const std::vector<GenomicRegion>& regions, const int64_t gap){
+  if(!index){
+    index = sam_index_load(infile, m_in_path.data());
+  }
+  if(!index){
+    throw std::runtime_error(std::string("Failed to load index for: ") + m_in_path);
+  }
 
-    tokens.push_back(std::make_pair(count, operation));
+  std::vector<std::string> region_strs{};
+  std::vector<char*> region_ptrs{};
 
-    position = op_position + 1;
+  // Contig names with colons are only told apart from ranges by the header.
+  std::vector<GenomicRegion> resolved{regions};
+  for(auto& region : resolved){
+    resolve_region(region, [this](const std::string& name){ return sam_hdr_name2tid(header, name.data()) >= 0; });
   }
 
-  return tokens;
-}
-
-int AlignmentReader::reference_span_from_tokens(const std::vector<std::pair<int, char>>& tokens){
-  int sum{0};
-
-  for( auto &token : tokens ){
-    switch(std::get<char>(token)) {
-      case 'M':
-      case 'D':
-      case 'N':
-      case 'X':
-        sum += std::get<int>(token);
-      default:
-        break;
+  for(auto& region : merge_regions(resolved, gap)){
+    if(sam_hdr_name2tid(header, region.chr.data()) < 0){
+      throw std::runtime_error(std::string("Region contig not in header: ") + region.chr);
     }
+    region_strs.push_back(region.to_string());
+  }
+  for(auto& region_str : region_strs){
+    region_ptrs.push_back(region_str.data());
   }
-  return sum;
-}
 
-int AlignmentReader::reference_span(const std::string& cigar){
-  std::vector<std::pair<int, char>> tokens{tokenize_cigar(cigar)};
-  return reference_span_from_tokens(tokens);
+  // Replace any prior query. Multi-region iterator reads each overlapping container once.
+  hts_itr_destroy(iterator);
+  iterator = sam_itr_regarray(index, header, region_ptrs.data(), region_ptrs.size());
+  if(!iterator){
+    throw std::runtime_error(std::string("Failed to query regions for: ") + m_in_path);
+  }
 }
 
-int AlignmentReader::reference_span(const std::string_view& cigar){
-  std::vector<std::pair<int, char>> tokens{tokenize_cigar(cigar)};
-  return reference_span_from_tokens(tokens);
-}
 
-int64_t AlignmentReader::get_end(){
-  return alignment->core.pos + reference_span(get_cigar_string());
-}
+void AlignmentReader::attach_thread_pool(htsThreadPool* pool){
+  if(!pool){
+    return;
+  }
 
-/*****************
- * Flag Checking *
- ****************/
-bool AlignmentReader::is_paired(){        return alignment->core.flag & BAM_FPAIRED; }
-bool AlignmentReader::is_proper_pair(){   return alignment->core.flag & BAM_FPROPER_PAIR; }
-bool AlignmentReader::is_unmapped(){      return alignment->core.flag & BAM_FUNMAP; }
-bool AlignmentReader::is_mate_unmapped(){       return alignment->core.flag & BAM_FMUNMAP; }
-bool AlignmentReader::is_reverse_strand(){      return alignment->core.flag & BAM_FREVERSE; }
-bool AlignmentReader::is_mate_reverse_strand(){ return alignment->core.flag & BAM_FMREVERSE; }
-bool AlignmentReader::is_read_1(){        return alignment->core.flag & BAM_FREAD1; }
-bool AlignmentReader::is_read_2(){        return alignment->core.flag & BAM_FREAD2; }
-bool AlignmentReader::is_secondary(){     return alignment->core.flag & BAM_FSECONDARY; }
-bool AlignmentReader::is_qc_fail(){       return alignment->core.flag & BAM_FQCFAIL; }
-bool AlignmentReader::is_duplicate(){     return alignment->core.flag & BAM_FDUP; }
-bool AlignmentReader::is_supplementary(){ return alignment->core.flag & BAM_FSUPPLEMENTARY; }
-
-/*******************
- * Status Checking *
- ******************/
-bool AlignmentReader::has_sa_tag(){
-  return bam_aux_get(alignment,"SA");
+  if(hts_set_thread_pool(infile, pool) != 0){
+    throw std::runtime_error(std::string("Failed to attach thread pool for: ") + m_in_path);
+  }
 }
 
-bool AlignmentReader::is_mapq_sufficent(){
-  return alignment->core.qual > 1 && alignment->core.qual < 255;
-}
 
-bool AlignmentReader::meets_pair_criteria(){
-  return !is_unmapped() && !is_secondary() && !is_supplementary() && is_paired();
-}
+void AlignmentReader::set_required_fields(const int fields){
+  if(hts_get_format(infile)->format != cram){
+    return;
+  }
 
-bool AlignmentReader::meets_split_criteria(){
-  return !is_secondary() && !is_supplementary() && has_sa_tag();
+  // Regenerating MD & NM tags requires decoding the sequence.
+  int decode_md{fields & SAM_SEQ ? 1 : 0};
+
+  if(hts_set_opt(infile, CRAM_OPT_REQUIRED_FIELDS, fields) != 0 ||
+     hts_set_opt(infile, CRAM_OPT_DECODE_MD, decode_md) != 0){
+    throw std::runtime_error(std::string("Failed to set required fields for: ") + m_in_path);
+  }
 }
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include "genomic_region.hpp"
+#include "app_utils.hpp"
+
+// End coordinate used when region extends to end of contig.
+static constexpr int64_t OPEN_END{std::numeric_limits<int64_t>::max()};
+
+std::string GenomicRegion::to_string() const{
+  // Braces protect contig names that contain colons e.g. HLA alleles.
+  std::string result{"{" + chr + "}"};
+
+  if(start == 0 && end == OPEN_END){
+    return result;
+  }
+
+  result += ":" + std::to_string(start + 1);
+  if(end != OPEN_END){
+    result += "-" + std::to_string(end);
+  }
+  return result;
+}
+
+/* Parse range of 1-based inclusive start[-end] into 0-based half-open start and end. */
+static bool parse_range(std::string_view range, int64_t& start, int64_t& end){
+  size_t dash_pos{range.find('-')};
+  int64_t beg{0};
+  end = OPEN_END;
+
+  if(!view_to_numeric(range.substr(0, dash_pos), beg) || beg < 1){
+    return false;
+  }
+  if(dash_pos != std::string_view::npos){
+    if(!view_to_numeric(range.substr(dash_pos + 1), end) || end < beg){
+      return false;
+    }
+  }
+
+  start = beg - 1;
+  return true;
+}
+
+bool parse_region(std::string_view region_str, GenomicRegion& region){
+  if(region_str.empty()){
+    return false;
+  }
+
+  // Braced contig name, optionally followed by a range.
+  if(region_str.front() == '{'){
+    size_t close_pos{region_str.find('}')};
+    if(close_pos == std::string_view::npos || close_pos == 1){
+      return false;
+    }
+    std::string_view chr{region_str.substr(1, close_pos - 1)};
+    std::string_view rest{region_str.substr(close_pos + 1)};
+
+    region = GenomicRegion{std::string(chr), 0, OPEN_END};
+    if(rest.empty()){
+      return true;
+    }
+    return rest.front() == ':' && parse_range(rest.substr(1), region.start, region.end);
+  }
+
+  size_t colon_pos{region_str.rfind(':')};
+
+  // Whole contig
+  if(colon_pos == std::string_view::npos){
+    region = GenomicRegion{std::string(region_str), 0, OPEN_END};
+    return true;
+  }
+
+  std::string_view chr{region_str.substr(0, colon_pos)};
+  int64_t start{0};
+  int64_t end{OPEN_END};
+  if(chr.empty() || !parse_range(region_str.substr(colon_pos + 1), start, end)){
+    return false;
+  }
+
+  region = GenomicRegion{std::string(chr), start, end, std::string(region_str)};
+  return true;
+}
+
+void resolve_region(GenomicRegion& region, const std::function<bool(const std::string&)>& is_contig){
+  if(region.whole_contig.empty()){
+    return;
+  }
+
+  if(is_contig(region.whole_contig)){
+    if(is_contig(region.chr)){
+      throw std::runtime_error(std::string("Ambiguous region, use {") + region.chr + "} or {" +
+                               region.whole_contig + "}: " + region.whole_contig);
+    }
+    region = GenomicRegion{region.whole_contig, 0, OPEN_END};
+    return;
+  }
+  region.whole_contig.clear();
+}
+
+bool parse_region_list(std::string_view regions_str, std::vector<GenomicRegion>& regions){
+  while(!regions_str.empty()){
+    size_t comma{regions_str.find(',')};
+    GenomicRegion region{};
+    if(!parse_region(regions_str.substr(0, comma), region)){
+      return false;
+    }
+    regions.push_back(region);
+    regions_str = comma == std::string_view::npos ? std::string_view{} : regions_str.substr(comma + 1);
+  }
+  return true;
+}
+
+std::vector<GenomicRegion> read_bed_regions(const std::string& bed_path){
+  std::ifstream infile{bed_path};
+  if(!infile){
+    throw std::runtime_error(std::string("Failed to open regions file: ") + bed_path);
+  }
+
+  std::vector<GenomicRegion> regions{};
+  std::string line{};
+  int line_num{0};
+
+  while(std::getline(infile, line)){
+    line_num++;
+    std::string_view view{line};
+
+    if(view.empty() || view.starts_with('#') || view.starts_with("track") || view.starts_with("browser")){
+      continue;
+    }
+
+    // chrom, chromStart, chromEnd are the first three tab delimited columns.
+    size_t tab_1{view.find('\t')};
+    size_t tab_2{tab_1 == std::string_view::npos ? tab_1 : view.find('\t', tab_1 + 1)};
+    size_t tab_3{tab_2 == std::string_view::npos ? tab_2 : view.find('\t', tab_2 + 1)};
+
+    GenomicRegion region{};
+    bool is_valid{tab_2 != std::string_view::npos};
+    if(is_valid){
+      region.chr = std::string(view.substr(0, tab_1));
+      is_valid = view_to_numeric(view.substr(tab_1 + 1, tab_2 - tab_1 - 1), region.start) &&
+                 view_to_numeric(view.substr(tab_2 + 1, tab_3 - tab_2 - 1), region.end) &&
+                 region.start >= 0 && region.end >= region.start;
+    }
+
+    if(!is_valid){
+      throw std::runtime_error(
+          std::string("Malformed BED line ") + std::to_string(line_num) + " in " + bed_path);
+    }
+
+    regions.push_back(region);
+  }
+
+  return regions;
+}
+
+std::vector<GenomicRegion> merge_regions(const std::vector<GenomicRegion>& regions, const int64_t gap){
+  // Rank contigs by first appearance to keep the caller's contig order.
+  std::unordered_map<std::string, size_t> contig_rank{};
+  for(auto& region : regions){
+    contig_rank.emplace(region.chr, contig_rank.size());
+  }
+
+  std::vector<GenomicRegion> sorted{regions};
+  std::sort(sorted.begin(), sorted.end(),
+      [&contig_rank](const GenomicRegion& a, const GenomicRegion& b){
+        size_t rank_a{contig_rank.at(a.chr)};
+        size_t rank_b{contig_rank.at(b.chr)};
+        return rank_a != rank_b ? rank_a < rank_b : a.start < b.start;
+      });
+
+  std::vector<GenomicRegion> merged{};
+  for(auto& region : sorted){
+    if(!merged.empty() && merged.back().chr == region.chr && merged.back().whole_contig == region.whole_contig &&
+        (merged.back().end == OPEN_END || region.start <= merged.back().end + gap)){
+      merged.back().end = std::max(merged.back().end, region.end);
+    }else{
+      merged.push_back(region);
+    }
+  }
+
+  return merged;
+}
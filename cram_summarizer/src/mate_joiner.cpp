@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <stdexcept>
+#include "mate_joiner.hpp"
+#include "boost/json.hpp"
+
+namespace bj = boost::json;
+
+bool MateJoiner::Expiry::operator>(const Expiry& other) const{
+  if(mate_tid != other.mate_tid){
+    return mate_tid > other.mate_tid;
+  }
+  return mate_pos != other.mate_pos ? mate_pos > other.mate_pos : seq > other.seq;
+}
+
+MateJoiner::MateJoiner(std::ostream& out, const int64_t max_insert) :
+  m_out(out), m_max_insert(max_insert) {}
+
+size_t MateJoiner::n_pending() const{ return m_pending.size(); }
+int64_t MateJoiner::n_joined() const{ return m_n_joined; }
+int64_t MateJoiner::n_unpaired() const{ return m_n_unpaired; }
+
+void MateJoiner::add(const SimpleAlignment& sa, const int32_t tid, const int64_t pos,
+                     const int32_t mate_tid, const int64_t mate_pos){
+  if(tid < m_tid || (tid == m_tid && pos < m_pos)){
+    throw std::runtime_error("Joining mates requires coordinate sorted input.");
+  }
+
+  expire_before(tid, pos);
+  m_tid = tid;
+  m_pos = pos;
+
+  auto pending_it{m_pending.find(sa.qname)};
+  if(pending_it != m_pending.end()){
+    write_pair(pending_it->second.sa, pending_it->second.tid, sa, tid);
+    m_pending.erase(pending_it);
+    return;
+  }
+
+  // Mate already passed without being seen, or never will be.
+  if(mate_tid < tid || (mate_tid == tid && mate_pos < pos)){
+    write_unpaired(sa);
+    return;
+  }
+
+  m_pending[sa.qname] = Pending{sa, tid, m_seq};
+  m_expiry.push(Expiry{mate_tid, mate_pos, m_seq, sa.qname});
+  m_seq++;
+}
+
+void MateJoiner::finish(){
+  expire_before(INT32_MAX, INT64_MAX);
+}
+
+void MateJoiner::expire_before(const int32_t tid, const int64_t pos){
+  while(!m_expiry.empty() &&
+        (m_expiry.top().mate_tid < tid || (m_expiry.top().mate_tid == tid && m_expiry.top().mate_pos < pos))){
+    auto pending_it{m_pending.find(m_expiry.top().qname)};
+
+    // Skip entries of first mates already joined, including a later first mate of the same name.
+    if(pending_it != m_pending.end() && pending_it->second.seq == m_expiry.top().seq){
+      write_unpaired(pending_it->second.sa);
+      m_pending.erase(pending_it);
+    }
+    m_expiry.pop();
+  }
+}
+
+void MateJoiner::write_pair(const SimpleAlignment& first, const int32_t first_tid,
+                            const SimpleAlignment& second, const int32_t second_tid){
+  bj::object line{};
+  line["qname"] = first.qname;
+
+  bj::array pair{};
+  pair.reserve(2);
+  pair.emplace_back(first.to_json());
+  pair.emplace_back(second.to_json());
+  line["pair"] = std::move(pair);
+
+  line["orientation"] = std::string{first.strand ? 'F' : 'R', second.strand ? 'F' : 'R'};
+
+  std::string_view pair_class{"concordant"};
+  if(first_tid != second_tid){
+    line["insert_size"] = nullptr;
+    pair_class = "interchromosomal";
+  } else {
+    int64_t insert_size{std::max(first.end, second.end) - std::min(first.start, second.start)};
+    line["insert_size"] = insert_size;
+
+    if(first.strand == second.strand){
+      pair_class = "inverted";
+    } else if(!first.strand){
+      pair_class = "everted";
+    } else if(insert_size > m_max_insert){
+      pair_class = "long_insert";
+    }
+  }
+  line["class"] = pair_class;
+
+  m_out << bj::serialize(line) << '\n';
+  m_n_joined++;
+}
+
+void MateJoiner::write_unpaired(const SimpleAlignment& sa){
+  bj::object line{};
+  line["qname"] = sa.qname;
+
+  bj::array pair{};
+  pair.emplace_back(sa.to_json());
+  line["pair"] = std::move(pair);
+
+  line["orientation"] = nullptr;
+  line["insert_size"] = nullptr;
+  line["class"] = "unpaired";
+
+  m_out << bj::serialize(line) << '\n';
+  m_n_unpaired++;
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <new>
+#include <thread>
+#include <vector>
+#include "app.hpp"
+#include "htslib/sam.h"
+
+namespace {
+
+// Alignment produced by a classifier and the index of its record in the batch.
+struct ClassifiedAlignment {
+  typedef AlignmentHandler Handler;
+  uint32_t record_idx{0};
+  AlnType aln_type{AlnType::SPLIT};
+  SimpleAlignment alignment{};
+};
+
+// As ClassifiedAlignment for record handlers. Views of the SA record stay valid while the batch holds its record.
+struct ClassifiedRecord {
+  typedef RecordHandler Handler;
+  uint32_t record_idx{0};
+  AlnType aln_type{AlnType::SPLIT};
+  bool is_supplemental{false};
+  SaRecord sa_record{};
+};
+
+void classify_into(std::vector<ClassifiedAlignment>& classified, const AlignmentRecord& record,
+                   const uint32_t record_idx, Accounting& counts){
+  classify_alignment(record, counts,
+      [&classified, record_idx](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        classified.push_back(ClassifiedAlignment{record_idx, aln_type, sa});
+      });
+}
+
+void classify_into(std::vector<ClassifiedRecord>& classified, const AlignmentRecord& record,
+                   const uint32_t record_idx, Accounting& counts){
+  classify_record(record, counts,
+      [&classified, record_idx](const AlignmentRecord& rec, const SaRecord* sa_record, AlnType aln_type){
+        classified.push_back(ClassifiedRecord{record_idx, aln_type, sa_record != nullptr,
+                                              sa_record ? *sa_record : SaRecord{}});
+      });
+}
+
+void handle(const AlignmentHandler& handler, const AlignmentRecord& record, ClassifiedAlignment& entry){
+  handler(record, entry.alignment, entry.aln_type);
+}
+
+void handle(const RecordHandler& handler, const AlignmentRecord& record, ClassifiedRecord& entry){
+  handler(record, entry.is_supplemental ? &entry.sa_record : nullptr, entry.aln_type);
+}
+
+/*
+ * Batch of recycled records passed around the ring of slots. The turn encodes which stage owns it:
+ *   3 * seq      reader fills batch seq
+ *   3 * seq + 1  a classifier classifies batch seq
+ *   3 * seq + 2  emitter hands batch seq to the handler
+ * The emitter then passes the slot to the reader for batch seq + number of slots.
+ */
+template <typename Entry>
+struct Slot {
+  std::atomic<uint64_t> turn{0};
+  std::vector<bam1_t*> records{};
+  size_t n_records{0};
+  // Marks end of input. Each classifier exits at the first end batch it claims.
+  bool is_end{false};
+  std::vector<Entry> classified{};
+};
+
+void wait_for_turn(std::atomic<uint64_t>& turn, const uint64_t expected){
+  for(uint64_t current{turn.load(std::memory_order_acquire)}; current != expected;
+      current = turn.load(std::memory_order_acquire)){
+    turn.wait(current, std::memory_order_acquire);
+  }
+}
+
+void pass_turn(std::atomic<uint64_t>& turn, const uint64_t next){
+  turn.store(next, std::memory_order_release);
+  turn.notify_all();
+}
+
+// Entry is the classifier output kept per alignment: ClassifiedAlignment or ClassifiedRecord.
+template <typename Entry>
+class AlignmentPipeline {
+  public:
+    typedef typename Entry::Handler Handler;
+
+    AlignmentPipeline(AlignmentReader& reader, const int n_classifiers, const size_t batch_size);
+    ~AlignmentPipeline();
+
+    void run(Accounting& counts, const Handler& handler);
+
+  private:
+    void read_stage();
+    void classify_stage(Accounting& counts, std::exception_ptr& error);
+    void emit_stage(const Handler& handler);
+    Slot<Entry>& slot_for(const uint64_t seq){ return m_slots[seq % m_slots.size()]; }
+
+    AlignmentReader& m_reader;
+    const sam_hdr_t* m_header{nullptr};
+    size_t m_n_classifiers{1};
+    size_t m_batch_size{1};
+    std::vector<Slot<Entry>> m_slots;
+    std::atomic<uint64_t> m_next_classify{0};
+    // Set when a stage fails. Reader stops and remaining batches drain without handling.
+    std::atomic<bool> m_abort{false};
+    std::exception_ptr m_read_error{};
+    std::exception_ptr m_emit_error{};
+};
+
+template <typename Entry>
+AlignmentPipeline<Entry>::AlignmentPipeline(AlignmentReader& reader, const int n_classifiers, const size_t batch_size) :
+  m_reader(reader),
+  m_header(reader.get_header()),
+  m_n_classifiers(n_classifiers),
+  m_batch_size(std::max<size_t>(batch_size, 1)),
+  // Enough slots for every classifier to hold one batch while the reader and emitter hold others.
+  m_slots(2 * n_classifiers + 2)
+{
+  for(size_t i{0}; i < m_slots.size(); i++){
+    m_slots[i].turn.store(3 * i);
+  }
+}
+
+template <typename Entry>
+AlignmentPipeline<Entry>::~AlignmentPipeline(){
+  for(auto& slot : m_slots){
+    for(bam1_t* record : slot.records){
+      bam_destroy1(record);
+    }
+  }
+}
+
+// Wall time of each stage thread includes waits on its neighbouring stages. CPU time does not.
+template <typename Entry>
+void AlignmentPipeline<Entry>::read_stage(){
+  StageTimer timer{DECODE};
+  uint64_t seq{0};
+  bool has_more{true};
+
+  for(; has_more && !m_abort.load(std::memory_order_relaxed); seq++){
+    Slot<Entry>& slot{slot_for(seq)};
+    wait_for_turn(slot.turn, 3 * seq);
+
+    slot.n_records = 0;
+    slot.is_end = false;
+    try{
+      while(slot.n_records < m_batch_size){
+        if(slot.n_records == slot.records.size()){
+          // Slot holds the entry before allocating so a failed push_back cannot leak a record.
+          slot.records.push_back(nullptr);
+          slot.records.back() = bam_init1();
+          if(!slot.records.back()){
+            slot.records.pop_back();
+            throw std::bad_alloc();
+          }
+        }
+        if(!m_reader.read_into(slot.records[slot.n_records])){
+          has_more = false;
+          break;
+        }
+        slot.n_records++;
+      }
+    } catch(...){
+      // Batch still moves on so the other stages drain and exit.
+      m_read_error = std::current_exception();
+      m_abort.store(true);
+      has_more = false;
+    }
+
+    pass_turn(slot.turn, 3 * seq + 1);
+  }
+
+  for(size_t i{0}; i < m_n_classifiers; i++, seq++){
+    Slot<Entry>& slot{slot_for(seq)};
+    wait_for_turn(slot.turn, 3 * seq);
+    slot.n_records = 0;
+    slot.is_end = true;
+    pass_turn(slot.turn, 3 * seq + 1);
+  }
+}
+
+template <typename Entry>
+void AlignmentPipeline<Entry>::classify_stage(Accounting& counts, std::exception_ptr& error){
+  StageTimer timer{FILTER};
+
+  while(true){
+    uint64_t seq{m_next_classify.fetch_add(1)};
+    Slot<Entry>& slot{slot_for(seq)};
+    wait_for_turn(slot.turn, 3 * seq + 1);
+
+    bool is_end{slot.is_end};
+    slot.classified.clear();
+
+    if(!is_end && !m_abort.load(std::memory_order_relaxed)){
+      try{
+        for(uint32_t record_idx{0}; record_idx < slot.n_records; record_idx++){
+          classify_into(slot.classified, AlignmentRecord{m_header, slot.records[record_idx]}, record_idx, counts);
+        }
+      } catch(...){
+        error = std::current_exception();
+        m_abort.store(true);
+      }
+    }
+
+    pass_turn(slot.turn, 3 * seq + 2);
+    if(is_end){
+      return;
+    }
+  }
+}
+
+template <typename Entry>
+void AlignmentPipeline<Entry>::emit_stage(const Handler& handler){
+  StageTimer timer{BUILD};
+  for(uint64_t seq{0};; seq++){
+    Slot<Entry>& slot{slot_for(seq)};
+    wait_for_turn(slot.turn, 3 * seq + 2);
+
+    bool is_end{slot.is_end};
+    if(!is_end && !m_abort.load(std::memory_order_relaxed)){
+      try{
+        for(auto& entry : slot.classified){
+          handle(handler, AlignmentRecord{m_header, slot.records[entry.record_idx]}, entry);
+        }
+      } catch(...){
+        m_emit_error = std::current_exception();
+        m_abort.store(true);
+      }
+    }
+
+    pass_turn(slot.turn, 3 * (seq + m_slots.size()));
+    if(is_end){
+      return;
+    }
+  }
+}
+
+template <typename Entry>
+void AlignmentPipeline<Entry>::run(Accounting& counts, const Handler& handler){
+  std::vector<Accounting> worker_counts(m_n_classifiers);
+  std::vector<std::exception_ptr> worker_errors(m_n_classifiers);
+
+  std::thread reader_thread{&AlignmentPipeline::read_stage, this};
+  std::vector<std::thread> classifier_threads{};
+  for(size_t i{0}; i < m_n_classifiers; i++){
+    classifier_threads.emplace_back(&AlignmentPipeline::classify_stage, this,
+                                    std::ref(worker_counts[i]), std::ref(worker_errors[i]));
+  }
+
+  emit_stage(handler);
+
+  reader_thread.join();
+  for(auto& thread : classifier_threads){
+    thread.join();
+  }
+
+  if(m_read_error){
+    std::rethrow_exception(m_read_error);
+  }
+  if(m_emit_error){
+    std::rethrow_exception(m_emit_error);
+  }
+  for(size_t i{0}; i < m_n_classifiers; i++){
+    if(worker_errors[i]){
+      std::rethrow_exception(worker_errors[i]);
+    }
+    counts += worker_counts[i];
+  }
+}
+
+} // namespace
+
+void summarize_alignments(AlignmentReader& reader, Accounting& counts, const AlignmentHandler& handler,
+                          const int n_classifiers, const size_t batch_size){
+  if(n_classifiers < 1){
+    summarize_alignments(reader, counts, handler);
+    return;
+  }
+
+  AlignmentPipeline<ClassifiedAlignment> pipeline{reader, n_classifiers, batch_size};
+  pipeline.run(counts, handler);
+}
+
+void summarize_records(AlignmentReader& reader, Accounting& counts, const RecordHandler& handler,
+                       const int n_classifiers, const size_t batch_size){
+  if(n_classifiers < 1){
+    summarize_records(reader, counts, handler);
+    return;
+  }
+
+  AlignmentPipeline<ClassifiedRecord> pipeline{reader, n_classifiers, batch_size};
+  pipeline.run(counts, handler);
+}
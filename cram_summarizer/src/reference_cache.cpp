@@ -0,0 +1,71 @@
+#include <filesystem>
+#include <stdexcept>
+#include "reference_cache.hpp"
+#include "htslib/cram.h"
+
+namespace fs = std::filesystem;
+
+/*
+ * Shared reference stores are indexed by header target id, so sharing is only valid between
+ *   CRAMs with identical contig names and order. The key holds every name and length rather than
+ *   a hash of them, so headers that differ are never matched. Tab and newline cannot occur in names.
+ * Spellings of the same reference path are canonicalized to one key.
+ */
+static std::string cache_key(const sam_hdr_t* header, const std::string& ref_path){
+  std::error_code ec{};
+  fs::path canonical_path{fs::weakly_canonical(ref_path, ec)};
+  std::string key{ec ? ref_path : canonical_path.string()};
+
+  key += '\n';
+  for(int tid{0}; tid < header->n_targets; tid++){
+    key += header->target_name[tid];
+    key += '\t' + std::to_string(header->target_len[tid]) + '\n';
+  }
+  return key;
+}
+
+ReferenceCache& ReferenceCache::instance(){
+  static ReferenceCache cache{};
+  return cache;
+}
+
+ReferenceCache::~ReferenceCache(){
+  for(auto& anchor_kv : m_anchors){
+    hts_close(anchor_kv.second);
+  }
+}
+
+void ReferenceCache::attach(htsFile* cram_file, const sam_hdr_t* header, const std::string& in_path,
+                            const std::string& ref_path){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  std::string key{cache_key(header, ref_path)};
+
+  auto anchor_it{m_anchors.find(key)};
+  if(anchor_it != m_anchors.end()){
+    m_hits++;
+  } else {
+    m_misses++;
+
+    htsFile* anchor{hts_open(in_path.data(), "r")};
+    if(!anchor || hts_set_fai_filename(anchor, ref_path.data()) != 0){
+      if(anchor){ hts_close(anchor); }
+      throw std::runtime_error(std::string("Failed to load reference: ") + ref_path);
+    }
+    anchor_it = m_anchors.emplace(key, anchor).first;
+  }
+
+  refs_t* refs{cram_get_refs(anchor_it->second)};
+  if(hts_set_opt(cram_file, CRAM_OPT_SHARED_REF, refs) != 0){
+    throw std::runtime_error(std::string("Failed to share reference: ") + ref_path);
+  }
+}
+
+int64_t ReferenceCache::hits(){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_hits;
+}
+
+int64_t ReferenceCache::misses(){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_misses;
+}
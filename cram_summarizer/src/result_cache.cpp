@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+#include <zlib.h>
+#include "result_cache.hpp"
+#include "run_stats.hpp"
+
+namespace fs = std::filesystem;
+
+static constexpr std::string_view ENTRY_EXTENSION{".json.gz"};
+
+// FNV-1a
+static uint64_t hash_key(std::string_view key){
+  uint64_t hash{14695981039346656037ull};
+  for(char c : key){
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static std::string hex(const uint64_t value){
+  static constexpr char DIGITS[]{"0123456789abcdef"};
+  std::string result(16, '0');
+  for(int i{15}, shift{0}; i >= 0; i--, shift += 4){
+    result[i] = DIGITS[(value >> shift) & 0xf];
+  }
+  return result;
+}
+
+struct CacheEntry {
+  fs::path path{};
+  uintmax_t size{0};
+  fs::file_time_type mtime{};
+};
+
+/* Entries in dir and their total size. Temporary files of unfinished writes are skipped. */
+static uintmax_t scan_entries(const std::string& dir, std::vector<CacheEntry>& entries){
+  uintmax_t total_bytes{0};
+  std::error_code ec{};
+  for(auto& dir_entry : fs::directory_iterator{dir, ec}){
+    const fs::path& path{dir_entry.path()};
+    std::string name{path.filename().string()};
+    if(name.starts_with('.') || !name.ends_with(ENTRY_EXTENSION)){
+      continue;
+    }
+
+    CacheEntry entry{path, dir_entry.file_size(ec), dir_entry.last_write_time(ec)};
+    if(!ec){
+      total_bytes += entry.size;
+      entries.push_back(entry);
+    }
+  }
+  return total_bytes;
+}
+
+/* Tab delimited canonical path, size, and modification time of the regular file at path.
+ * Empty if there is no such file.
+ */
+static std::string file_identity(const std::string& path){
+  std::error_code ec{};
+  fs::path file{fs::canonical(path, ec)};
+  if(ec || !fs::is_regular_file(file, ec)){
+    return "";
+  }
+
+  uintmax_t size{fs::file_size(file, ec)};
+  fs::file_time_type mtime{fs::last_write_time(file, ec)};
+  if(ec){
+    return "";
+  }
+  return file.string() + '\t' + std::to_string(size) + '\t' + std::to_string(mtime.time_since_epoch().count());
+}
+
+ResultCache& ResultCache::instance(){
+  static ResultCache cache{};
+  return cache;
+}
+
+void ResultCache::init(const std::string& dir, const uint64_t max_bytes, const std::string& version,
+                       const int summary_format){
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  std::vector<CacheEntry> entries{};
+  uint64_t total_bytes{0};
+  if(!dir.empty()){
+    std::error_code ec{};
+    fs::create_directories(dir, ec);
+    if(ec || !fs::is_directory(dir)){
+      throw std::runtime_error(std::string("Failed to create result cache directory: ") + dir);
+    }
+    total_bytes = scan_entries(dir, entries);
+  }
+
+  m_dir = dir;
+  m_max_bytes = max_bytes;
+  m_version = version;
+  m_summary_format = summary_format;
+  m_total_bytes = total_bytes;
+}
+
+bool ResultCache::is_enabled(){
+  return !m_dir.empty();
+}
+
+std::string ResultCache::make_key(const std::string& path, const std::string& ref_path,
+                                  const std::vector<GenomicRegion>& regions){
+  std::string input{file_identity(path)};
+  std::string reference{ref_path.empty() ? "\t\t" : file_identity(ref_path)};
+  if(input.empty() || reference.empty()){
+    return "";
+  }
+
+  // Tab delimited, as no field can contain a tab that would make two keys equal.
+  std::string key{m_version + '\t' + std::to_string(m_summary_format) + '\t' + input + '\t' + reference};
+  for(auto& region : regions){
+    key += '\t' + region.to_string();
+  }
+  return key;
+}
+
+bool ResultCache::load(const std::string& key, std::string& document){
+  fs::path entry_path{fs::path{m_dir} / (hex(hash_key(key)) + std::string(ENTRY_EXTENSION))};
+
+  gzFile infile{gzopen(entry_path.c_str(), "rb")};
+  if(!infile){
+    return false;
+  }
+
+  std::string contents{};
+  char chunk[65536];
+  int n_read{0};
+  while((n_read = gzread(infile, chunk, sizeof(chunk))) > 0){
+    contents.append(chunk, n_read);
+  }
+  // Truncated or corrupt entries fail the gzip check and are misses.
+  bool is_intact{gzclose(infile) == Z_OK && n_read == 0};
+
+  size_t key_end{contents.find('\n')};
+  if(!is_intact || key_end == std::string::npos || std::string_view{contents}.substr(0, key_end) != key){
+    return false;
+  }
+
+  document = contents.substr(key_end + 1);
+
+  // Mark as recently used for eviction.
+  std::error_code ec{};
+  fs::last_write_time(entry_path, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+void ResultCache::store(const std::string& key, const std::string& document){
+  std::string entry_name{hex(hash_key(key)) + std::string(ENTRY_EXTENSION)};
+  fs::path entry_path{fs::path{m_dir} / entry_name};
+  fs::path tmp_path{fs::path{m_dir} /
+      ("." + entry_name + "." + std::to_string(getpid()) + "." + std::to_string(m_n_writes++) + ".tmp")};
+
+  gzFile outfile{gzopen(tmp_path.c_str(), "wb6")};
+  if(!outfile){
+    return;
+  }
+
+  std::string header{key + '\n'};
+  bool is_written{
+    gzwrite(outfile, header.data(), header.size()) == static_cast<int>(header.size()) &&
+    (document.empty() || gzwrite(outfile, document.data(), document.size()) == static_cast<int>(document.size()))};
+  is_written = gzclose(outfile) == Z_OK && is_written;
+
+  std::error_code ec{};
+  uintmax_t entry_size{is_written ? fs::file_size(tmp_path, ec) : 0};
+  if(is_written && !ec){
+    fs::rename(tmp_path, entry_path, ec);
+  }
+  if(!is_written || ec){
+    fs::remove(tmp_path, ec);
+    return;
+  }
+
+  // An entry replacing one of the same key is counted twice until the next scan, which only evicts sooner.
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_total_bytes += entry_size;
+  if(m_total_bytes > m_max_bytes){
+    evict();
+  }
+}
+
+void ResultCache::evict(){
+  std::vector<CacheEntry> entries{};
+  uintmax_t total_bytes{scan_entries(m_dir, entries)};
+
+  std::sort(entries.begin(), entries.end(),
+      [](const CacheEntry& a, const CacheEntry& b){ return a.mtime < b.mtime; });
+  std::error_code ec{};
+  for(auto& entry : entries){
+    if(total_bytes <= m_max_bytes){
+      break;
+    }
+    // Another process may have evicted it already.
+    fs::remove(entry.path, ec);
+    total_bytes -= entry.size;
+  }
+  m_total_bytes = total_bytes;
+}
+
+std::string ResultCache::get_or_make(const std::string& path, const std::string& ref_path,
+                                     const std::vector<GenomicRegion>& regions,
+                                     const std::function<std::string()>& summarize){
+  std::string key{is_enabled() ? make_key(path, ref_path, regions) : ""};
+  if(key.empty()){
+    return summarize();
+  }
+
+  std::string document{};
+  bool is_hit{false};
+  {
+    StageTimer timer{OPEN};
+    is_hit = load(key, document);
+  }
+  if(is_hit){
+    m_hits++;
+    return document;
+  }
+
+  m_misses++;
+  document = summarize();
+
+  StageTimer timer{EMIT};
+  store(key, document);
+  return document;
+}
+
+int64_t ResultCache::hits(){
+  return m_hits;
+}
+
+int64_t ResultCache::misses(){
+  return m_misses;
+}
@@ -0,0 +1,45 @@
+#include "sa_tag_scanner.hpp"
+#include "cram_reader.hpp"
+#include "app_utils.hpp"
+
+SaTagScanner::SaTagScanner(std::string_view sa_value) : m_remaining(sa_value) {
+  if(m_remaining.starts_with("SA:Z:")){
+    m_remaining.remove_prefix(5);
+  }
+}
+
+/*
+ * Split off the view up to the delimiter, advancing the source view past it.
+ * Returns the remainder of the source if delimiter is not present.
+ */
+static std::string_view take_until(std::string_view& source, const char delim){
+  size_t delim_pos{source.find(delim)};
+  std::string_view token{source.substr(0, delim_pos)};
+  source.remove_prefix(delim_pos == std::string_view::npos ? source.length() : delim_pos + 1);
+  return token;
+}
+
+bool SaTagScanner::next(SaRecord& rec){
+  while(!m_remaining.empty()){
+    // Each record is semicolon terminated with comma delimited fields.
+    std::string_view record{take_until(m_remaining, ';')};
+
+    rec.rname = take_until(record, ',');
+    std::string_view pos{take_until(record, ',')};
+    std::string_view strand{take_until(record, ',')};
+    rec.cigar = take_until(record, ',');
+    std::string_view mapq{take_until(record, ',')};
+    std::string_view nm{record};
+
+    bool is_valid{
+      !rec.rname.empty() && (strand == "+" || strand == "-") && !rec.cigar.empty() &&
+      view_to_numeric(pos, rec.pos) && view_to_numeric(mapq, rec.mapq) && view_to_numeric(nm, rec.nm)};
+
+    if(is_valid){
+      rec.is_forward_strand = strand == "+";
+      rec.ref_span = AlignmentReader::reference_span(rec.cigar);
+      return true;
+    }
+  }
+  return false;
+}
@@ -18,14 +18,11 @@ std::ostream& operator<<(std::ostream& os, const SimpleAlignment& sa){
   return os;
 }
 
-boost::json::object SimpleAlignment::to_json(){
-  boost::json::object obj;
-
-  obj["chr"] = chr;
-  obj["start"] = start;
-  obj["end"] = end;
-  obj["is_reverse"] = !strand;
-
-  return obj;
+boost::json::object SimpleAlignment::to_json(bj::storage_ptr sp) const{
+  return alignment_json(chr, start, end, !strand, std::move(sp));
 }
 
+bj::object alignment_json(std::string_view chr, const int start, const int end, const bool is_reverse,
+                          bj::storage_ptr sp){
+  return bj::object({{"chr", chr}, {"start", start}, {"end", end}, {"is_reverse", is_reverse}}, std::move(sp));
+}
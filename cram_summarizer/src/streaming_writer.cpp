@@ -0,0 +1,244 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <unistd.h>
+#include "streaming_writer.hpp"
+#include "app_utils.hpp"
+#include "boost/json.hpp"
+
+namespace bj = boost::json;
+
+/* Partition of a spilled query name. Each split depth hashes differently, so an oversized partition spreads out. */
+static size_t spill_partition(std::string_view qname, const int depth, const int n_partitions){
+  uint64_t hash{std::hash<std::string_view>{}(qname) + static_cast<uint64_t>(depth) * 0x9e3779b97f4a7c15ull};
+  // splitmix64 finalizer
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+  return (hash ^ (hash >> 31)) % n_partitions;
+}
+
+/* Split spill line of: type, qname, chr, start, end, strand. */
+static void split_spill_line(std::string_view line, std::string_view (&fields)[6]){
+  for(auto& field : fields){
+    size_t tab_pos{line.find('\t')};
+    field = line.substr(0, tab_pos);
+    line.remove_prefix(tab_pos == std::string_view::npos ? line.length() : tab_pos + 1);
+  }
+}
+
+bool StreamingWriter::Expiry::operator>(const Expiry& other) const{
+  return horizon != other.horizon ? horizon > other.horizon : seq > other.seq;
+}
+
+StreamingWriter::StreamingWriter(std::ostream& out, const int64_t window, const std::string& spill_dir,
+                                 const int64_t max_partition_bytes) :
+  m_out(out), m_window(window), m_spill_dir(spill_dir), m_max_partition_bytes(max_partition_bytes) {
+
+  if(m_spill_dir.empty()){
+    m_spill_dir = std::filesystem::temp_directory_path().string();
+  }
+}
+
+StreamingWriter::~StreamingWriter(){
+  remove_spill_files();
+}
+
+size_t StreamingWriter::n_pending() const{ return m_groups.size(); }
+int64_t StreamingWriter::n_spilled() const{ return m_n_spilled; }
+
+void StreamingWriter::add(const SimpleAlignment& sa, const AlnType aln_type, const int32_t tid,
+                          const int64_t pos, const int32_t mate_tid, const int64_t mate_pos){
+  if(tid < m_tid || (tid == m_tid && pos < m_pos)){
+    throw std::runtime_error("Streaming output requires coordinate sorted input.");
+  }
+
+  // Nothing pending can be joined by records on a later contig.
+  if(tid != m_tid){
+    expire_through(INT64_MAX);
+  } else {
+    expire_through(pos - 1);
+  }
+  m_tid = tid;
+  m_pos = pos;
+
+  if(mate_tid != tid || std::abs(mate_pos - pos) > m_window){
+    spill(sa, aln_type);
+    return;
+  }
+
+  std::string key{std::to_string(aln_type) + '\t' + sa.qname};
+  auto [group_it, is_new]{m_groups.try_emplace(key)};
+  Group& group{group_it->second};
+
+  if(is_new){
+    group.aln_type = aln_type;
+    group.qname = sa.qname;
+  }
+  group.alignments.push_back(sa);
+
+  int64_t horizon{std::max(pos, mate_pos)};
+  if(is_new || horizon > group.horizon){
+    group.horizon = horizon;
+    m_expiry.push(Expiry{horizon, m_seq++, key});
+  }
+}
+
+void StreamingWriter::expire_through(const int64_t pos){
+  while(!m_expiry.empty() && m_expiry.top().horizon <= pos){
+    auto group_it{m_groups.find(m_expiry.top().key)};
+
+    // Skip stale entries for groups whose horizon was extended.
+    if(group_it != m_groups.end() && group_it->second.horizon == m_expiry.top().horizon){
+      write_group(group_it->second);
+      m_groups.erase(group_it);
+    }
+    m_expiry.pop();
+  }
+}
+
+void StreamingWriter::write_group(const Group& group){
+  bj::array alignments{};
+  alignments.reserve(group.alignments.size());
+  for(auto& sa : group.alignments){
+    alignments.emplace_back(sa.to_json());
+  }
+
+  bj::object qname_obj{};
+  qname_obj[group.qname] = std::move(alignments);
+
+  bj::object line{};
+  line[AlnTypeJsonKeys[group.aln_type]] = std::move(qname_obj);
+
+  m_out << bj::serialize(line) << '\n';
+}
+
+std::string StreamingWriter::create_spill_file(){
+  std::string path_template{(std::filesystem::path{m_spill_dir} / "cram_summ_spill_XXXXXX").string()};
+
+  int fd{mkstemp(path_template.data())};
+  if(fd == -1){
+    throw std::runtime_error(std::string("Failed to create spill file in: ") + m_spill_dir);
+  }
+  close(fd);
+
+  m_spill_paths.push_back(path_template);
+  return path_template;
+}
+
+void StreamingWriter::open_spill_files(){
+  for(int partition{0}; partition < N_SPILL_PARTITIONS; partition++){
+    m_spill_files.emplace_back(create_spill_file(), std::ios::out | std::ios::trunc);
+  }
+  m_spill_bytes.assign(N_SPILL_PARTITIONS, 0);
+}
+
+void StreamingWriter::remove_spill_files(){
+  m_spill_files.clear();
+  m_spill_bytes.clear();
+  for(auto& path : m_spill_paths){
+    std::remove(path.data());
+  }
+  m_spill_paths.clear();
+}
+
+void StreamingWriter::spill(const SimpleAlignment& sa, const AlnType aln_type){
+  if(m_spill_files.empty()){
+    open_spill_files();
+  }
+
+  std::string line{std::to_string(aln_type)};
+  line.append("\t").append(sa.qname).append("\t").append(sa.chr)
+      .append("\t").append(std::to_string(sa.start)).append("\t").append(std::to_string(sa.end))
+      .append(sa.strand ? "\t1\n" : "\t0\n");
+
+  size_t partition{spill_partition(sa.qname, 0, N_SPILL_PARTITIONS)};
+  m_spill_files[partition] << line;
+  m_spill_bytes[partition] += line.size();
+  m_n_spilled++;
+}
+
+void StreamingWriter::write_partition(const std::string& path, const int64_t n_bytes, const int depth){
+  std::string line{};
+
+  if(n_bytes > m_max_partition_bytes && depth < MAX_SPLIT_DEPTH){
+    std::vector<std::string> split_paths{};
+    std::vector<std::ofstream> split_files{};
+    std::vector<int64_t> split_bytes(N_SPILL_PARTITIONS, 0);
+    for(int partition{0}; partition < N_SPILL_PARTITIONS; partition++){
+      split_paths.push_back(create_spill_file());
+      split_files.emplace_back(split_paths.back(), std::ios::out | std::ios::trunc);
+    }
+
+    {
+      std::ifstream infile{path};
+      std::string_view fields[6]{};
+      while(std::getline(infile, line)){
+        split_spill_line(line, fields);
+        size_t partition{spill_partition(fields[1], depth + 1, N_SPILL_PARTITIONS)};
+        split_files[partition] << line << '\n';
+        split_bytes[partition] += line.size() + 1;
+      }
+    }
+    std::remove(path.data());
+
+    for(int partition{0}; partition < N_SPILL_PARTITIONS; partition++){
+      split_files[partition].close();
+      if(!split_files[partition]){
+        throw std::runtime_error(std::string("Failed to write spill file: ") + split_paths[partition]);
+      }
+      write_partition(split_paths[partition], split_bytes[partition], depth + 1);
+    }
+    return;
+  }
+
+  std::ifstream infile{path};
+
+  // Regroup the partition in order of first appearance.
+  std::unordered_map<std::string, size_t> group_idxs{};
+  std::vector<Group> groups{};
+
+  while(std::getline(infile, line)){
+    std::string_view fields[6]{};
+    split_spill_line(line, fields);
+
+    int aln_type{0};
+    int start{0};
+    int end{0};
+    view_to_numeric(fields[0], aln_type);
+    view_to_numeric(fields[3], start);
+    view_to_numeric(fields[4], end);
+
+    std::string key{std::string(fields[0]) + '\t' + std::string(fields[1])};
+    auto [idx_it, is_new]{group_idxs.try_emplace(key, groups.size())};
+    if(is_new){
+      groups.push_back(Group{static_cast<AlnType>(aln_type), std::string(fields[1])});
+    }
+    groups[idx_it->second].alignments.emplace_back(
+        std::string(fields[1]), std::string(fields[2]), start, end, fields[5] == "1");
+  }
+  infile.close();
+  std::remove(path.data());
+
+  for(auto& group : groups){
+    write_group(group);
+  }
+}
+
+void StreamingWriter::finish(){
+  expire_through(INT64_MAX);
+
+  for(size_t partition{0}; partition < m_spill_files.size(); partition++){
+    m_spill_files[partition].close();
+    if(!m_spill_files[partition]){
+      throw std::runtime_error(std::string("Failed to write spill file: ") + m_spill_paths[partition]);
+    }
+    // Copied since splitting adds spill paths.
+    std::string path{m_spill_paths[partition]};
+    write_partition(path, m_spill_bytes[partition], 0);
+  }
+
+  remove_spill_files();
+  m_out.flush();
+}
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "summary_server.hpp"
+
+namespace bj = boost::json;
+namespace fs = std::filesystem;
+
+// Longest request line accepted before the connection is closed.
+static constexpr size_t MAX_REQUEST_BYTES{1 << 20};
+
+ReaderCache::Lease::Lease(std::shared_ptr<Slot> slot)
+  : m_slot{std::move(slot)},
+    m_lock{m_slot->mutex}
+{}
+
+AlignmentReader& ReaderCache::Lease::reader(){
+  return *m_slot->reader;
+}
+
+ReaderCache::ReaderCache(const size_t capacity, Opener opener)
+  : m_capacity{std::max<size_t>(capacity, 1)},
+    m_opener{std::move(opener)}
+{}
+
+ReaderCache::Lease ReaderCache::acquire(const std::string& sample){
+  std::shared_ptr<Slot> slot{};
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto found{m_index.find(sample)};
+    if(found != m_index.end()){
+      m_lru.splice(m_lru.begin(), m_lru, found->second);
+    } else {
+      m_lru.emplace_front(sample, std::make_shared<Slot>());
+      m_index[sample] = m_lru.begin();
+
+      while(m_lru.size() > m_capacity){
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+      }
+    }
+    slot = m_lru.front().second;
+  }
+
+  // Open outside the cache lock so queries of other samples are not held up.
+  Lease lease{slot};
+  if(slot->reader){
+    m_hits++;
+    return lease;
+  }
+
+  m_misses++;
+  try{
+    slot->reader = m_opener(sample);
+  } catch(...){
+    forget(sample, slot);
+    throw;
+  }
+  return lease;
+}
+
+void ReaderCache::forget(const std::string& sample, const std::shared_ptr<Slot>& slot){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  auto found{m_index.find(sample)};
+  if(found != m_index.end() && found->second->second == slot){
+    m_lru.erase(found->second);
+    m_index.erase(found);
+  }
+}
+
+size_t ReaderCache::size() const{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_lru.size();
+}
+
+int64_t ReaderCache::hits() const{
+  return m_hits;
+}
+
+int64_t ReaderCache::misses() const{
+  return m_misses;
+}
+
+SummaryServer::SummaryServer(const std::vector<BatchEntry>& entries, const AppControlData& control)
+  : m_control{control},
+    m_readers{static_cast<size_t>(std::max(control.max_open, 1)),
+              [this](const std::string& sample){
+                StageTimer timer{OPEN};
+                return open_reader(m_entries.at(sample).path, m_control);
+              }}
+{
+  std::vector<GenomicRegion> default_regions{collect_regions(control)};
+  for(auto& entry : entries){
+    BatchEntry& served{m_entries[entry.sample]};
+    served = entry;
+    served.regions = entry.regions.empty() ? default_regions : merge_regions(entry.regions, control.region_gap);
+  }
+
+  const std::string& path{control.serve_path};
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if(path.empty() || path.size() >= sizeof(addr.sun_path)){
+    throw std::runtime_error(std::string("Invalid socket path: ") + path);
+  }
+  std::memcpy(addr.sun_path, path.data(), path.size());
+
+  if(pipe(m_stop_pipe) != 0){
+    throw std::runtime_error(std::string("Failed to create pipe: ") + std::strerror(errno));
+  }
+
+  // Nonblocking so workers woken for the same connection do not block in accept.
+  m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  bool is_listening{m_listen_fd >= 0 && fcntl(m_listen_fd, F_SETFL, O_NONBLOCK) == 0};
+
+  std::error_code ec{};
+  if(is_listening && fs::is_socket(path, ec)){
+    fs::remove(path, ec);
+  }
+  is_listening = is_listening &&
+      bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+      listen(m_listen_fd, SOMAXCONN) == 0;
+
+  if(!is_listening){
+    std::string message{std::string("Failed to listen on ") + path + ": " + std::strerror(errno)};
+    if(m_listen_fd >= 0){
+      close(m_listen_fd);
+    }
+    close(m_stop_pipe[0]);
+    close(m_stop_pipe[1]);
+    throw std::runtime_error(message);
+  }
+}
+
+SummaryServer::~SummaryServer(){
+  close(m_listen_fd);
+  close(m_stop_pipe[0]);
+  close(m_stop_pipe[1]);
+
+  std::error_code ec{};
+  fs::remove(m_control.serve_path, ec);
+}
+
+void SummaryServer::serve(){
+  std::vector<std::thread> workers{};
+  for(int i{1}; i < m_control.workers; i++){
+    workers.emplace_back(&SummaryServer::serve_connections, this);
+  }
+  serve_connections();
+  for(auto& thread : workers){
+    thread.join();
+  }
+}
+
+void SummaryServer::stop(){
+  char byte{0};
+  ssize_t ret{write(m_stop_pipe[1], &byte, 1)};
+  (void)ret;
+}
+
+std::string SummaryServer::answer(std::string_view request){
+  try{
+    size_t tab{request.find('\t')};
+    std::string sample{request.substr(0, tab)};
+
+    auto entry{m_entries.find(sample)};
+    if(entry == m_entries.end()){
+      throw std::runtime_error(std::string("Unknown sample: ") + sample);
+    }
+
+    std::vector<GenomicRegion> regions{};
+    if(tab != std::string_view::npos && !parse_region_list(request.substr(tab + 1), regions)){
+      throw std::runtime_error(std::string("Malformed regions: ") + std::string(request.substr(tab + 1)));
+    }
+    regions = regions.empty() ? entry->second.regions : merge_regions(regions, m_control.region_gap);
+
+    // An open reader cannot rewind, so only indexed queries are served.
+    if(regions.empty()){
+      throw std::runtime_error(std::string("No regions given for sample: ") + sample);
+    }
+
+    // A cached document is answered without leasing a reader.
+    Accounting counts{};
+    std::string document{ResultCache::instance().get_or_make(entry->second.path, m_control.ref_path, regions,
+        [this, &sample, &regions, &counts](){
+          ReaderCache::Lease lease{m_readers.acquire(sample)};
+          lease.reader().set_regions(regions, m_control.region_gap);
+          bj::monotonic_resource arena{};
+          return bj::serialize(summarize_document(lease.reader(), m_control, counts, &arena));
+        })};
+
+    std::lock_guard<std::mutex> lock{m_counts_mutex};
+    m_counts += counts;
+    return document;
+  } catch(std::exception& ex){
+    // Any failure answers this request only, so one bad query cannot end the server.
+    return bj::serialize(bj::object{{"error", ex.what()}});
+  }
+}
+
+const ReaderCache& SummaryServer::readers() const{
+  return m_readers;
+}
+
+Accounting SummaryServer::counts(){
+  std::lock_guard<std::mutex> lock{m_counts_mutex};
+  return m_counts;
+}
+
+bool SummaryServer::wait_readable(const int fd, const int timeout_ms){
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point deadline{Clock::now() + std::chrono::milliseconds{timeout_ms}};
+
+  pollfd fds[2]{{fd, POLLIN, 0}, {m_stop_pipe[0], POLLIN, 0}};
+  int wait_ms{timeout_ms};
+  while(true){
+    int n_ready{poll(fds, 2, wait_ms)};
+    if(n_ready < 0 && errno == EINTR){
+      if(timeout_ms >= 0){
+        auto left{std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now())};
+        wait_ms = static_cast<int>(std::max<int64_t>(left.count(), 0));
+      }
+      continue;
+    }
+    return n_ready > 0 && fds[1].revents == 0;
+  }
+}
+
+void SummaryServer::serve_connections(){
+  while(wait_readable(m_listen_fd)){
+    int fd{accept(m_listen_fd, nullptr, nullptr)};
+    // Another worker took the connection.
+    if(fd < 0){
+      continue;
+    }
+    serve_connection(fd);
+    close(fd);
+  }
+}
+
+void SummaryServer::serve_connection(const int fd){
+  const int timeout_ms{m_control.idle_timeout > 0 ?
+      static_cast<int>(std::min<int64_t>(m_control.idle_timeout * int64_t{1000}, INT32_MAX)) : -1};
+  std::string buffer{};
+  char chunk[4096];
+
+  while(true){
+    size_t newline{buffer.find('\n')};
+    if(newline == std::string::npos){
+      if(buffer.size() > MAX_REQUEST_BYTES || !wait_readable(fd, timeout_ms)){
+        return;
+      }
+      ssize_t n_read{read(fd, chunk, sizeof(chunk))};
+      if(n_read <= 0){
+        return;
+      }
+      buffer.append(chunk, n_read);
+      continue;
+    }
+
+    std::string_view request{buffer.data(), newline};
+    if(!request.empty() && request.back() == '\r'){
+      request.remove_suffix(1);
+    }
+    std::string response{answer(request)};
+    response += '\n';
+    buffer.erase(0, newline + 1);
+
+    // Clients that hang up must not raise SIGPIPE.
+    for(size_t sent{0}; sent < response.size();){
+      ssize_t n_sent{send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL)};
+      if(n_sent < 0 && errno == EINTR){
+        continue;
+      }
+      if(n_sent <= 0){
+        return;
+      }
+      sent += n_sent;
+    }
+  }
+}
+
+// Server stopped by SIGINT and SIGTERM.
+static std::atomic<SummaryServer*> signalled_server{nullptr};
+
+static void stop_signalled_server(int){
+  SummaryServer* server{signalled_server};
+  if(server){
+    server->stop();
+  }
+}
+
+/* Stop server on SIGINT and SIGTERM. nullptr restores the default handlers. */
+static void stop_on_signals(SummaryServer* server){
+  signalled_server = server;
+  std::signal(SIGINT, server ? stop_signalled_server : SIG_DFL);
+  std::signal(SIGTERM, server ? stop_signalled_server : SIG_DFL);
+}
+
+bool run_server(const AppControlData& control){
+  if(control.manifest_path.empty()){
+    std::cerr<<"Serving requires a manifest of samples.\n";
+    return false;
+  }
+  if(control.stream || control.join_mates){
+    std::cerr<<"Streaming output is not supported when serving.\n";
+    return false;
+  }
+
+  Accounting counts;
+
+  if(!control.stats_path.empty()){
+    RunStats::instance().enable();
+  }
+
+  try{
+    SharedThreadPool::instance().init(control.threads);
+
+    SummaryServer server{read_manifest(control.manifest_path), control};
+    stop_on_signals(&server);
+
+    std::cerr<<"Serving on "<<control.serve_path<<"\n";
+    server.serve();
+
+    stop_on_signals(nullptr);
+
+    counts = server.counts();
+    if(!control.stats_path.empty()){
+      RunStats::instance().add_count("reader_hits", server.readers().hits());
+      RunStats::instance().add_count("reader_misses", server.readers().misses());
+    }
+    write_run_stats(counts, control);
+  } catch(std::runtime_error& ex){
+    stop_on_signals(nullptr);
+    std::cerr<<"Error serving: "<<ex.what()<<"\n";
+    return false;
+  }
+
+  if(control.print_counts){
+    print_counts(counts, std::cerr);
+  }
+  return true;
+}
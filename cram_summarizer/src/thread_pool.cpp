@@ -0,0 +1,38 @@
+#include <stdexcept>
+#include <string>
+#include "thread_pool.hpp"
+#include "htslib/thread_pool.h"
+
+SharedThreadPool& SharedThreadPool::instance(){
+  static SharedThreadPool pool{};
+  return pool;
+}
+
+SharedThreadPool::~SharedThreadPool(){
+  if(m_pool.pool){
+    hts_tpool_destroy(m_pool.pool);
+  }
+}
+
+void SharedThreadPool::init(const int n_threads){
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  if(n_threads < 2 || m_pool.pool){
+    return;
+  }
+
+  m_pool.pool = hts_tpool_init(n_threads);
+  if(!m_pool.pool){
+    throw std::runtime_error(std::string("Failed to create thread pool of size: ") + std::to_string(n_threads));
+  }
+}
+
+htsThreadPool* SharedThreadPool::get(){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_pool.pool ? &m_pool : nullptr;
+}
+
+int SharedThreadPool::size(){
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_pool.pool ? hts_tpool_size(m_pool.pool) : 0;
+}
@@ -94,6 +94,19 @@ TEST_P(PathAndCountsFixture, ExpectedSampleNames){
   EXPECT_EQ(count, expected.n_records);
 }
 
+TEST_P(PathAndCountsFixture, ExpectedRecordsMinimalDecode){
+  TestParam path_and_counts = GetParam();
+  std::string infile_path{std::get<0>(path_and_counts)};
+  ExpectedCounts expected{std::get<1>(path_and_counts)};
+
+  AlignmentReader reader{infile_path, ""};
+  reader.set_required_fields(AlignmentReader::SUMMARY_FIELDS);
+  uint32_t count{0};
+  while(reader.next_alignment()){ count++; }
+
+  EXPECT_EQ(count, expected.n_records);
+}
+
 INSTANTIATE_TEST_SUITE_P( SummarizeFiles, PathAndCountsFixture,
     testing::ValuesIn(generate_path_parameters()));
 
@@ -115,3 +128,56 @@ TEST(AlignReader, RefSpanStringView){
 
   EXPECT_EQ(result_all_matches, 151);
 }
+
+TEST(AlignReader, RefSpanMixedOperations){
+  std::string_view cigar{"20S30M2I40M5D10N6X38H"};
+
+  EXPECT_EQ(AlignmentReader::reference_span(cigar), 91);
+}
+
+TEST(AlignReader, RefSpanBinary){
+  uint32_t cigar[]{
+    bam_cigar_gen(20, BAM_CSOFT_CLIP), bam_cigar_gen(30, BAM_CMATCH), bam_cigar_gen(2, BAM_CINS),
+    bam_cigar_gen(40, BAM_CMATCH), bam_cigar_gen(5, BAM_CDEL), bam_cigar_gen(10, BAM_CREF_SKIP),
+    bam_cigar_gen(6, BAM_CDIFF), bam_cigar_gen(38, BAM_CHARD_CLIP)};
+
+  EXPECT_EQ(AlignmentReader::reference_span(cigar, 8), 91);
+}
+
+/******************
+ * Region Queries *
+ *****************/
+TEST(AlignReader, RegionRequiresIndex){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "del_1_sample_1.sam"};
+  AlignmentReader reader{sam_path.string(), ""};
+
+  std::vector<GenomicRegion> regions{{"chr1", 50178900, 50179000}};
+  EXPECT_THROW(reader.set_regions(regions), std::runtime_error);
+}
+
+TEST(AlignReader, MalformedRecordThrows){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "malformed.sam"};
+  AlignmentReader reader{sam_path.string(), ""};
+
+  EXPECT_TRUE(reader.next_alignment());
+  EXPECT_THROW(reader.next_alignment(), std::runtime_error);
+}
+
+TEST(AlignReader, RegionSubsetOfCram){
+  std::filesystem::path cram_path{std::filesystem::path{GENERATED_DATA_DIR} / "del_1_sample_1.cram"};
+  if(!std::filesystem::is_regular_file(cram_path)){
+    GTEST_SKIP() << "Generated Test Data Missing: " << cram_path;
+  }
+
+  uint32_t full_count{0};
+  AlignmentReader full_reader{cram_path.string(), ""};
+  while(full_reader.next_alignment()){ full_count++; }
+
+  uint32_t region_count{0};
+  AlignmentReader region_reader{cram_path.string(), ""};
+  region_reader.set_regions({{"chr1", 50178900, 50179000}, {"chr1", 50178950, 50179100}});
+  while(region_reader.next_alignment()){ region_count++; }
+
+  EXPECT_GT(region_count, 0);
+  EXPECT_LT(region_count, full_count);
+}
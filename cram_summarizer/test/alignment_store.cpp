@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "alignment_fixture.hpp"
+#include "app.hpp"
+
+namespace bj = boost::json;
+
+TEST(AlignmentStore, InternContigs){
+  AlignmentStore store{};
+
+  uint32_t chr1{store.intern_contig("chr1")};
+  uint32_t chr2{store.intern_contig("chr2")};
+
+  EXPECT_NE(chr1, chr2);
+  EXPECT_EQ(store.intern_contig("chr1"), chr1);
+  EXPECT_EQ(store.intern_contig("chr2"), chr2);
+  // Names are not normalized, a header may hold both spellings.
+  uint32_t unprefixed_1{store.intern_contig("1")};
+  EXPECT_NE(unprefixed_1, chr1);
+  EXPECT_NE(unprefixed_1, chr2);
+}
+
+TEST(AlignmentStore, GroupsByTypeAndQueryName){
+  AlignmentStore store{};
+  store.add(SimpleAlignment{"q1", "chr1", 100, 200, true}, AlnType::PAIRED);
+  store.add(SimpleAlignment{"q2", "chr1", 150, 250, false}, AlnType::PAIRED);
+  store.add(SimpleAlignment{"q1", "chr1", 400, 500, false}, AlnType::PAIRED);
+  store.add(SimpleAlignment{"q1", "1", 600, 700, true}, AlnType::SPLIT);
+
+  EXPECT_EQ(store.n_alignments(), 4);
+  EXPECT_EQ(store.n_groups(AlnType::PAIRED), 2);
+  EXPECT_EQ(store.n_groups(AlnType::SPLIT), 1);
+
+  bj::object doc{store.to_json()};
+  const bj::array& q1{doc["all_pairs"].as_object()["q1"].as_array()};
+  ASSERT_EQ(q1.size(), 2);
+  EXPECT_EQ(q1[0], bj::value(SimpleAlignment("q1", "chr1", 100, 200, true).to_json()));
+  EXPECT_EQ(q1[1], bj::value(SimpleAlignment("q1", "chr1", 400, 500, false).to_json()));
+
+  // Rendered with the contig name of the alignment.
+  EXPECT_EQ(doc["all_splits"].as_object()["q1"].as_array()[0].as_object()["chr"], "1");
+}
+
+TEST(AlignmentStore, ManyGroups){
+  AlignmentStore store{};
+  const int n_groups{10000};
+
+  for(int i{0}; i < n_groups; i++){
+    store.add(SimpleAlignment{"read_" + std::to_string(i), "chr1", i, i + 100, true}, AlnType::PAIRED);
+  }
+  for(int i{0}; i < n_groups; i++){
+    store.add(SimpleAlignment{"read_" + std::to_string(i), "chr1", i + 500, i + 600, false}, AlnType::PAIRED);
+  }
+
+  EXPECT_EQ(store.n_groups(AlnType::PAIRED), n_groups);
+  EXPECT_EQ(store.n_alignments(), 2 * n_groups);
+
+  bj::object doc{store.to_json()};
+  const bj::object& pairs{doc["all_pairs"].as_object()};
+  ASSERT_EQ(pairs.size(), n_groups);
+  EXPECT_EQ(pairs.begin()->key(), "read_0");
+  EXPECT_EQ(pairs.at("read_9999").as_array().size(), 2);
+}
+
+TEST(AlignmentStore, MatchesJsonDocument){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+
+  bj::object all_data{init_top_level_json()};
+  AlignmentStore store{};
+  Accounting counts{};
+  AlignmentReader reader{sam_path.string(), ""};
+
+  summarize_alignments(reader, counts,
+      [&all_data, &store](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        add_alignment(all_data, sa, aln_type);
+        store.add(sa, aln_type);
+      });
+
+  EXPECT_EQ(bj::value(store.to_json()), bj::value(all_data));
+}
+
+TEST(AlignmentStore, ArenaDocumentMatchesHeapDocument){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+
+  bj::monotonic_resource arena{};
+  bj::object all_data{init_top_level_json(&arena)};
+  AlignmentStore store{};
+  Accounting counts{};
+  AlignmentReader reader{sam_path.string(), ""};
+
+  summarize_alignments(reader, counts,
+      [&all_data, &store](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        add_alignment(all_data, sa, aln_type);
+        store.add(sa, aln_type);
+      });
+
+  bj::monotonic_resource store_arena{};
+  bj::object doc{store.to_json(&store_arena)};
+  EXPECT_EQ(bj::value(doc), bj::value(store.to_json()));
+  EXPECT_EQ(bj::value(doc), bj::value(all_data));
+
+  // Nested values share the document's arena.
+  const bj::object& pairs{all_data.at("all_pairs").as_object()};
+  ASSERT_FALSE(pairs.empty());
+  const bj::array& group{pairs.begin()->value().as_array()};
+  EXPECT_EQ(group.storage().get(), &arena);
+  EXPECT_EQ(group.at(0).as_object().storage().get(), &arena);
+  EXPECT_EQ(doc.at("all_pairs").as_object().begin()->value().storage().get(), &store_arena);
+}
+
+TEST(AlignmentStore, RecordsMatchSimpleAlignments){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+
+  AlignmentStore sa_store{};
+  Accounting counts{};
+  AlignmentReader sa_reader{sam_path.string(), ""};
+  summarize_alignments(sa_reader, counts,
+      [&sa_store](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        sa_store.add(sa, aln_type);
+      });
+  bj::value expected{sa_store.to_json()};
+
+  // Serial and pipelined, where SA records view the batch's records until they are handled.
+  for(int n_classifiers : {0, 2}){
+    AlignmentReader reader{sam_path.string(), ""};
+    AlignmentStore store{reader.get_contig_names()};
+    summarize_records(reader, counts,
+        [&store](const AlignmentRecord& rec, const SaRecord* sa_record, AlnType aln_type){
+          if(sa_record){
+            store.add(rec.get_query_name_view(), *sa_record, aln_type);
+          } else {
+            store.add(rec, aln_type);
+          }
+        }, n_classifiers, 7);
+
+    EXPECT_EQ(bj::value(store.to_json()), expected) << n_classifiers;
+  }
+}
+
+TEST(AlignmentStore, RecordContigMustBeInHeader){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+  AlignmentReader reader{sam_path.string(), ""};
+  ASSERT_TRUE(reader.next_alignment());
+
+  AlignmentStore store{std::vector<std::string_view>{}};
+  EXPECT_THROW(store.add(reader, AlnType::PAIRED), std::runtime_error);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "alignment_fixture.hpp"
+#include "app.hpp"
+
+namespace bj = boost::json;
+namespace fs = std::filesystem;
+
+static const fs::path MANIFEST_PATH{fs::path{SRC_TEST_DATA_DIR} / "del_1_manifest.tsv"};
+
+TEST(Batch, ReadManifest){
+  std::vector<BatchEntry> entries{read_manifest(MANIFEST_PATH.string())};
+
+  ASSERT_EQ(entries.size(), 3);
+  EXPECT_EQ(entries[0].sample, "del_1_sample_1");
+  EXPECT_EQ(entries[2].sample, "del_1_sample_3");
+  // Relative paths resolve against the manifest directory.
+  EXPECT_EQ(entries[1].path, (fs::path{SRC_TEST_DATA_DIR} / "del_1_sample_2.sam").string());
+  EXPECT_TRUE(entries[0].regions.empty());
+}
+
+TEST(Batch, ReadManifestRegionsAndErrors){
+  TestTempDir temp_dir{};
+  fs::path tmp_path{temp_dir.path("manifest.tsv")};
+
+  std::ofstream{tmp_path} << "s1\t/data/s1.cram\tchr1:100-200,chr2\n";
+  std::vector<BatchEntry> entries{read_manifest(tmp_path.string())};
+  ASSERT_EQ(entries.size(), 1);
+  ASSERT_EQ(entries[0].regions.size(), 2);
+  EXPECT_EQ(entries[0].regions[0].start, 99);
+  EXPECT_EQ(entries[0].regions[1].chr, "chr2");
+
+  std::ofstream{tmp_path} << "s1\t/data/s1.cram\ns1\t/data/s2.cram\n";
+  EXPECT_THROW(read_manifest(tmp_path.string()), std::runtime_error);
+  std::ofstream{tmp_path} << "s1\t/data/s1.cram\ns2\t/data/s2.cram\ns1\t/data/s3.cram\n";
+  EXPECT_THROW(read_manifest(tmp_path.string()), std::runtime_error);
+
+  std::ofstream{tmp_path} << "s1\n";
+  EXPECT_THROW(read_manifest(tmp_path.string()), std::runtime_error);
+}
+
+TEST(Batch, MatchesSingleFileSummaries){
+  std::vector<BatchEntry> entries{read_manifest(MANIFEST_PATH.string())};
+  AppControlData control{};
+  control.workers = 2;
+
+  Accounting batch_counts{};
+  bj::object batch{summarize_batch(entries, control, batch_counts)};
+
+  // Keys follow manifest order regardless of which worker finished first.
+  ASSERT_EQ(batch.size(), entries.size());
+  auto batch_it{batch.begin()};
+
+  Accounting single_counts{};
+  for(auto& entry : entries){
+    bj::object single{init_top_level_json()};
+    AlignmentReader reader{entry.path, ""};
+    summarize_alignments(reader, single_counts,
+        [&single](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+          add_alignment(single, sa, aln_type);
+        });
+
+    EXPECT_EQ(batch_it->key(), entry.sample);
+    EXPECT_EQ(batch_it->value(), bj::value(single)) << entry.sample;
+    ++batch_it;
+  }
+
+  EXPECT_EQ(batch_counts.total, single_counts.total);
+  EXPECT_EQ(batch_counts.paired, single_counts.paired);
+  EXPECT_EQ(batch_counts.split_sa, single_counts.split_sa);
+}
+
+TEST(Batch, MissingFileNamesSample){
+  std::vector<BatchEntry> entries{{"missing_sample", "/nonexistent/missing.cram", {}}};
+  AppControlData control{};
+  Accounting counts{};
+
+  try{
+    summarize_batch(entries, control, counts);
+    FAIL() << "Expected runtime_error";
+  } catch(std::runtime_error& ex){
+    EXPECT_NE(std::string(ex.what()).find("missing_sample"), std::string::npos);
+  }
+}
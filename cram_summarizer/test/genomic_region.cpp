@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+#include "alignment_fixture.hpp"
+#include "genomic_region.hpp"
+
+TEST(GenomicRegion, ParseRange){
+  GenomicRegion region{};
+
+  EXPECT_TRUE(parse_region("chr1:101-200", region));
+  EXPECT_EQ(region.chr, "chr1");
+  EXPECT_EQ(region.start, 100);
+  EXPECT_EQ(region.end, 200);
+  EXPECT_EQ(region.to_string(), "{chr1}:101-200");
+}
+
+TEST(GenomicRegion, ParseContigWithColon){
+  GenomicRegion region{};
+
+  EXPECT_TRUE(parse_region("HLA-A*01:01:01:01:1-50", region));
+  EXPECT_EQ(region.chr, "HLA-A*01:01:01:01");
+  EXPECT_EQ(region.start, 0);
+  EXPECT_EQ(region.end, 50);
+}
+
+TEST(GenomicRegion, ParseBracedContig){
+  GenomicRegion region{};
+
+  EXPECT_TRUE(parse_region("{HLA-A*01:01}:11-20", region));
+  EXPECT_EQ(region.chr, "HLA-A*01:01");
+  EXPECT_EQ(region.start, 10);
+  EXPECT_EQ(region.end, 20);
+  EXPECT_TRUE(region.whole_contig.empty());
+  EXPECT_EQ(region.to_string(), "{HLA-A*01:01}:11-20");
+
+  EXPECT_TRUE(parse_region("{HLA-A*01:01}", region));
+  EXPECT_EQ(region.chr, "HLA-A*01:01");
+  EXPECT_EQ(region.to_string(), "{HLA-A*01:01}");
+
+  EXPECT_FALSE(parse_region("{HLA-A*01:01", region));
+  EXPECT_FALSE(parse_region("{}:1-10", region));
+  EXPECT_FALSE(parse_region("{chr1}1-10", region));
+}
+
+TEST(GenomicRegion, ResolveAgainstContigs){
+  std::set<std::string> contigs{"chr1", "HLA-A*01:01", "HLA-B*07:02", "HLA-B*07"};
+  auto is_contig{[&contigs](const std::string& name){ return contigs.count(name) > 0; }};
+  GenomicRegion region{};
+
+  // Whole string names a contig, split name does not.
+  ASSERT_TRUE(parse_region("HLA-A*01:01", region));
+  resolve_region(region, is_contig);
+  EXPECT_EQ(region.to_string(), "{HLA-A*01:01}");
+
+  // Split name is the contig.
+  ASSERT_TRUE(parse_region("HLA-A*01:01:5-9", region));
+  resolve_region(region, is_contig);
+  EXPECT_EQ(region.to_string(), "{HLA-A*01:01}:5-9");
+  EXPECT_TRUE(region.whole_contig.empty());
+
+  ASSERT_TRUE(parse_region("chr1:5-9", region));
+  resolve_region(region, is_contig);
+  EXPECT_EQ(region.to_string(), "{chr1}:5-9");
+
+  // Both readings are contigs.
+  ASSERT_TRUE(parse_region("HLA-B*07:02", region));
+  EXPECT_THROW(resolve_region(region, is_contig), std::runtime_error);
+
+  // Braces settle it.
+  ASSERT_TRUE(parse_region("{HLA-B*07:02}", region));
+  resolve_region(region, is_contig);
+  EXPECT_EQ(region.to_string(), "{HLA-B*07:02}");
+}
+
+TEST(GenomicRegion, MergeOnlyResolvedReadings){
+  GenomicRegion whole{};
+  GenomicRegion ranged{};
+  ASSERT_TRUE(parse_region("HLA-A*01:01", whole));
+  ASSERT_TRUE(parse_region("HLA-A*01:5-9", ranged));
+
+  // Both split to HLA-A*01, but the first may still name a whole contig.
+  EXPECT_EQ(merge_regions({whole, ranged}).size(), 2);
+  EXPECT_EQ(merge_regions({ranged, ranged}).size(), 1);
+}
+
+TEST(GenomicRegion, ParseWholeContig){
+  GenomicRegion region{};
+
+  EXPECT_TRUE(parse_region("chrX", region));
+  EXPECT_EQ(region.chr, "chrX");
+  EXPECT_EQ(region.to_string(), "{chrX}");
+}
+
+TEST(GenomicRegion, ParseMalformed){
+  GenomicRegion region{};
+
+  EXPECT_FALSE(parse_region("", region));
+  EXPECT_FALSE(parse_region("chr1:abc-200", region));
+  EXPECT_FALSE(parse_region("chr1:300-200", region));
+  EXPECT_FALSE(parse_region("chr1:0-200", region));
+}
+
+TEST(GenomicRegion, ParseRegionList){
+  std::vector<GenomicRegion> regions{};
+
+  EXPECT_TRUE(parse_region_list("chr1:100-200,chr2", regions));
+  ASSERT_EQ(regions.size(), 2);
+  EXPECT_EQ(regions[0].start, 99);
+  EXPECT_EQ(regions[1].chr, "chr2");
+
+  EXPECT_FALSE(parse_region_list("chr1:100-200,,chr2", regions));
+}
+
+TEST(GenomicRegion, MergeOverlappingAndNearby){
+  std::vector<GenomicRegion> regions{
+    {"chr2", 500, 600}, {"chr1", 300, 400}, {"chr1", 100, 250}, {"chr1", 200, 300}, {"chr2", 100, 200}};
+
+  std::vector<GenomicRegion> merged{merge_regions(regions)};
+  ASSERT_EQ(merged.size(), 3);
+  EXPECT_EQ(merged[0].to_string(), "{chr2}:101-200");
+  EXPECT_EQ(merged[1].to_string(), "{chr2}:501-600");
+  EXPECT_EQ(merged[2].to_string(), "{chr1}:101-400");
+
+  std::vector<GenomicRegion> merged_gap{merge_regions(regions, 300)};
+  ASSERT_EQ(merged_gap.size(), 2);
+  EXPECT_EQ(merged_gap[0].to_string(), "{chr2}:101-600");
+}
+
+TEST(GenomicRegion, ReadBed){
+  std::filesystem::path bed_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "del_1_regions.bed"};
+  std::vector<GenomicRegion> regions{read_bed_regions(bed_path.string())};
+
+  ASSERT_EQ(regions.size(), 2);
+  EXPECT_EQ(regions[0].to_string(), "{chr1}:50178901-50179000");
+  EXPECT_EQ(regions[1].to_string(), "{chr1}:50179401-50179600");
+}
+
+TEST(GenomicRegion, ReadMissingBed){
+  EXPECT_THROW(read_bed_regions("no_such_file.bed"), std::runtime_error);
+}
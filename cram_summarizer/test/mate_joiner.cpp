@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include "alignment_fixture.hpp"
+#include "app.hpp"
+#include "mate_joiner.hpp"
+
+namespace bj = boost::json;
+
+TEST(MateJoiner, JoinPairOnSecondMate){
+  std::stringstream out{};
+  MateJoiner joiner{out, 1000};
+
+  joiner.add(SimpleAlignment{"q1", "chr1", 100, 250, true}, 0, 100, 0, 300);
+  EXPECT_EQ(out.str(), "");
+  EXPECT_EQ(joiner.n_pending(), 1);
+
+  joiner.add(SimpleAlignment{"q1", "chr1", 300, 450, false}, 0, 300, 0, 100);
+  EXPECT_EQ(out.str(),
+      "{\"qname\":\"q1\",\"pair\":[{\"chr\":\"chr1\",\"start\":100,\"end\":250,\"is_reverse\":false},"
+      "{\"chr\":\"chr1\",\"start\":300,\"end\":450,\"is_reverse\":true}],"
+      "\"orientation\":\"FR\",\"insert_size\":350,\"class\":\"concordant\"}\n");
+  EXPECT_EQ(joiner.n_pending(), 0);
+  EXPECT_EQ(joiner.n_joined(), 1);
+}
+
+TEST(MateJoiner, ClassifyDiscordantPairs){
+  std::stringstream out{};
+  MateJoiner joiner{out, 1000};
+
+  joiner.add(SimpleAlignment{"inter", "chr1", 100, 250, true}, 0, 100, 1, 50);
+  joiner.add(SimpleAlignment{"inv", "chr1", 200, 350, true}, 0, 200, 0, 400);
+  joiner.add(SimpleAlignment{"evert", "chr1", 300, 450, false}, 0, 300, 0, 500);
+  joiner.add(SimpleAlignment{"long", "chr1", 350, 500, true}, 0, 350, 0, 5000);
+  joiner.add(SimpleAlignment{"inv", "chr1", 400, 550, true}, 0, 400, 0, 200);
+  joiner.add(SimpleAlignment{"evert", "chr1", 500, 650, true}, 0, 500, 0, 300);
+  joiner.add(SimpleAlignment{"long", "chr1", 5000, 5150, false}, 0, 5000, 0, 350);
+  joiner.add(SimpleAlignment{"inter", "chr2", 50, 200, false}, 1, 50, 0, 100);
+  joiner.finish();
+
+  std::vector<bj::object> lines{};
+  std::string line{};
+  while(std::getline(out, line)){
+    lines.push_back(bj::parse(line).as_object());
+  }
+
+  ASSERT_EQ(lines.size(), 4);
+  EXPECT_EQ(lines[0].at("class"), "inverted");
+  EXPECT_EQ(lines[0].at("orientation"), "FF");
+  EXPECT_EQ(lines[1].at("class"), "everted");
+  EXPECT_EQ(lines[1].at("orientation"), "RF");
+  EXPECT_EQ(lines[2].at("class"), "long_insert");
+  EXPECT_EQ(lines[2].at("insert_size"), 4800);
+  EXPECT_EQ(lines[3].at("class"), "interchromosomal");
+  EXPECT_TRUE(lines[3].at("insert_size").is_null());
+  EXPECT_EQ(joiner.n_unpaired(), 0);
+}
+
+TEST(MateJoiner, EvictMatesPassedByCoordinate){
+  std::stringstream out{};
+  MateJoiner joiner{out, 1000};
+
+  // The mate of q1 is due at 300 but is never read, e.g. filtered out for low mapping quality.
+  joiner.add(SimpleAlignment{"q1", "chr1", 100, 250, true}, 0, 100, 0, 300);
+  joiner.add(SimpleAlignment{"q2", "chr1", 300, 450, true}, 0, 300, 0, 600);
+  EXPECT_EQ(joiner.n_unpaired(), 0);
+
+  joiner.add(SimpleAlignment{"q3", "chr1", 301, 451, true}, 0, 301, -1, 0);
+  EXPECT_EQ(joiner.n_unpaired(), 2);
+  EXPECT_EQ(joiner.n_pending(), 1);
+  EXPECT_THAT(out.str(), testing::StartsWith(
+      "{\"qname\":\"q1\",\"pair\":[{\"chr\":\"chr1\",\"start\":100,\"end\":250,\"is_reverse\":false}],"
+      "\"orientation\":null,\"insert_size\":null,\"class\":\"unpaired\"}\n"));
+
+  // Mates behind the current position that were not seen are unpaired at once.
+  joiner.add(SimpleAlignment{"q4", "chr1", 400, 550, false}, 0, 400, 0, 200);
+  EXPECT_EQ(joiner.n_unpaired(), 3);
+
+  joiner.finish();
+  EXPECT_EQ(joiner.n_pending(), 0);
+  EXPECT_EQ(joiner.n_unpaired(), 4);
+}
+
+TEST(MateJoiner, RejectUnsortedInput){
+  std::stringstream out{};
+  MateJoiner joiner{out, 1000};
+
+  joiner.add(SimpleAlignment{"q1", "chr1", 500, 650, true}, 0, 500, 0, 700);
+  EXPECT_THROW(joiner.add(SimpleAlignment{"q2", "chr1", 100, 250, true}, 0, 100, 0, 300), std::runtime_error);
+}
+
+TEST(MateJoiner, RunAccountsForEveryPairedAlignment){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+
+  AppControlData control{};
+  control.input_path = sam_path.string();
+  control.join_mates = true;
+  testing::internal::CaptureStdout();
+  ASSERT_TRUE(run(control));
+  std::stringstream out{testing::internal::GetCapturedStdout()};
+
+  Accounting counts{};
+  AlignmentReader reader{sam_path.string(), ""};
+  summarize_alignments(reader, counts, [](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){});
+
+  int64_t n_paired_alignments{0};
+  std::string line{};
+  while(std::getline(out, line)){
+    bj::object obj{bj::parse(line).as_object()};
+    if(obj.contains("pair")){
+      n_paired_alignments += obj.at("pair").as_array().size();
+    }
+  }
+  EXPECT_EQ(n_paired_alignments, counts.paired);
+}
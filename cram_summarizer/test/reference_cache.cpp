@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "alignment_fixture.hpp"
+#include "cram_reader.hpp"
+#include "reference_cache.hpp"
+
+TEST(ReferenceCache, ReadersShareReference){
+  std::filesystem::path gen_dir{GENERATED_DATA_DIR};
+  std::filesystem::path cram_path{gen_dir / "del_1_sample_1.cram"};
+  std::filesystem::path ref_path{gen_dir / "del_1.fa"};
+  if(!std::filesystem::is_regular_file(cram_path) || !std::filesystem::is_regular_file(ref_path)){
+    GTEST_SKIP() << "Generated Test Data Missing: " << cram_path;
+  }
+
+  ReferenceCache& cache{ReferenceCache::instance()};
+  int64_t init_hits{cache.hits()};
+  int64_t init_misses{cache.misses()};
+
+  AlignmentReader reader_1{cram_path.string(), ref_path.string()};
+  AlignmentReader reader_2{cram_path.string(), ref_path.string()};
+
+  EXPECT_LE(cache.misses() - init_misses, 1);
+  EXPECT_GE(cache.hits() - init_hits, 1);
+}
+
+TEST(ReferenceCache, SharesReferenceAcrossPathSpellings){
+  std::filesystem::path gen_dir{GENERATED_DATA_DIR};
+  std::filesystem::path cram_path{gen_dir / "del_1_sample_1.cram"};
+  std::filesystem::path ref_path{gen_dir / "del_1.fa"};
+  if(!std::filesystem::is_regular_file(cram_path) || !std::filesystem::is_regular_file(ref_path)){
+    GTEST_SKIP() << "Generated Test Data Missing: " << cram_path;
+  }
+  std::filesystem::path respelled_path{gen_dir / "." / ".." / gen_dir.filename() / "del_1.fa"};
+
+  ReferenceCache& cache{ReferenceCache::instance()};
+  AlignmentReader reader_1{cram_path.string(), ref_path.string()};
+  int64_t init_misses{cache.misses()};
+
+  AlignmentReader reader_2{cram_path.string(), respelled_path.string()};
+
+  EXPECT_EQ(cache.misses(), init_misses);
+}
+
+TEST(ReferenceCache, IgnoredForSam){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "del_1_sample_1.sam"};
+
+  ReferenceCache& cache{ReferenceCache::instance()};
+  int64_t init_hits{cache.hits()};
+  int64_t init_misses{cache.misses()};
+
+  AlignmentReader reader{sam_path.string(), "no_such_reference.fa"};
+
+  EXPECT_EQ(cache.hits(), init_hits);
+  EXPECT_EQ(cache.misses(), init_misses);
+}
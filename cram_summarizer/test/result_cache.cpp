@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include "alignment_fixture.hpp"
+#include "app.hpp"
+
+namespace bj = boost::json;
+namespace fs = std::filesystem;
+
+static size_t count_entries(const fs::path& cache_dir){
+  size_t n_entries{0};
+  for(auto& dir_entry : fs::directory_iterator{cache_dir}){
+    n_entries += dir_entry.path().extension() == ".gz";
+  }
+  return n_entries;
+}
+
+TEST(ResultCache, ReusesDocumentUntilInputChanges){
+  TestTempDir temp_dir{};
+  fs::path cache_dir{temp_dir.path("cache")};
+  ResultCache& cache{ResultCache::instance()};
+  cache.init(cache_dir.string(), 1 << 20, "1.0.0", SUMMARY_FORMAT);
+
+  fs::path input_path{cache_dir / "input.sam"};
+  std::ofstream{input_path} << "input";
+  std::vector<GenomicRegion> regions{{"chr1", 99, 200}};
+
+  int n_summaries{0};
+  auto summarize = [&n_summaries](){
+    n_summaries++;
+    return std::string("{\"all_pairs\":{},\"n\":") + std::to_string(n_summaries) + "}";
+  };
+
+  int64_t init_hits{cache.hits()};
+  int64_t init_misses{cache.misses()};
+  std::string document{cache.get_or_make(input_path.string(), "", regions, summarize)};
+  EXPECT_EQ(cache.get_or_make(input_path.string(), "", regions, summarize), document);
+  EXPECT_EQ(n_summaries, 1);
+  EXPECT_EQ(cache.hits() - init_hits, 1);
+  EXPECT_EQ(cache.misses() - init_misses, 1);
+
+  // Other regions, versions, summary formats, references, or contents of the input are separate entries.
+  cache.get_or_make(input_path.string(), "", {}, summarize);
+  EXPECT_EQ(n_summaries, 2);
+
+  std::string key{cache.make_key(input_path.string(), "", regions)};
+  cache.init(cache_dir.string(), 1 << 20, "1.0.1", SUMMARY_FORMAT);
+  EXPECT_NE(cache.make_key(input_path.string(), "", regions), key);
+  cache.init(cache_dir.string(), 1 << 20, "1.0.0", SUMMARY_FORMAT + 1);
+  EXPECT_NE(cache.make_key(input_path.string(), "", regions), key);
+  cache.init(cache_dir.string(), 1 << 20, "1.0.0", SUMMARY_FORMAT);
+  EXPECT_EQ(cache.make_key(input_path.string(), "", regions), key);
+
+  fs::path ref_path{cache_dir / "ref.fa"};
+  std::ofstream{ref_path} << ">chr1\nACGT\n";
+  std::string ref_key{cache.make_key(input_path.string(), ref_path.string(), regions)};
+  EXPECT_NE(ref_key, key);
+  std::ofstream{ref_path} << ">chr1\nACGTACGT\n";
+  EXPECT_NE(cache.make_key(input_path.string(), ref_path.string(), regions), ref_key);
+  // A reference that is not a file cannot be cached.
+  EXPECT_EQ(cache.make_key(input_path.string(), (cache_dir / "missing.fa").string(), regions), "");
+
+  std::ofstream{input_path} << "changed input";
+  EXPECT_NE(cache.make_key(input_path.string(), "", regions), key);
+
+  // Stdin is never cached.
+  EXPECT_EQ(cache.make_key("", "", regions), "");
+  cache.get_or_make("", "", regions, summarize);
+  cache.get_or_make("", "", regions, summarize);
+  EXPECT_EQ(n_summaries, 4);
+
+  cache.init("", 0, "", 0);
+  EXPECT_FALSE(cache.is_enabled());
+}
+
+TEST(ResultCache, CorruptEntriesMiss){
+  TestTempDir temp_dir{};
+  fs::path cache_dir{temp_dir.path("cache")};
+  ResultCache& cache{ResultCache::instance()};
+  cache.init(cache_dir.string(), 1 << 20, "1.0.0", SUMMARY_FORMAT);
+
+  std::string document{};
+  cache.store("key", "{\"all_splits\":{}}");
+  ASSERT_TRUE(cache.load("key", document));
+  EXPECT_EQ(document, "{\"all_splits\":{}}");
+  EXPECT_FALSE(cache.load("other key", document));
+
+  for(auto& dir_entry : fs::directory_iterator{cache_dir}){
+    fs::resize_file(dir_entry.path(), dir_entry.file_size() - 4);
+  }
+  EXPECT_FALSE(cache.load("key", document));
+
+  cache.init("", 0, "", 0);
+}
+
+TEST(ResultCache, EvictsLeastRecentlyUsed){
+  TestTempDir temp_dir{};
+  fs::path cache_dir{temp_dir.path("cache")};
+  ResultCache& cache{ResultCache::instance()};
+  cache.init(cache_dir.string(), 1 << 20, "1.0.0", SUMMARY_FORMAT);
+
+  std::string document{};
+  cache.store("old", std::string(1000, 'o'));
+  uintmax_t entry_size{fs::file_size(fs::directory_iterator{cache_dir}->path())};
+  cache.store("new", std::string(1000, 'n'));
+  for(auto& dir_entry : fs::directory_iterator{cache_dir}){
+    fs::last_write_time(dir_entry.path(), fs::file_time_type::clock::now() - std::chrono::hours(2));
+  }
+
+  // Room for two entries. Reading old leaves new least recently used.
+  cache.init(cache_dir.string(), 2 * entry_size + entry_size / 2, "1.0.0", SUMMARY_FORMAT);
+  ASSERT_TRUE(cache.load("old", document));
+  cache.store("newest", std::string(1000, 'x'));
+
+  EXPECT_EQ(count_entries(cache_dir), 2);
+  EXPECT_TRUE(cache.load("old", document));
+  EXPECT_FALSE(cache.load("new", document));
+  EXPECT_TRUE(cache.load("newest", document));
+
+  cache.init("", 0, "", 0);
+}
+
+TEST(ResultCache, RunPrintsCachedSummary){
+  fs::path sam_path{fs::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+  TestTempDir temp_dir{};
+  fs::path cache_dir{temp_dir.path("cache")};
+  fs::path stats_path{temp_dir.path("stats.json")};
+
+  AppControlData control{};
+  control.input_path = sam_path.string();
+  control.cache_dir = cache_dir.string();
+  control.stats_path = stats_path.string();
+
+  std::vector<std::string> outputs{};
+  std::vector<bj::object> stats{};
+  for(int i{0}; i < 2; i++){
+    testing::internal::CaptureStdout();
+    ASSERT_TRUE(run(control));
+    outputs.push_back(testing::internal::GetCapturedStdout());
+
+    stats.push_back(bj::parse(read_text(stats_path)).as_object());
+  }
+
+  EXPECT_EQ(outputs[0], outputs[1]);
+  EXPECT_GT(stats[0].at("records").as_int64(), 0);
+  EXPECT_EQ(stats[0].at("counts").as_object().at("result_cache_misses").as_int64(),
+            stats[1].at("counts").as_object().at("result_cache_misses").as_int64());
+  EXPECT_EQ(stats[1].at("counts").as_object().at("result_cache_hits").as_int64(),
+            stats[0].at("counts").as_object().at("result_cache_hits").as_int64() + 1);
+  // The hit read no records.
+  EXPECT_EQ(stats[1].at("records").as_int64(), 0);
+
+  control.cache_dir.clear();
+  control.stats_path.clear();
+  testing::internal::CaptureStdout();
+  ASSERT_TRUE(run(control));
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), outputs[0]);
+}
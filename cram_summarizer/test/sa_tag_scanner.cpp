@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <string_view>
+#include "sa_tag_scanner.hpp"
+
+TEST(SaTagScanner, MultipleRecords){
+  constexpr std::string_view sa_value{"chr1,100,+,50S101M,60,0;chr2,2000,-,30M2D70M51S,20,3;"};
+  SaTagScanner scanner{sa_value};
+  SaRecord rec{};
+
+  ASSERT_TRUE(scanner.next(rec));
+  EXPECT_EQ(rec.rname, "chr1");
+  EXPECT_EQ(rec.pos, 100);
+  EXPECT_TRUE(rec.is_forward_strand);
+  EXPECT_EQ(rec.cigar, "50S101M");
+  EXPECT_EQ(rec.ref_span, 101);
+  EXPECT_EQ(rec.mapq, 60);
+  EXPECT_EQ(rec.nm, 0);
+
+  ASSERT_TRUE(scanner.next(rec));
+  EXPECT_EQ(rec.rname, "chr2");
+  EXPECT_EQ(rec.pos, 2000);
+  EXPECT_FALSE(rec.is_forward_strand);
+  EXPECT_EQ(rec.ref_span, 102);
+  EXPECT_EQ(rec.mapq, 20);
+  EXPECT_EQ(rec.nm, 3);
+
+  EXPECT_FALSE(scanner.next(rec));
+}
+
+TEST(SaTagScanner, TagIdentifierPrefix){
+  SaTagScanner scanner{"SA:Z:chr1,100,+,151M,60,0;"};
+  SaRecord rec{};
+
+  ASSERT_TRUE(scanner.next(rec));
+  EXPECT_EQ(rec.rname, "chr1");
+  EXPECT_EQ(rec.ref_span, 151);
+}
+
+TEST(SaTagScanner, SkipMalformedRecord){
+  SaTagScanner scanner{"chr1,abc,+,151M,60,0;chr3,300,*,151M,60,0;chr4,400,-,151M,60,1;"};
+  SaRecord rec{};
+
+  ASSERT_TRUE(scanner.next(rec));
+  EXPECT_EQ(rec.rname, "chr4");
+  EXPECT_FALSE(scanner.next(rec));
+}
+
+TEST(SaTagScanner, EmptyValue){
+  SaTagScanner scanner{""};
+  SaRecord rec{};
+
+  EXPECT_FALSE(scanner.next(rec));
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "streaming_writer.hpp"
+#include "test_support.hpp"
+
+TEST(StreamingWriter, EmitPairOncePassed){
+  std::stringstream out{};
+  StreamingWriter writer{out, 1000};
+
+  writer.add(SimpleAlignment{"q1", "chr1", 100, 250, true}, AlnType::PAIRED, 0, 100, 0, 300);
+  writer.add(SimpleAlignment{"q2", "chr1", 150, 300, true}, AlnType::PAIRED, 0, 150, 0, 150);
+  writer.add(SimpleAlignment{"q1", "chr1", 300, 450, false}, AlnType::PAIRED, 0, 300, 0, 100);
+
+  // q2 has no mate pending, q1 waits until reads pass its mate.
+  EXPECT_EQ(out.str(),
+      "{\"all_pairs\":{\"q2\":[{\"chr\":\"chr1\",\"start\":150,\"end\":300,\"is_reverse\":false}]}}\n");
+  EXPECT_EQ(writer.n_pending(), 1);
+
+  writer.add(SimpleAlignment{"q3", "chr1", 301, 451, true}, AlnType::SPLIT, 0, 301, 0, 301);
+  EXPECT_EQ(writer.n_pending(), 1);
+  EXPECT_THAT(out.str(), testing::HasSubstr(
+      "{\"all_pairs\":{\"q1\":[{\"chr\":\"chr1\",\"start\":100,\"end\":250,\"is_reverse\":false},"
+      "{\"chr\":\"chr1\",\"start\":300,\"end\":450,\"is_reverse\":true}]}}\n"));
+
+  writer.finish();
+  EXPECT_EQ(writer.n_pending(), 0);
+  EXPECT_THAT(out.str(), testing::EndsWith(
+      "{\"all_splits\":{\"q3\":[{\"chr\":\"chr1\",\"start\":301,\"end\":451,\"is_reverse\":false}]}}\n"));
+}
+
+TEST(StreamingWriter, SpillLongRangeGroups){
+  std::stringstream out{};
+  StreamingWriter writer{out, 1000};
+
+  writer.add(SimpleAlignment{"far", "chr1", 100, 250, true}, AlnType::PAIRED, 0, 100, 1, 500);
+  writer.add(SimpleAlignment{"far", "chr2", 500, 650, false}, AlnType::PAIRED, 1, 500, 0, 100);
+
+  EXPECT_EQ(writer.n_pending(), 0);
+  EXPECT_EQ(writer.n_spilled(), 2);
+  EXPECT_EQ(out.str(), "");
+
+  writer.finish();
+  EXPECT_EQ(out.str(),
+      "{\"all_pairs\":{\"far\":[{\"chr\":\"chr1\",\"start\":100,\"end\":250,\"is_reverse\":false},"
+      "{\"chr\":\"chr2\",\"start\":500,\"end\":650,\"is_reverse\":true}]}}\n");
+}
+
+/* Lines written by a writer with the given partition bound for pairs spanning contigs. */
+static std::vector<std::string> spilled_lines(const std::filesystem::path& spill_dir, const int64_t max_partition_bytes){
+  std::stringstream out{};
+  StreamingWriter writer{out, 1000, spill_dir.string(), max_partition_bytes};
+  for(int i{0}; i < 500; i++){
+    writer.add(SimpleAlignment{"q" + std::to_string(i), "chr1", i, i + 100, true}, AlnType::PAIRED, 0, i, 1, i);
+  }
+  for(int i{0}; i < 500; i++){
+    writer.add(SimpleAlignment{"q" + std::to_string(i), "chr2", i, i + 100, false}, AlnType::PAIRED, 1, i, 0, i);
+  }
+  writer.finish();
+
+  std::vector<std::string> lines{};
+  for(std::string line{}; std::getline(out, line);){
+    lines.push_back(line);
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+TEST(StreamingWriter, SplitOversizedPartitions){
+  TestTempDir temp_dir{};
+  std::filesystem::path spill_dir{temp_dir.path("spill")};
+  std::filesystem::create_directory(spill_dir);
+
+  std::vector<std::string> whole{spilled_lines(spill_dir, int64_t{1} << 28)};
+  // About 25 kB spilled, so each partition is split at least once.
+  std::vector<std::string> split{spilled_lines(spill_dir, 256)};
+
+  ASSERT_EQ(whole.size(), 500);
+  EXPECT_EQ(split, whole);
+  EXPECT_TRUE(std::filesystem::is_empty(spill_dir));
+}
+
+TEST(StreamingWriter, RejectUnsortedInput){
+  std::stringstream out{};
+  StreamingWriter writer{out, 1000};
+
+  writer.add(SimpleAlignment{"q1", "chr1", 500, 650, true}, AlnType::PAIRED, 0, 500, 0, 500);
+  EXPECT_THROW(
+      writer.add(SimpleAlignment{"q2", "chr1", 100, 250, true}, AlnType::PAIRED, 0, 100, 0, 100),
+      std::runtime_error);
+}
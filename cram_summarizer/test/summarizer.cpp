@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "alignment_fixture.hpp"
+#include "app.hpp"
+
+namespace bj = boost::json;
+
+/* Summarize test sam into single document the way run() does. */
+bj::object summarize_document(const std::string& path){
+  bj::object all_data{init_top_level_json()};
+  Accounting counts{};
+  AlignmentReader reader{path, ""};
+
+  summarize_alignments(reader, counts,
+      [&all_data](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        add_alignment(all_data, sa, aln_type);
+      });
+  return all_data;
+}
+
+/* Summarize test sam with the streaming writer and merge the emitted lines into one document. */
+bj::object summarize_streamed(const std::string& path, const int64_t window){
+  std::stringstream out{};
+  Accounting counts{};
+  AlignmentReader reader{path, ""};
+  StreamingWriter writer{out, window};
+
+  summarize_alignments(reader, counts,
+      [&writer](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        writer.add(sa, aln_type, rec.get_tid(), rec.get_start(),
+                   rec.expects_mate() ? rec.get_mate_tid() : rec.get_tid(),
+                   rec.expects_mate() ? rec.get_mate_start() : rec.get_start());
+      });
+  writer.finish();
+
+  bj::object merged{init_top_level_json()};
+  std::string line{};
+  while(std::getline(out, line)){
+    bj::value line_value{bj::parse(line)};
+    for(auto& type_kv : line_value.as_object()){
+      bj::object& type_container{merged[type_kv.key()].as_object()};
+      for(auto& qname_kv : type_kv.value().as_object()){
+        // A query name group must be emitted exactly once.
+        EXPECT_FALSE(type_container.contains(qname_kv.key())) << qname_kv.key();
+        type_container[qname_kv.key()] = qname_kv.value();
+      }
+    }
+  }
+  return merged;
+}
+
+class StreamedDocument : public testing::TestWithParam<int64_t> {};
+
+TEST_P(StreamedDocument, MatchesDocumentGroups){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+
+  bj::object document{summarize_document(sam_path.string())};
+  bj::object streamed{summarize_streamed(sam_path.string(), GetParam())};
+
+  for(auto& type_kv : document){
+    const bj::object& doc_groups{type_kv.value().as_object()};
+    const bj::object& streamed_groups{streamed.at(type_kv.key()).as_object()};
+
+    EXPECT_EQ(doc_groups.size(), streamed_groups.size()) << type_kv.key();
+    for(auto& qname_kv : doc_groups){
+      EXPECT_EQ(qname_kv.value(), streamed_groups.at(qname_kv.key())) << qname_kv.key();
+    }
+  }
+}
+
+// Small window exercises the spill path, large window keeps all groups in memory.
+INSTANTIATE_TEST_SUITE_P( StreamWindows, StreamedDocument, testing::Values(10, 1000000));
+
+/* Handler calls of summarizing test sam as strings in call order. */
+std::vector<std::string> summarize_calls(const std::string& path, Accounting& counts,
+                                         const int n_classifiers, const size_t batch_size){
+  std::vector<std::string> calls{};
+  AlignmentReader reader{path, ""};
+
+  summarize_alignments(reader, counts,
+      [&calls](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+        std::stringstream call{};
+        call << aln_type << " " << sa.qname << " " << sa << " " << rec.get_tid() << ":" << rec.get_start();
+        calls.push_back(call.str());
+      }, n_classifiers, batch_size);
+  return calls;
+}
+
+class PipelinedSummary : public testing::TestWithParam<std::tuple<int, size_t>> {};
+
+TEST_P(PipelinedSummary, MatchesSerialOrderAndCounts){
+  auto [n_classifiers, batch_size] = GetParam();
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+
+  Accounting serial_counts{};
+  Accounting pipelined_counts{};
+  std::vector<std::string> serial{summarize_calls(sam_path.string(), serial_counts, 0, batch_size)};
+  std::vector<std::string> pipelined{summarize_calls(sam_path.string(), pipelined_counts, n_classifiers, batch_size)};
+
+  ASSERT_FALSE(serial.empty());
+  EXPECT_EQ(serial, pipelined);
+  EXPECT_EQ(serial_counts.total, pipelined_counts.total);
+  EXPECT_EQ(serial_counts.qc_fail, pipelined_counts.qc_fail);
+  EXPECT_EQ(serial_counts.unmapped, pipelined_counts.unmapped);
+  EXPECT_EQ(serial_counts.duplicate, pipelined_counts.duplicate);
+  EXPECT_EQ(serial_counts.bad_mapq, pipelined_counts.bad_mapq);
+  EXPECT_EQ(serial_counts.paired, pipelined_counts.paired);
+  EXPECT_EQ(serial_counts.split, pipelined_counts.split);
+  EXPECT_EQ(serial_counts.split_sa, pipelined_counts.split_sa);
+}
+
+// Small batches cycle records through the ring of slots many times.
+INSTANTIATE_TEST_SUITE_P( ClassifiersAndBatches, PipelinedSummary,
+    testing::Combine(testing::Values(1, 3), testing::Values(1, 7, 1024)));
+
+/* Input of test data, sam from the source and cram generated from it. Reference is the fasta of its variant. */
+class MinimalDecode : public testing::TestWithParam<std::string> {};
+
+TEST_P(MinimalDecode, DocumentMatchesFullDecode){
+  std::filesystem::path input_path{GetParam()};
+  std::filesystem::path data_dir{input_path.extension() == ".sam" ? SRC_TEST_DATA_DIR : GENERATED_DATA_DIR};
+  input_path = data_dir / input_path;
+  std::string variant_id{input_path.stem().string()};
+  variant_id = variant_id.substr(0, variant_id.find("_sample"));
+  if(!std::filesystem::is_regular_file(input_path)){
+    GTEST_SKIP() << "Generated Test Data Missing: " << input_path;
+  }
+
+  AppControlData control{};
+  control.ref_path = (data_dir / (variant_id + ".fa")).string();
+
+  Accounting full_counts{};
+  bj::object full{summarize_document(*open_reader(input_path.string(), control), control, full_counts)};
+
+  control.minimal_decode = true;
+  Accounting minimal_counts{};
+  bj::object minimal{summarize_document(*open_reader(input_path.string(), control), control, minimal_counts)};
+
+  EXPECT_GT(full_counts.total, 0);
+  EXPECT_EQ(bj::serialize(minimal), bj::serialize(full));
+  EXPECT_EQ(minimal_counts.total, full_counts.total);
+  EXPECT_EQ(minimal_counts.qc_fail, full_counts.qc_fail);
+  EXPECT_EQ(minimal_counts.unmapped, full_counts.unmapped);
+  EXPECT_EQ(minimal_counts.duplicate, full_counts.duplicate);
+  EXPECT_EQ(minimal_counts.bad_mapq, full_counts.bad_mapq);
+  EXPECT_EQ(minimal_counts.paired, full_counts.paired);
+  EXPECT_EQ(minimal_counts.split, full_counts.split);
+  EXPECT_EQ(minimal_counts.split_sa, full_counts.split_sa);
+}
+
+INSTANTIATE_TEST_SUITE_P( SamAndCram, MinimalDecode,
+    testing::Values("del_1_sample_1.sam", "dup_1_sample_1.sam", "inv_1_sample_1.sam",
+                    "del_1_sample_1.cram", "dup_1_sample_1.cram", "inv_1_sample_1.cram"));
+
+TEST(PipelinedSummary, HandlerErrorPropagates){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+  AlignmentReader reader{sam_path.string(), ""};
+  Accounting counts{};
+
+  EXPECT_THROW(
+      summarize_alignments(reader, counts,
+          [](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){
+            throw std::runtime_error("handler failed");
+          }, 2, 5),
+      std::runtime_error);
+}
+
+TEST(PipelinedSummary, ReadErrorPropagates){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "malformed.sam"};
+  AlignmentReader reader{sam_path.string(), ""};
+  Accounting counts{};
+
+  EXPECT_THROW(
+      summarize_alignments(reader, counts,
+          [](const AlignmentRecord& rec, SimpleAlignment& sa, AlnType aln_type){}, 2, 1),
+      std::runtime_error);
+}
+
+TEST(StatsOutput, RunWritesStageTimesAndCounts){
+  std::filesystem::path sam_path{std::filesystem::path{SRC_TEST_DATA_DIR} / "dup_1_sample_1.sam"};
+  TestTempDir temp_dir{};
+  std::filesystem::path stats_path{temp_dir.path("stats.json")};
+
+  Accounting counts{};
+  summarize_calls(sam_path.string(), counts, 0, 1);
+
+  AppControlData control{};
+  control.input_path = sam_path.string();
+  control.stats_path = stats_path.string();
+  testing::internal::CaptureStdout();
+  ASSERT_TRUE(run(control));
+  testing::internal::GetCapturedStdout();
+
+  bj::object stats{bj::parse(read_text(stats_path)).as_object()};
+  const bj::object& stage_times{stats.at("stages").as_object()};
+  const bj::object& stat_counts{stats.at("counts").as_object()};
+
+  EXPECT_EQ(stats.at("tool"), "cram_summ");
+  EXPECT_EQ(stat_counts.at("total"), counts.total);
+  EXPECT_EQ(stat_counts.at("split_sa"), counts.split_sa);
+  EXPECT_EQ(stats.at("records"), counts.total + counts.qc_fail + counts.unmapped + counts.duplicate +
+                                  counts.bad_mapq);
+  for(const char* stage : STAGE_NAMES){
+    EXPECT_TRUE(stage_times.contains(stage)) << stage;
+  }
+  EXPECT_GT(stage_times.at("decode").as_object().at("wall_s").as_double(), 0);
+  EXPECT_GT(stats.at("peak_rss_kb").as_int64(), 0);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "alignment_fixture.hpp"
+#include "summary_server.hpp"
+
+namespace bj = boost::json;
+namespace fs = std::filesystem;
+
+static std::vector<BatchEntry> sam_entries(){
+  return read_manifest((fs::path{SRC_TEST_DATA_DIR} / "del_1_manifest.tsv").string());
+}
+
+/* Connect to server socket at socket_path. */
+static int connect_client(const fs::path& socket_path){
+  int fd{socket(AF_UNIX, SOCK_STREAM, 0)};
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  socket_path.string().copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+  if(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0){
+    close(fd);
+    throw std::runtime_error("Failed to connect to test server");
+  }
+  return fd;
+}
+
+/* Send request lines and read until n_lines response lines have arrived. */
+static std::vector<std::string> exchange(const int fd, const std::string& requests, const size_t n_lines){
+  EXPECT_EQ(write(fd, requests.data(), requests.size()), static_cast<ssize_t>(requests.size()));
+
+  std::string received{};
+  char chunk[4096];
+  while(std::count(received.begin(), received.end(), '\n') < static_cast<ptrdiff_t>(n_lines)){
+    ssize_t n_read{read(fd, chunk, sizeof(chunk))};
+    if(n_read <= 0){ break; }
+    received.append(chunk, n_read);
+  }
+
+  std::vector<std::string> lines{};
+  for(size_t start{0}, end{received.find('\n')}; end != std::string::npos;
+      start = end + 1, end = received.find('\n', start)){
+    lines.push_back(received.substr(start, end - start));
+  }
+  return lines;
+}
+
+TEST(ReaderCache, EvictsLeastRecentlyUsed){
+  fs::path sam_path{fs::path{SRC_TEST_DATA_DIR} / "del_1_sample_1.sam"};
+  ReaderCache cache{2, [&sam_path](const std::string& sample){
+    if(sample == "bad"){
+      throw std::runtime_error("Failed to open: bad");
+    }
+    return std::make_unique<AlignmentReader>(sam_path.string(), "");
+  }};
+
+  for(const char* sample : {"a", "b", "a", "c", "a", "b"}){
+    ReaderCache::Lease lease{cache.acquire(sample)};
+    EXPECT_NE(lease.reader().get_header(), nullptr);
+  }
+
+  // b was least recently used when c was opened, so it was reopened.
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 4);
+
+  EXPECT_THROW(cache.acquire("bad"), std::runtime_error);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(SummaryServer, AnswersErrorsAsJson){
+  TestTempDir temp_dir{};
+  fs::path socket_path{temp_dir.path("server.sock")};
+  AppControlData control{};
+  control.serve_path = socket_path.string();
+  SummaryServer server{sam_entries(), control};
+
+  for(const char* request : {"missing_sample\tchr1", "del_1_sample_1\tchr1:0-10", "del_1_sample_1"}){
+    bj::value response{bj::parse(server.answer(request))};
+    EXPECT_TRUE(response.as_object().contains("error")) << request;
+  }
+
+  // SAM input has no index to query.
+  bj::value response{bj::parse(server.answer("del_1_sample_1\tchr1:50178900-50179100"))};
+  EXPECT_TRUE(response.as_object().contains("error"));
+}
+
+TEST(SummaryServer, MatchesRegionSummaryOfCram){
+  fs::path cram_path{fs::path{GENERATED_DATA_DIR} / "del_1_sample_1.cram"};
+  if(!fs::is_regular_file(cram_path)){
+    GTEST_SKIP() << "Generated Test Data Missing: " << cram_path;
+  }
+
+  TestTempDir temp_dir{};
+  fs::path socket_path{temp_dir.path("server.sock")};
+  AppControlData control{};
+  control.serve_path = socket_path.string();
+  SummaryServer server{{{"del_1_sample_1", cram_path.string(), {}}}, control};
+
+  std::vector<GenomicRegion> regions{{"chr1", 50178899, 50179100}};
+  Accounting counts{};
+  AlignmentReader reader{cram_path.string(), ""};
+  reader.set_regions(regions);
+  bj::value expected{summarize_document(reader, control, counts)};
+
+  // The second query reuses the reader left open by the first.
+  for(int i{0}; i < 2; i++){
+    EXPECT_EQ(bj::parse(server.answer("del_1_sample_1\tchr1:50178900-50179100")), expected);
+  }
+  EXPECT_EQ(server.readers().misses(), 1);
+  EXPECT_EQ(server.readers().hits(), 1);
+  EXPECT_EQ(server.counts().total, 2 * counts.total);
+}
+
+TEST(SummaryServer, ServesConcurrentConnections){
+  TestTempDir temp_dir{};
+  fs::path socket_path{temp_dir.path("server.sock")};
+  AppControlData control{};
+  control.serve_path = socket_path.string();
+  control.workers = 2;
+  SummaryServer server{sam_entries(), control};
+  std::thread serving{&SummaryServer::serve, &server};
+
+  // The first connection stays open while the second is answered.
+  int first{connect_client(socket_path)};
+  int second{connect_client(socket_path)};
+  std::vector<std::string> lines{exchange(second, "missing_sample\nsample\tchr1\n", 2)};
+  ASSERT_EQ(lines.size(), 2);
+  for(auto& line : lines){
+    EXPECT_TRUE(bj::parse(line).as_object().contains("error")) << line;
+  }
+  EXPECT_EQ(exchange(first, "missing_sample\r\n", 1).size(), 1);
+
+  close(first);
+  close(second);
+  server.stop();
+  serving.join();
+}
+
+TEST(SummaryServer, ClosesIdleConnections){
+  TestTempDir temp_dir{};
+  fs::path socket_path{temp_dir.path("server.sock")};
+  AppControlData control{};
+  control.serve_path = socket_path.string();
+  control.idle_timeout = 1;
+  SummaryServer server{sam_entries(), control};
+  std::thread serving{&SummaryServer::serve, &server};
+
+  // The only worker is held by the idle connection until it times out.
+  int idle{connect_client(socket_path)};
+  int waiting{connect_client(socket_path)};
+  EXPECT_EQ(exchange(waiting, "missing_sample\n", 1).size(), 1);
+
+  char byte{};
+  EXPECT_EQ(read(idle, &byte, 1), 0);
+
+  close(idle);
+  close(waiting);
+  server.stop();
+  serving.join();
+}
@@ -1,5 +1,7 @@
 #include <string>
 #include <random>
+#include "variant_filter.hpp"
+#include "sample_counts.hpp"
 
 #ifndef APP_CTL_DATA
 #define APP_CTL_DATA
@@ -14,10 +16,30 @@ struct AppControlData {
      */
     std::string input_path{"-"};
 
+    /**
+     * Path of output file.  Defaults to '-' which writes to stdout.
+     */
+    std::string output_path{"-"};
+
+    /**
+     * Should output be BGZF compressed.
+     */
+    bool bgzf_output{false};
+
+    /**
+     * Format of output.
+     *   tsv writes one text line per variant.
+     *   carriers writes the binary carrier file of carrier_file.hpp. Action all only.
+     */
+    std::string output_format{"tsv"};
+
     /**
      * Action to take regarding slecting samples.
      *   rnd does random sampling.
      *   all emits all het and homs per variant.
+     *   to-tsv converts a carrier file input to tsv output.
+     *   index writes a het/hom index that rnd and all accept as input.
+     *   stats writes per-sample het, hom, and missing counts to the output path.
      */
     std::string action{"rnd"};
 
@@ -31,11 +53,52 @@ struct AppControlData {
      */
     unsigned int rnd_seed{std::random_device{}()};
 
+    /**
+     * Generator used for sampling.
+     *   legacy draws from one mt19937 stream in file order.
+     *   counter draws from a stream keyed by seed and variant, independent of other variants.
+     */
+    std::string rng_mode{"legacy"};
+
     /**
      * Should ID field be emitted along with CHROM,POS,REF, and ALT.
      */
     bool emit_id{false};
 
+    /**
+     * Subset of samples to decode: comma separated ids, or path of a file of ids.
+     * A leading ^ excludes the listed samples instead. Empty uses all samples.
+     */
+    std::string samples{};
+    bool is_samples_file{false};
+
+    /**
+     * Site criteria applied before genotypes are decoded.
+     */
+    VariantFilter filter{};
+
+    /**
+     * Path to also write per-sample het, hom, and missing counts to. Empty writes none.
+     * Counts are tallied in the same genotype pass as the selected action.
+     */
+    std::string sample_counts_path{};
+
+    /**
+     * Stratification of per-sample counts by SVTYPE and size.
+     */
+    CountStrata count_strata{};
+
+    /**
+     * Path to write JSON of per-stage time, throughput, and peak memory of the run to. Empty writes none.
+     */
+    std::string stats_path{};
+
+    /**
+     * Number of worker threads. More than one processes genomic chunks of indexed input in parallel
+     * and compresses BGZF output in parallel.
+     */
+    int threads{1};
+
     /**
      * Should version string be printed to stdout.
      */
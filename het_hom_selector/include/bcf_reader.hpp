@@ -2,17 +2,38 @@
 #define BCF_READER
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <htslib/vcf.h>
+#include <htslib/tbx.h>
+#include "variant_filter.hpp"
 
-/* Custom deleter to call free on genotype array data */
-struct GT_Deleter {
-  void operator() (int32_t* ptr) {
+class SampleCounts;
+
+/* Custom deleter to call free on genotype and INFO data allocated by htslib */
+struct Free_Deleter {
+  void operator() (void* ptr) {
     free(ptr);
   }
 };
 
+/* Sample ids stored back to back with their lengths, for formatting without copies. */
+class SampleNameTable {
+  public:
+    SampleNameTable() = default;
+    SampleNameTable(char** ids, const int n_ids);
+    explicit SampleNameTable(const std::vector<std::string>& ids);
+
+    std::string_view operator[](const int idx) const;
+    int size() const;
+
+  private:
+    std::string m_chars{};
+    // Start of each id in m_chars, followed by the end of the last.
+    std::vector<size_t> m_offsets{0};
+};
+
 class BcfReader {
   public:
     BcfReader(const std::string& in_path, const bool silent = true);
@@ -21,10 +42,45 @@ class BcfReader {
     // Advance state to next variant.  Return true if successful.
     bool next_variant();
 
+    /* Load CSI index of BCF, or TBI/CSI index of bgzipped VCF. Return false when input has none. */
+    bool load_index();
+    bool has_index() const;
+
+    /* Restrict next_variant to records starting in [beg, end) of contig. Requires loaded index.
+    *  Records overlapping beg but starting before it belong to the previous region.
+    */
+    void set_region(const std::string& contig, const int64_t beg, const int64_t end);
+
+    /* Indexed contigs in file order paired with header contig length, 0 when the header has none. */
+    std::vector<std::pair<std::string, int64_t>> indexed_contigs() const;
+
+    /* Restrict decoding to a subset of samples before reading any variant. Follows bcf_hdr_set_samples:
+    *  comma separated ids, or a file of ids when is_file. A leading ^ excludes the listed samples.
+    *  Sample indexes and ids then refer to the subset, in header order.
+    */
+    void set_samples(const std::string& samples, const bool is_file);
+
+    /* Skip variants failing filter. Site fields are checked before genotypes are decoded. */
+    void set_filter(const VariantFilter& filter);
+
+    /* Tally genotypes of each variant read into counts, stratified by INFO/SVTYPE and length.
+    *  Variants without SVTYPE count as NA. Pass nullptr to stop tallying.
+    */
+    void set_sample_counts(SampleCounts* counts);
+
+    /* Number of variants skipped by the filter so far */
+    int64_t n_filtered() const;
+
+    /* Ids of all samples in use */
+    std::vector<std::string> sample_ids() const;
+
     /* Lookup sample Id corresponding to given index */
     std::string sample_idx_to_id(const int& idx) const;
     std::vector<std::string> sample_idxs_to_ids(const std::vector<int>& idxs) const;
 
+    /* Ids of samples in use, built when the header is read and when samples are set. */
+    const SampleNameTable& sample_names() const;
+
     /* Accessors */
     bool is_data_exhausted() const;
     std::string variant_id() const;
@@ -40,6 +96,15 @@ class BcfReader {
 
     const std::vector<int>& het_idxs() const;
     const std::vector<int>& hom_idxs() const;
+
+    /* When false, next_variant only counts het and hom samples and het_idxs/hom_idxs stay empty.
+    *  Samples are then looked up by rank with carriers_at. Default true.
+    */
+    void set_collect_carriers(const bool collect);
+
+    /* Append sample indexes of het and hom samples at given ascending ranks among all hets or homs. */
+    void carriers_at(const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                     std::vector<int>& het_out, std::vector<int>& hom_out) const;
     void print_genotypes() const;
 
   private:
@@ -48,6 +113,13 @@ class BcfReader {
     bcf_hdr_t*  header{nullptr};
     bcf1_t*     variant{nullptr};
 
+    // Index and region iterator. tbx is set for bgzipped VCF instead of idx.
+    hts_idx_t*  idx{nullptr};
+    tbx_t*      tbx{nullptr};
+    hts_itr_t*  region_itr{nullptr};
+    int64_t     m_region_beg{0};
+    kstring_t   m_line{0, 0, nullptr};
+
     // Flag that end of data has been reached.
     bool m_is_data_exhausted{false};
 
@@ -56,6 +128,7 @@ class BcfReader {
 
     // number of samples
     int  m_num_samples{0};
+    SampleNameTable m_sample_names{};
 
     std::string m_chr{};
     int64_t m_pos{0};
@@ -68,18 +141,52 @@ class BcfReader {
     *  Data is sequence of alleles in sample order:
     *  [sample0_allele0, sample0_allele1, sample1_allele0, sample1_allele1,...]
     */
-    std::unique_ptr<int32_t[], GT_Deleter> gt_array{nullptr};
+    std::unique_ptr<int32_t[], Free_Deleter> gt_array{nullptr};
     int m_num_gt{0};
+    // Allocated length of gt_array. Grown by htslib as needed and reused between variants.
+    int m_gt_capacity{0};
 
     // indexes of heterozygous and homozygous sample ids
     std::vector<int> m_het_sample_id_idxs;
     std::vector<int> m_hom_sample_id_idxs;
+    bool m_collect_carriers{true};
+    int m_num_hets{0};
+    int m_num_homs{0};
 
-    /* Set m_gt_array member to GT data.
+    /* Set m_gt_array member to GT data, reusing its allocation.
     *  Set m_num_gt to length of GT data or negative number indicating an error.
     */
     void read_genotypes();
 
+    // Site filter with region contigs resolved to header ids.
+    VariantFilter m_filter{};
+    bool m_is_filtering{false};
+    std::vector<int> m_filter_region_rids{};
+    int64_t m_num_filtered{0};
+
+    // Reused INFO buffers of filter evaluation, allocated by htslib.
+    std::unique_ptr<int32_t[], Free_Deleter> m_info_ints{nullptr};
+    int m_info_ints_capacity{0};
+    std::unique_ptr<char[], Free_Deleter> m_info_str{nullptr};
+    int m_info_str_capacity{0};
+    std::unique_ptr<float[], Free_Deleter> m_info_floats{nullptr};
+    int m_info_floats_capacity{0};
+
+    // Per-sample genotype counts to tally into, not owned.
+    SampleCounts* m_sample_counts{nullptr};
+
+    /* INFO/SVTYPE of current record, or nullptr when absent. Points into a buffer reused between calls. */
+    const char* info_sv_type();
+
+    /* Absolute INFO/SVLEN of current record, or its reference length when SVLEN is absent. */
+    int64_t info_sv_length();
+
+    /* Evaluate filter on the current record unpacked only up to INFO. */
+    bool passes_filter();
+
+    /* Read next record of region iterator. Return value follows bcf_read. */
+    int read_region_record();
+
     /* Parse CHROM POS ID REF ALT of variant record */
     void parse_variant_core();
 
@@ -0,0 +1,144 @@
+#ifndef CARRIER_FILE
+#define CARRIER_FILE
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Compact binary output of the all action.
+ * The sample dictionary is written once. Each variant stores its site fields and the sample indexes
+ *   of its het and hom carriers, each as a delta+varint list or as a bitmap spanning first to last
+ *   carrier, whichever is smaller.
+ * Variants are grouped into zlib compressed blocks. A footer indexes the file offset, first
+ *   variant number, and first position of every block so readers can seek without decoding.
+ *
+ * Layout, integers little endian or LEB128 varints:
+ *   "HHSC" u8:version u8:emit_id varint:len header_text varint:n_samples {varint:len id}...
+ *   blocks: {u32:raw_size u32:compressed_size u32:n_variants bytes}...
+ *   footer: varint:n_contigs {varint:len name}... varint:n_blocks
+ *           {u64:offset u64:first_variant varint:contig varint:pos}...
+ *   trailer: u64:footer_offset u64:n_variants "HHSC"
+ */
+
+/* Variant and carriers decoded from a carrier file. */
+struct CarrierRecord {
+  std::string chr{};
+  int64_t pos{0};
+  std::string id{};
+  std::string ref{};
+  std::string alt{};
+  std::vector<int> het_idxs{};
+  std::vector<int> hom_idxs{};
+};
+
+class CarrierFileWriter {
+  public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE{1 << 18};
+
+    /* Write to path. header_text is stored for conversion back to TSV.
+     * Throws runtime_error if path cannot be opened.
+     */
+    CarrierFileWriter(const std::string& path, const std::vector<std::string>& sample_ids,
+                      const std::string& header_text = "", const bool emit_id = false,
+                      const size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    /* Close, ignoring errors. Call close() to detect them. */
+    ~CarrierFileWriter();
+
+    CarrierFileWriter(const CarrierFileWriter&) = delete;
+    CarrierFileWriter& operator=(const CarrierFileWriter&) = delete;
+
+    /* Add variant with ascending sample indexes of its het and hom carriers. */
+    void add(const std::string& chr, const int64_t pos, const std::string& id, const std::string& ref,
+             const std::string& alt, const std::vector<int>& het_idxs, const std::vector<int>& hom_idxs);
+
+    /* Write remaining block, footer, and trailer. Throws runtime_error on write failure. */
+    void close();
+
+  private:
+    struct BlockEntry {
+      uint64_t offset{0};
+      uint64_t first_variant{0};
+      uint64_t contig{0};
+      uint64_t pos{0};
+    };
+
+    std::string m_path{};
+    std::ofstream m_out{};
+    size_t m_block_size{0};
+    uint64_t m_offset{0};
+    uint64_t m_n_variants{0};
+    bool m_is_closed{false};
+
+    std::unordered_map<std::string, uint64_t> m_contig_idxs{};
+    std::vector<std::string> m_contigs{};
+    std::vector<BlockEntry> m_blocks{};
+
+    // Records of the block being filled and its compressed form, reused between blocks.
+    std::string m_block{};
+    uint32_t m_block_n_variants{0};
+    std::string m_compressed{};
+
+    void write_block();
+    void write_bytes(std::string_view bytes);
+};
+
+class CarrierFileReader {
+  public:
+    /* Map file at path. Throws runtime_error if it cannot be mapped or is not a carrier file. */
+    explicit CarrierFileReader(const std::string& path);
+    ~CarrierFileReader();
+
+    CarrierFileReader(const CarrierFileReader&) = delete;
+    CarrierFileReader& operator=(const CarrierFileReader&) = delete;
+
+    const std::vector<std::string>& sample_ids() const;
+    const std::string& header_text() const;
+    bool emit_id() const;
+    uint64_t n_variants() const;
+    size_t n_blocks() const;
+
+    /* Decode next variant into record. Return false after the last variant. */
+    bool next(CarrierRecord& record);
+
+    /* Position so next() returns the variant with the given number, counting from 0. */
+    void seek(const uint64_t variant_idx);
+
+    /* Position so next() returns the first variant of contig starting at or after pos.
+     * Return false if the file has no variants of contig.
+     */
+    bool seek(const std::string& contig, const int64_t pos);
+
+  private:
+    struct BlockEntry {
+      uint64_t offset{0};
+      uint64_t first_variant{0};
+      uint64_t contig{0};
+      uint64_t pos{0};
+    };
+
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+    bool m_emit_id{false};
+    std::string m_header_text{};
+    std::vector<std::string> m_sample_ids{};
+    std::vector<std::string> m_contigs{};
+    std::vector<BlockEntry> m_blocks{};
+    uint64_t m_n_variants{0};
+
+    // Decompressed block being read and the read position within it.
+    size_t m_block_idx{0};
+    std::string m_block{};
+    size_t m_block_pos{0};
+    uint32_t m_block_remaining{0};
+
+    void load_block(const size_t block_idx);
+    void decode_record(CarrierRecord& record);
+};
+
+#endif /* CARRIER_FILE */
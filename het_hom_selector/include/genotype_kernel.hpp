@@ -0,0 +1,45 @@
+#ifndef GENOTYPE_KERNEL
+#define GENOTYPE_KERNEL
+
+#include <cstdint>
+#include <vector>
+
+/* Instruction set used to classify genotypes. */
+enum class GtKernel { SCALAR, SSE4, AVX2 };
+
+/* Widest kernel supported by the running CPU. Detected once. */
+GtKernel best_gt_kernel();
+
+bool is_gt_kernel_supported(const GtKernel kernel);
+
+/* Append indexes of het and hom samples given GT data of num_gt values for num_samples.
+*  A sample is hom with two ALT alleles and het with one, whatever its ploidy.
+*  Diploid data uses the given kernel. Other ploidies use scalar loops.
+*/
+void classify_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                        std::vector<int>& het_idxs, std::vector<int>& hom_idxs,
+                        const GtKernel kernel);
+
+/* Count het and hom samples, classified as by classify_genotypes. */
+void count_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                     int& n_hets, int& n_homs, const GtKernel kernel);
+
+/* Add one to the het, hom, or missing count of each sample, classified as by classify_genotypes.
+*  A sample is missing when it has no ALT allele and at least one missing allele.
+*  Count arrays hold num_samples values.
+*  In the same pass, set n_hets and n_homs as count_genotypes does and, when het_idxs and hom_idxs
+*  are given, append to them as classify_genotypes does. Give both lists or neither.
+*/
+void tally_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                     uint32_t* het_counts, uint32_t* hom_counts, uint32_t* missing_counts,
+                     int& n_hets, int& n_homs, std::vector<int>* het_idxs, std::vector<int>* hom_idxs,
+                     const GtKernel kernel);
+
+/* Append sample indexes of the het and hom samples at the given ascending ranks among all het
+*  or all hom samples. Scanning stops after the last requested sample.
+*/
+void locate_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                      const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                      std::vector<int>& het_idxs, std::vector<int>& hom_idxs, const GtKernel kernel);
+
+#endif /* GENOTYPE_KERNEL */
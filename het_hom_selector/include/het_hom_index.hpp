@@ -0,0 +1,135 @@
+#ifndef HET_HOM_INDEX
+#define HET_HOM_INDEX
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bcf_reader.hpp"
+
+/**
+ * Persistent het/hom index of a BCF, built in one decode pass and read through a memory map.
+ * Each variant has a fixed size site entry and its het and hom carriers, stored uncompressed
+ *   either as a sorted list of sample indexes or as a bitset over all samples with a rank
+ *   directory, whichever is smaller. Carriers at a given rank are found with popcount and select
+ *   on the mapped words, so sampling a variant touches only a few pages.
+ * Layout is native endian and 8 byte aligned. Readers reject files of another byte order.
+ */
+
+/* True if the file at path starts with the het/hom index magic bytes. */
+bool is_het_hom_index(const std::string& path);
+
+class HetHomIndexWriter {
+  public:
+    /* Write to path. is_subset records that sample_ids are a subset of the source samples.
+     * Throws runtime_error if path cannot be opened.
+     */
+    HetHomIndexWriter(const std::string& path, const std::vector<std::string>& sample_ids,
+                      const bool is_subset = false);
+
+    /* Close, ignoring errors. Call close() to detect them. */
+    ~HetHomIndexWriter();
+
+    HetHomIndexWriter(const HetHomIndexWriter&) = delete;
+    HetHomIndexWriter& operator=(const HetHomIndexWriter&) = delete;
+
+    /* Add variant with ascending sample indexes of its het and hom carriers. */
+    void add(const std::string& chr, const int64_t pos, const std::string& id, const std::string& ref,
+             const std::string& alt, const std::vector<int>& het_idxs, const std::vector<int>& hom_idxs);
+
+    /* Write site table and header. Throws runtime_error on write failure. */
+    void close();
+
+  private:
+    std::string m_path{};
+    std::ofstream m_out{};
+    uint64_t m_offset{0};
+    uint64_t m_n_samples{0};
+    bool m_is_subset{false};
+    bool m_is_closed{false};
+
+    std::unordered_map<std::string, uint32_t> m_contig_idxs{};
+    std::vector<std::string> m_contigs{};
+    std::string m_strings{};
+    // Site entries as written to the file.
+    std::string m_sites{};
+    std::vector<uint64_t> m_words{};
+
+    /* Write carriers and return offset and encoding to store in the site entry. */
+    std::pair<uint64_t, uint32_t> write_carriers(const std::vector<int>& idxs);
+    void write_bytes(const void* data, const size_t size);
+    void pad();
+};
+
+/**
+ * Reads an index with the variant interface of BcfReader, so selection runs against either.
+ */
+class HetHomIndexReader {
+  public:
+    /* Map index at path. Throws runtime_error if it cannot be mapped or is not an index. */
+    explicit HetHomIndexReader(const std::string& path);
+    ~HetHomIndexReader();
+
+    HetHomIndexReader(const HetHomIndexReader&) = delete;
+    HetHomIndexReader& operator=(const HetHomIndexReader&) = delete;
+
+    // Advance state to next variant.  Return true if successful.
+    bool next_variant();
+
+    /* Position so next_variant reads the variant with the given number, counting from 0. */
+    void seek(const uint64_t variant_idx);
+
+    uint64_t n_variants() const;
+    int n_samples() const;
+    bool is_subset() const;
+    std::vector<std::string> sample_ids() const;
+    const SampleNameTable& sample_names() const;
+
+    int n_hets() const;
+    int n_homs() const;
+    int64_t pos() const;
+    const std::string& id() const;
+    const std::string& chr() const;
+    const std::string& ref() const;
+    const std::string& alt() const;
+
+    /* When false, next_variant leaves het_idxs/hom_idxs empty and carriers are found by rank
+    *  with carriers_at. Default true.
+    */
+    void set_collect_carriers(const bool collect);
+    const std::vector<int>& het_idxs() const;
+    const std::vector<int>& hom_idxs() const;
+
+    /* Append sample indexes of het and hom samples at given ascending ranks among all hets or homs. */
+    void carriers_at(const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                     std::vector<int>& het_out, std::vector<int>& hom_out) const;
+
+  private:
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+    int m_num_samples{0};
+    uint64_t m_num_variants{0};
+    bool m_is_subset{false};
+    SampleNameTable m_sample_names{};
+    std::vector<std::string> m_contigs{};
+    const unsigned char* m_strings{nullptr};
+    const unsigned char* m_sites{nullptr};
+
+    // Site entry of the current variant, and of the next one to read.
+    const unsigned char* m_site{nullptr};
+    uint64_t m_next_variant{0};
+
+    std::string m_chr{};
+    int64_t m_pos{0};
+    std::string m_id{};
+    std::string m_ref{};
+    std::string m_alt{};
+
+    bool m_collect_carriers{true};
+    std::vector<int> m_het_idxs{};
+    std::vector<int> m_hom_idxs{};
+};
+
+#endif /* HET_HOM_INDEX */
@@ -0,0 +1,88 @@
+#ifndef SAMPLE_COUNTS
+#define SAMPLE_COUNTS
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "bcf_reader.hpp"
+#include "genotype_kernel.hpp"
+#include "tsv_writer.hpp"
+
+/**
+ * Strata of per-sample counts. Defaults give one stratum of all variants.
+ */
+struct CountStrata {
+  // Count each INFO/SVTYPE separately.
+  bool by_svtype{false};
+
+  // Ascending bounds of absolute SV length bins. Bin i holds lengths in [bounds[i-1], bounds[i]).
+  std::vector<int64_t> size_bounds{};
+};
+
+/* Parse comma separated ascending size bounds. Throws runtime_error on malformed bounds. */
+std::vector<int64_t> parse_size_bounds(const std::string& bounds);
+
+/**
+ * Het, hom, and missing counts of each sample, per stratum of variants.
+ * Each reader thread tallies into its own SampleCounts. Merge them when reading is done.
+ */
+class SampleCounts {
+  public:
+    SampleCounts(const int n_samples, const CountStrata& strata = CountStrata{});
+
+    const CountStrata& strata() const;
+
+    /* Tally GT data of one variant of the given SVTYPE and absolute length.
+     * Each is only read when the strata are by SVTYPE or size respectively.
+     */
+    void add(const int32_t* gt_data, const int num_gt, std::string_view sv_type, const int64_t sv_length);
+
+    /* As above, also counting the variant's het and hom samples and appending their indexes when
+     * het_idxs and hom_idxs are given, in the same pass over GT as tally_genotypes.
+     */
+    void add(const int32_t* gt_data, const int num_gt, std::string_view sv_type, const int64_t sv_length,
+             int& n_hets, int& n_homs, std::vector<int>* het_idxs, std::vector<int>* hom_idxs);
+
+    /* Add counts of other, which must have the same samples and strata. */
+    void merge(const SampleCounts& other);
+
+    /* Write a row per sample and stratum: SAMPLE SVTYPE SIZE HET HOM MISSING.
+     * Unstratified columns are ALL. Strata are sorted by SVTYPE then size.
+     */
+    void write(const SampleNameTable& names, TsvWriter& out) const;
+
+  private:
+    struct Stratum {
+      std::vector<uint32_t> hets{};
+      std::vector<uint32_t> homs{};
+      std::vector<uint32_t> missing{};
+    };
+
+    // Key of SVTYPE, or empty without by_svtype, and size bin, or -1 without size bounds.
+    typedef std::pair<std::string, int> StratumKey;
+    typedef std::pair<std::string_view, int> StratumKeyView;
+
+    // Orders keys by SVTYPE then bin. Transparent so strata are found without copying the SVTYPE.
+    struct StratumLess {
+      typedef void is_transparent;
+
+      template<typename KeyA, typename KeyB>
+      bool operator()(const KeyA& a, const KeyB& b) const{
+        int order{std::string_view{a.first}.compare(b.first)};
+        return order < 0 || (order == 0 && a.second < b.second);
+      }
+    };
+
+    int m_num_samples{0};
+    CountStrata m_strata{};
+    GtKernel m_kernel{GtKernel::SCALAR};
+    std::map<StratumKey, Stratum, StratumLess> m_counts{};
+
+    Stratum& stratum(const StratumKeyView key);
+    std::string size_label(const int bin) const;
+};
+
+#endif /* SAMPLE_COUNTS */
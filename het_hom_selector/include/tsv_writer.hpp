@@ -0,0 +1,57 @@
+#ifndef TSV_WRITER
+#define TSV_WRITER
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <htslib/bgzf.h>
+
+/**
+ * Buffered output of formatted text.
+ * Text is appended to one reused buffer and written out once it passes FLUSH_SIZE:
+ *   with write(2) to a file or stdout, through BGZF compression, or to a stream.
+ */
+class TsvWriter {
+  public:
+    static constexpr size_t FLUSH_SIZE{1 << 22};
+
+    /* Write to path, or to stdout when path is "-".
+     * When is_bgzf, compress as BGZF using threads compression threads.
+     * Throws runtime_error if output cannot be opened.
+     */
+    TsvWriter(const std::string& path, const bool is_bgzf = false, const int threads = 1);
+
+    /* Write to stream, e.g. an ostringstream. */
+    explicit TsvWriter(std::ostream& out);
+
+    /* Flush and close, ignoring errors. Call close() to detect them. */
+    ~TsvWriter();
+
+    TsvWriter(const TsvWriter&) = delete;
+    TsvWriter& operator=(const TsvWriter&) = delete;
+
+    /* Buffer to append output to. Call flush_if_full() after appending. */
+    std::string& buffer();
+
+    void write(std::string_view text);
+
+    /* Write out buffer once it has reached FLUSH_SIZE. */
+    void flush_if_full();
+
+    /* Write out buffer. Throws runtime_error on write failure. */
+    void flush();
+
+    /* Flush and close output. Throws runtime_error on failure. */
+    void close();
+
+  private:
+    std::string m_buf{};
+
+    // Exactly one sink is set until closed.
+    int m_fd{-1};
+    bool m_owns_fd{false};
+    BGZF* m_bgzf{nullptr};
+    std::ostream* m_stream{nullptr};
+};
+
+#endif /* TSV_WRITER */
@@ -0,0 +1,46 @@
+#ifndef VARIANT_FILTER
+#define VARIANT_FILTER
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/* Genomic interval of variant start positions: 0-based, end exclusive. */
+struct SiteRegion {
+  std::string contig{};
+  int64_t beg{0};
+  int64_t end{std::numeric_limits<int64_t>::max()};
+};
+
+/**
+ * Site criteria a variant must meet before its genotypes are decoded.
+ * Defaults accept every variant.
+ */
+struct VariantFilter {
+  // Accepted INFO/SVTYPE values. Empty accepts any type.
+  std::vector<std::string> sv_types{};
+
+  // Bounds on absolute INFO/SVLEN, or on reference length when SVLEN is absent.
+  int64_t min_svlen{0};
+  int64_t max_svlen{std::numeric_limits<int64_t>::max()};
+
+  // Require FILTER to be PASS or missing.
+  bool pass_only{false};
+
+  // Minimum INFO/AC summed over ALTs and minimum INFO/AF of any ALT. Records lacking the tag are an error.
+  int min_ac{0};
+  double min_af{0.0};
+
+  // Variant must start within one of the regions. Empty accepts any position.
+  std::vector<SiteRegion> regions{};
+
+  bool is_active() const;
+};
+
+/* Parse comma separated regions: CHR, CHR:POS, or CHR:BEG-END with 1-based inclusive coordinates.
+*  Throws runtime_error on malformed regions.
+*/
+std::vector<SiteRegion> parse_site_regions(const std::string& regions);
+
+#endif /* VARIANT_FILTER */
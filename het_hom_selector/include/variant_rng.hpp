@@ -0,0 +1,47 @@
+#ifndef VARIANT_RNG
+#define VARIANT_RNG
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * Counter based generator (Philox4x32-10) keyed by seed and variant.
+ * Draws for a variant depend only on the seed and the variant, never on which variants came before,
+ * so sampling is reproducible under any thread count, chunking, or region restriction.
+ * Satisfies UniformRandomBitGenerator.
+ */
+class VariantRng {
+  public:
+    typedef uint32_t result_type;
+
+    // Independent streams of one variant.
+    static constexpr uint32_t HET_STREAM{0};
+    static constexpr uint32_t HOM_STREAM{1};
+
+    VariantRng(const uint32_t seed, const std::string& chr, const int64_t pos,
+               const std::string& ref, const std::string& alt, const uint32_t stream);
+
+    static constexpr result_type min(){ return 0; }
+    static constexpr result_type max(){ return std::numeric_limits<result_type>::max(); }
+    result_type operator()();
+
+    /* Uniform value in [0, n). Same values on every platform, unlike std distributions. */
+    uint32_t uniform_below(const uint32_t n);
+
+    /* Philox4x32-10 block function. */
+    static std::array<uint32_t, 4> philox(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key);
+
+  private:
+    std::array<uint32_t, 4> m_counter{};
+    std::array<uint32_t, 2> m_key{};
+    std::array<uint32_t, 4> m_block{};
+    int m_block_idx{4};
+};
+
+/* Select n of positions [0, population) with Floyd's algorithm, in ascending order. */
+std::vector<int> counter_positions(const int population, const int n, VariantRng& rng);
+
+#endif /* VARIANT_RNG */
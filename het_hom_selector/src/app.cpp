@@ -1,12 +1,23 @@
+#include <charconv>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <random>
 #include "boost/program_options.hpp"
 #include "boost/algorithm/string/join.hpp"
+#include "boost/algorithm/string/split.hpp"
+#include "boost/algorithm/string/classification.hpp"
+#include "boost/iterator/counting_iterator.hpp"
 #include "htslib/vcf.h"
 #include "bcf_reader.hpp"
 #include "app_control_data.hpp"
+#include "variant_filter.hpp"
+#include "tsv_writer.hpp"
+#include "carrier_file.hpp"
+#include "het_hom_index.hpp"
+#include "sample_counts.hpp"
+#include "run_stats.hpp"
 #include "app.hpp"
 
 namespace po = boost::program_options;
@@ -71,7 +82,37 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
       ("version,v", "Print version and exit.")
       ("num,n", po::value(&controls.num_rnd_samples), "Number of samples to take.")
       ("seed,s", po::value(&controls.rnd_seed), "Seed for PRNG.")
+      ("rng", po::value(&controls.rng_mode),
+        "Sampling generator: legacy (one stream in file order) or counter (per variant stream). Default legacy.")
       ("emit-id", po::bool_switch(&controls.emit_id), "Include ID column in output.")
+      ("output,o", po::value(&controls.output_path), "Path of output file. Default stdout.")
+      ("bgzf", po::bool_switch(&controls.bgzf_output), "BGZF compress output, using --threads threads.")
+      ("format", po::value(&controls.output_format),
+        "Output format: tsv or carriers (binary, action all, requires --output). Default tsv.")
+      ("samples", po::value<std::string>(),
+        "Comma separated samples to use. Prefix with ^ to exclude them instead.")
+      ("samples-file", po::value<std::string>(),
+        "File of samples to use, one per line. Prefix path with ^ to exclude them instead.")
+      ("svtype", po::value<std::string>(), "Comma separated SVTYPE values to keep.")
+      ("min-svlen", po::value(&controls.filter.min_svlen),
+        "Minimum absolute SVLEN, or reference length without SVLEN.")
+      ("max-svlen", po::value(&controls.filter.max_svlen),
+        "Maximum absolute SVLEN, or reference length without SVLEN.")
+      ("pass-only", po::bool_switch(&controls.filter.pass_only), "Keep only variants with FILTER PASS.")
+      ("min-ac", po::value(&controls.filter.min_ac), "Minimum INFO/AC.")
+      ("min-af", po::value(&controls.filter.min_af), "Minimum INFO/AF.")
+      ("regions,r", po::value<std::string>(),
+        "Comma separated regions (CHR, CHR:POS, CHR:BEG-END) variants must start in.")
+      ("sample-counts", po::value(&controls.sample_counts_path),
+        "Also write per-sample het, hom, and missing counts to this file.")
+      ("count-by-svtype", po::bool_switch(&controls.count_strata.by_svtype),
+        "Count each SVTYPE separately in per-sample counts.")
+      ("size-bins", po::value<std::string>(),
+        "Comma separated ascending SV length bounds of per-sample count bins, e.g. 50,1000,100000.")
+      ("stats", po::value(&controls.stats_path),
+        "Write JSON of per-stage wall and CPU time, records/sec, bytes read, and peak RSS to this file.")
+      ("threads,t", po::value(&controls.threads),
+        "Worker threads for indexed input and BGZF output. Action rnd needs --rng counter to read with more than one. Default 1.")
   ;
 
   hidden.add_options()
@@ -100,7 +141,10 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
         << desc << "\n"
         << "ACTION" << "\n"
         << "  rnd: Emit <num> random het and hom sample ids for each variant (default)." << "\n"
-        << "  all: Emit all het and homs for each variant." << "\n";
+        << "  all: Emit all het and homs for each variant." << "\n"
+        << "  to-tsv: Convert carrier file FILE written with --format carriers to tsv." << "\n"
+        << "  index: Write het/hom index of FILE to --output. Actions rnd and all accept an index as FILE." << "\n"
+        << "  stats: Emit het, hom, and missing counts of each sample." << "\n";
       controls.just_exit = true;
     }
 
@@ -111,6 +155,51 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
 
     po::notify(vm);
 
+    if(vm.count("samples") && vm.count("samples-file")){
+      throw po::error("--samples and --samples-file are mutually exclusive");
+    }
+    if(vm.count("samples")){
+      controls.samples = vm["samples"].as<std::string>();
+    }
+    if(vm.count("samples-file")){
+      controls.samples = vm["samples-file"].as<std::string>();
+      controls.is_samples_file = true;
+    }
+
+    if(vm.count("svtype")){
+      alg::split(controls.filter.sv_types, vm["svtype"].as<std::string>(), alg::is_any_of(","),
+                 alg::token_compress_on);
+    }
+    if(vm.count("regions")){
+      controls.filter.regions = parse_site_regions(vm["regions"].as<std::string>());
+    }
+    if(vm.count("size-bins")){
+      controls.count_strata.size_bounds = parse_size_bounds(vm["size-bins"].as<std::string>());
+    }
+
+    if(controls.rng_mode != "legacy" && controls.rng_mode != "counter"){
+      throw po::validation_error(po::validation_error::invalid_option_value, "rng", controls.rng_mode);
+    }
+
+    if(controls.output_format != "tsv" && controls.output_format != "carriers"){
+      throw po::validation_error(po::validation_error::invalid_option_value, "format", controls.output_format);
+    }
+    if(controls.action == "index" && (controls.output_path == "-" || controls.bgzf_output ||
+                                      controls.output_format != "tsv")){
+      throw po::error("action index requires --output and takes no --bgzf or --format");
+    }
+    if(controls.action == "stats" && (controls.output_format != "tsv" || !controls.sample_counts_path.empty())){
+      throw po::error("action stats writes counts to --output and takes no --format or --sample-counts");
+    }
+    if(controls.output_format == "carriers"){
+      if(controls.action != "all"){
+        throw po::error("--format carriers requires action all");
+      }
+      if(controls.output_path == "-" || controls.bgzf_output){
+        throw po::error("--format carriers requires --output and is compressed without --bgzf");
+      }
+    }
+
     return true;
   }
   catch(std::exception& e) {
@@ -123,87 +212,334 @@ bool parse_cli_args(const int argc, const char* argv[], AppControlData& controls
   }
 }
 
-std::vector<std::string> random_samples(const BcfReader& bcf, std::mt19937& gen, const std::vector<int>& idxs, const int n){
+std::vector<int> random_ranks(std::mt19937& gen, const int population, const int n){
+  std::vector<int> ranks{};
+  ranks.reserve(n);
 
-  std::vector<int> rnd_idxs{};
-  std::vector<std::string> samples{};
+  // Sampling ranks draws the same numbers as sampling a vector of that many indexes.
+  std::sample(boost::counting_iterator<int>(0), boost::counting_iterator<int>(population),
+              std::back_inserter(ranks), n, gen);
 
-  rnd_idxs.reserve(n);
-  samples.reserve(n);
+  return ranks;
+}
 
-  std::sample(idxs.begin(), idxs.end(), std::back_inserter(rnd_idxs), n, gen);
+void emit_header(const int seed, const int n_sample, const bool emit_id, const std::string& rng_mode,
+                 const std::string& samples_used, std::string& out){
+  out.append("#RANDOM_SEED=").append(std::to_string(seed)).append("\n")
+    .append("#RNG_MODE=").append(rng_mode).append("\n")
+    .append("#MAX_RANDOM_HOM_HETS=<<").append(std::to_string(n_sample)).append("\n")
+    .append("#SAMPLES_USED=").append(samples_used).append("\n")
+    .append("#CHROM\tPOS\t");
+  if(emit_id){
+    out.append("ID\t");
+  }
+  out.append("REF\tALT\tHOM\tHET\n");
+}
 
-  samples = bcf.sample_idxs_to_ids(rnd_idxs);
+/* Append comma separated ids of sample indexes. */
+static void append_sample_ids(const SampleNameTable& names, const std::vector<int>& idxs, std::string& out){
+  for(size_t i{0}; i < idxs.size(); i++){
+    if(i > 0){ out.push_back(','); }
+    out.append(names[idxs[i]]);
+  }
+}
+
+void emit_variant_line(const std::string& chr, const int64_t pos, const std::string& id,
+                       const std::string& ref, const std::string& alt, const SampleNameTable& names,
+                       const std::vector<int>& het_idxs, const std::vector<int>& hom_idxs,
+                       const bool emit_id, std::string& out){
+  // Largest int64 is 19 digits plus sign.
+  char pos_chars[20];
+  auto [pos_end, ec]{std::to_chars(pos_chars, pos_chars + sizeof(pos_chars), pos)};
 
-  return samples;
+  out.append(chr).push_back('\t');
+  out.append(pos_chars, pos_end).push_back('\t');
+  if(emit_id){
+    out.append(id).push_back('\t');
+  }
+  out.append(ref).push_back('\t');
+  out.append(alt).push_back('\t');
+  append_sample_ids(names, hom_idxs, out);
+  out.push_back('\t');
+  append_sample_ids(names, het_idxs, out);
+  out.push_back('\n');
 }
 
-std::vector<std::string> random_hets(const BcfReader& bcf, std::mt19937& gen, const int n){
-  return random_samples(bcf, gen, bcf.het_idxs(), n);
+template <typename VariantSource>
+void emit_selection(const VariantSource& source, const std::vector<int>& het_idxs,
+                    const std::vector<int>& hom_idxs, const bool emit_id, std::string& out){
+  emit_variant_line(source.chr(), source.pos(), source.id(), source.ref(), source.alt(), source.sample_names(),
+                    het_idxs, hom_idxs, emit_id, out);
 }
 
-std::vector<std::string> random_homs(const BcfReader& bcf, std::mt19937& gen, const int n){
-  return random_samples(bcf, gen, bcf.hom_idxs(), n);
+template void emit_selection<BcfReader>(const BcfReader&, const std::vector<int>&, const std::vector<int>&,
+                                        const bool, std::string&);
+template void emit_selection<HetHomIndexReader>(const HetHomIndexReader&, const std::vector<int>&,
+                                                const std::vector<int>&, const bool, std::string&);
+
+void emit_carriers(CarrierFileReader& carriers, TsvWriter& out){
+  const SampleNameTable names{carriers.sample_ids()};
+  CarrierRecord record{};
+
+  out.write(carriers.header_text());
+  while(carriers.next(record)){
+    emit_variant_line(record.chr, record.pos, record.id, record.ref, record.alt, names,
+                      record.het_idxs, record.hom_idxs, carriers.emit_id(), out.buffer());
+    out.flush_if_full();
+  }
 }
 
-void emit_header(const int seed, const int n_sample, const bool emit_id){
-  std::cout<<"#RANDOM_SEED="<<std::to_string(seed)<<"\n"
-    <<"#MAX_RANDOM_HOM_HETS=<<"<<std::to_string(n_sample)<<"\n"
-    <<"#SAMPLES_USED=NA"<<"\n"
-    <<"#CHROM\tPOS\t";
-  if(emit_id){
-    std::cout<<"ID"<<'\t';
+template <typename VariantSource>
+void select_variant(const VariantSource& source, const AppControlData& control, std::mt19937& gen,
+                    std::string& out){
+  if(control.action == "rnd"){
+    // Choose ranks among carriers first so only the chosen carriers are located and named.
+    std::vector<int> het_ranks{};
+    std::vector<int> hom_ranks{};
+    if(control.rng_mode == "counter"){
+      VariantRng het_rng{control.rnd_seed, source.chr(), source.pos(), source.ref(), source.alt(),
+                         VariantRng::HET_STREAM};
+      VariantRng hom_rng{control.rnd_seed, source.chr(), source.pos(), source.ref(), source.alt(),
+                         VariantRng::HOM_STREAM};
+      het_ranks = counter_positions(source.n_hets(), control.num_rnd_samples, het_rng);
+      hom_ranks = counter_positions(source.n_homs(), control.num_rnd_samples, hom_rng);
+    }else{
+      het_ranks = random_ranks(gen, source.n_hets(), control.num_rnd_samples);
+      hom_ranks = random_ranks(gen, source.n_homs(), control.num_rnd_samples);
+    }
+
+    std::vector<int> het_idxs{};
+    std::vector<int> hom_idxs{};
+    source.carriers_at(het_ranks, hom_ranks, het_idxs, hom_idxs);
+    emit_selection(source, het_idxs, hom_idxs, control.emit_id, out);
+  }else if(control.action == "all"){
+    emit_selection(source, source.het_idxs(), source.hom_idxs(), control.emit_id, out);
+  }else if(control.action == "stats"){
+    // Counts were tallied as genotypes were read.
+    return;
+  }else{
+    emit_selection(source, {}, {}, control.emit_id, out);
   }
-  std::cout<<"REF\tALT\tHOM\tHET\n";
 }
 
-void emit_selection(const BcfReader& bcf, const std::vector<std::string>& hets,
-                    const std::vector<std::string>& homs, const bool emit_id){
-  std::cout<<bcf.chr()<<'\t'
-    <<std::to_string(bcf.pos())<<'\t';
+template void select_variant<BcfReader>(const BcfReader&, const AppControlData&, std::mt19937&, std::string&);
+template void select_variant<HetHomIndexReader>(const HetHomIndexReader&, const AppControlData&, std::mt19937&,
+                                                std::string&);
 
-  if(emit_id){
-    std::cout<<bcf.id()<<'\t';
+void count_variants(const int64_t n_variants, const int64_t n_filtered){
+  RunStats& stats{RunStats::instance()};
+  if(!stats.is_enabled()){ return; }
+
+  stats.add_records(n_variants + n_filtered);
+  stats.add_count("variants", n_variants);
+  stats.add_count("filtered", n_filtered);
+}
+
+/* Write carriers of every variant of source to a carrier file. Return number of variants written. */
+template <typename VariantSource>
+static int64_t write_carrier_file(VariantSource& source, const AppControlData& control,
+                                  const std::string& header_text){
+  // Carrier files store the tsv header so conversion reproduces tsv output exactly.
+  CarrierFileWriter carriers{control.output_path, source.sample_ids(), header_text, control.emit_id};
+  int64_t n_variants{0};
+
+  {
+    SampledLoop loop{};
+    for(loop.next_record(); source.next_variant(); loop.next_record()){
+      stage_lap(DECODE);
+      carriers.add(source.chr(), source.pos(), source.id(), source.ref(), source.alt(),
+                   source.het_idxs(), source.hom_idxs());
+      stage_lap(EMIT);
+      n_variants++;
+    }
   }
-  std::cout<<bcf.ref()<<'\t'
-    <<bcf.alt()<<'\t'
-    <<alg::join(homs, ",")<<'\t'
-    <<alg::join(hets, ",")
-    <<'\n';
+
+  StageTimer timer{EMIT};
+  carriers.close();
+  return n_variants;
 }
 
-/**
- * Top level logic for reading, processing, and output.
- */
-bool run(const AppControlData& control){
-  try{
-    BcfReader bcf{control.input_path};
+/* Select and emit every remaining variant of source in order. Return number of variants read. */
+template <typename VariantSource>
+static int64_t emit_variants(VariantSource& source, const AppControlData& control, TsvWriter& out){
+  // Vars for sampling
+  std::mt19937 rnd_gen{control.rnd_seed};
+  int64_t n_variants{0};
+
+  SampledLoop loop{};
+  for(loop.next_record(); source.next_variant(); loop.next_record()){
+    stage_lap(DECODE);
+    select_variant(source, control, rnd_gen, out.buffer());
+    stage_lap(BUILD);
+    out.flush_if_full();
+    stage_lap(EMIT);
+    n_variants++;
+  }
+  return n_variants;
+}
+
+/* Flush and close output, timed as emit. */
+static void close_output(TsvWriter& out){
+  StageTimer timer{EMIT};
+  out.close();
+}
+
+/* Write per-sample counts to path. Counts of action stats are its output and follow --bgzf. */
+static void write_sample_counts(const SampleCounts& counts, const SampleNameTable& names, const std::string& path,
+                                const AppControlData& control){
+  bool is_bgzf{control.action == "stats" && control.bgzf_output};
+  StageTimer timer{EMIT};
+  TsvWriter out{path, is_bgzf, control.threads};
+  counts.write(names, out);
+  out.close();
+}
 
-    emit_header(control.rnd_seed, control.num_rnd_samples, control.emit_id);
+std::unique_ptr<BcfReader> open_input(const AppControlData& control){
+  StageTimer timer{OPEN};
+  auto bcf{std::make_unique<BcfReader>(control.input_path)};
+
+  if(!control.samples.empty()){
+    bcf->set_samples(control.samples, control.is_samples_file);
+  }
+  if(control.filter.is_active()){
+    bcf->set_filter(control.filter);
+  }
+  // Index lists are only needed when every carrier is emitted or indexed.
+  bcf->set_collect_carriers(control.action == "all" || control.action == "index");
+
+  return bcf;
+}
 
-    std::vector<std::string> out_het_ids{};
-    std::vector<std::string> out_hom_ids{};
+/* Run the action of control data. Throws runtime_error on failure. */
+static void run_action(const AppControlData& control){
+  if(control.action == "to-tsv"){
+    CarrierFileReader carriers{control.input_path};
+    TsvWriter out{control.output_path, control.bgzf_output, control.threads};
+    emit_carriers(carriers, out);
+    close_output(out);
+    return;
+  }
+
+  // Sample subset and site filters were applied when the index was built.
+  if(is_het_hom_index(control.input_path)){
+    if(control.action == "index" || control.action == "stats" || !control.sample_counts_path.empty() ||
+       !control.samples.empty() || control.filter.is_active()){
+      throw std::runtime_error(std::string("Index input takes no samples, site filters, sample counts, "
+                                           "or index and stats actions."));
+    }
+
+    std::unique_ptr<HetHomIndexReader> input{};
+    {
+      StageTimer timer{OPEN};
+      input = std::make_unique<HetHomIndexReader>(control.input_path);
+    }
+    HetHomIndexReader& index{*input};
+    index.set_collect_carriers(control.action == "all");
+
+    std::string samples_used{index.is_subset() ? alg::join(index.sample_ids(), ",") : "NA"};
+    std::string header_text{};
+    emit_header(control.rnd_seed, control.num_rnd_samples, control.emit_id, control.rng_mode, samples_used,
+                header_text);
+
+    if(control.output_format == "carriers"){
+      count_variants(write_carrier_file(index, control, header_text), 0);
+      return;
+    }
+
+    TsvWriter out{control.output_path, control.bgzf_output, control.threads};
+    out.write(header_text);
+    count_variants(emit_variants(index, control, out), 0);
+    close_output(out);
+    return;
+  }
 
-    // Vars for sampling
-    std::mt19937 rnd_gen{control.rnd_seed};
+  std::unique_ptr<BcfReader> input{open_input(control)};
+  BcfReader& bcf{*input};
 
-    while(bcf.next_variant()){
+  // Per-sample counts are tallied in the same genotype pass as the action.
+  const std::string counts_path{control.action == "stats" ? control.output_path : control.sample_counts_path};
+  std::unique_ptr<SampleCounts> counts{};
+  if(!counts_path.empty()){
+    counts = std::make_unique<SampleCounts>(bcf.n_samples(), control.count_strata);
+    bcf.set_sample_counts(counts.get());
+  }
 
-      if(control.action == "rnd"){
-        out_het_ids = random_hets(bcf, rnd_gen, control.num_rnd_samples);
-        out_hom_ids = random_homs(bcf, rnd_gen, control.num_rnd_samples);
-      }else if(control.action == "all"){
-        out_het_ids = bcf.sample_idxs_to_ids(bcf.het_idxs());
-        out_hom_ids = bcf.sample_idxs_to_ids(bcf.hom_idxs());
+  if(control.action == "index"){
+    HetHomIndexWriter index{control.output_path, bcf.sample_ids(), !control.samples.empty()};
+    int64_t n_variants{0};
+    {
+      SampledLoop loop{};
+      for(loop.next_record(); bcf.next_variant(); loop.next_record()){
+        stage_lap(DECODE);
+        index.add(bcf.chr(), bcf.pos(), bcf.id(), bcf.ref(), bcf.alt(), bcf.het_idxs(), bcf.hom_idxs());
+        stage_lap(EMIT);
+        n_variants++;
       }
+    }
+    {
+      StageTimer timer{EMIT};
+      index.close();
+    }
+    count_variants(n_variants, bcf.n_filtered());
+    if(counts){ write_sample_counts(*counts, bcf.sample_names(), counts_path, control); }
+    return;
+  }
+
+  if(control.action == "stats"){
+    // Action stats selects nothing, so no variant lines are written.
+    std::ostringstream no_lines{};
+    TsvWriter none{no_lines};
+    bool is_parallel{control.threads > 1 && bcf.load_index()};
+    if(is_parallel){
+      emit_chunks(make_chunks(bcf), control, none, counts.get());
+    }else{
+      count_variants(emit_variants(bcf, control, none), bcf.n_filtered());
+    }
+    write_sample_counts(*counts, bcf.sample_names(), counts_path, control);
+    return;
+  }
+
+  std::string samples_used{control.samples.empty() ? "NA" : alg::join(bcf.sample_ids(), ",")};
+  std::string header_text{};
+  emit_header(control.rnd_seed, control.num_rnd_samples, control.emit_id, control.rng_mode, samples_used,
+              header_text);
+
+  if(control.output_format == "carriers"){
+    count_variants(write_carrier_file(bcf, control, header_text), bcf.n_filtered());
+    if(counts){ write_sample_counts(*counts, bcf.sample_names(), counts_path, control); }
+    return;
+  }
+
+  TsvWriter out{control.output_path, control.bgzf_output, control.threads};
+  out.write(header_text);
 
-      emit_selection(bcf, out_het_ids, out_hom_ids, control.emit_id);
+  // Legacy random draws depend on every preceding variant, so its rnd output requires one sequential pass.
+  bool is_order_independent{control.action != "rnd" || control.rng_mode == "counter"};
+  if(control.threads > 1 && is_order_independent && bcf.load_index()){
+    emit_chunks(make_chunks(bcf), control, out, counts.get());
+  }else{
+    count_variants(emit_variants(bcf, control, out), bcf.n_filtered());
+  }
+  close_output(out);
+  if(counts){ write_sample_counts(*counts, bcf.sample_names(), counts_path, control); }
+}
+
+/**
+ * Top level logic for reading, processing, and output.
+ */
+bool run(const AppControlData& control){
+  if(!control.stats_path.empty()){
+    RunStats::instance().enable();
+  }
+
+  try{
+    run_action(control);
 
-      out_het_ids.clear();
-      out_hom_ids.clear();
+    if(!control.stats_path.empty()){
+      RunStats::instance().write(control.stats_path, PROGRAM_NAME, control.input_path);
     }
   } catch(std::runtime_error& ex){
-    std::cerr<<"Error creating BCF reader: "<<ex.what()<<"\n";
+    std::cerr<<"Error: "<<ex.what()<<"\n";
     return false;
   }
 
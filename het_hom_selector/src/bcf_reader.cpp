@@ -3,10 +3,39 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <cstdlib>
+#include <limits>
 #include <bcf_reader.hpp>
+#include "genotype_kernel.hpp"
+#include "sample_counts.hpp"
+#include "run_stats.hpp"
 #include <htslib/hts_log.h>
 #include <htslib/vcf.h>
 
+SampleNameTable::SampleNameTable(char** ids, const int n_ids){
+  m_offsets.reserve(n_ids + 1);
+  for(int idx{0}; idx < n_ids; idx++){
+    m_chars.append(ids[idx]);
+    m_offsets.push_back(m_chars.size());
+  }
+}
+
+SampleNameTable::SampleNameTable(const std::vector<std::string>& ids){
+  m_offsets.reserve(ids.size() + 1);
+  for(auto& id : ids){
+    m_chars.append(id);
+    m_offsets.push_back(m_chars.size());
+  }
+}
+
+std::string_view SampleNameTable::operator[](const int idx) const{
+  return std::string_view{m_chars.data() + m_offsets[idx], m_offsets[idx + 1] - m_offsets[idx]};
+}
+
+int SampleNameTable::size() const{
+  return m_offsets.size() - 1;
+}
+
 BcfReader::BcfReader(const std::string& in_path, const bool silent)
 {
   if(silent){
@@ -27,6 +56,7 @@ BcfReader::BcfReader(const std::string& in_path, const bool silent)
 
   variant = bcf_init();
   m_num_samples = bcf_hdr_nsamples(header);
+  m_sample_names = SampleNameTable{header->samples, m_num_samples};
 
   // Allocate max the space list of indexes could need.
   //   Probably 1.5Mb altogether for big inputs
@@ -35,13 +65,17 @@ BcfReader::BcfReader(const std::string& in_path, const bool silent)
 }
 
 BcfReader::~BcfReader(){
+  if(region_itr){ hts_itr_destroy(region_itr); }
+  if(idx){ hts_idx_destroy(idx); }
+  if(tbx){ tbx_destroy(tbx); }
+  free(m_line.s);
   hts_close(infile);
   bcf_hdr_destroy(header);
   bcf_destroy(variant);
 }
 
-int BcfReader::n_hets() const{ return m_het_sample_id_idxs.size(); }
-int BcfReader::n_homs() const{ return m_hom_sample_id_idxs.size(); }
+int BcfReader::n_hets() const{ return m_num_hets; }
+int BcfReader::n_homs() const{ return m_num_homs; }
 
 int64_t BcfReader::pos() const{ return m_pos; }
 const std::string& BcfReader::chr() const{ return m_chr; }
@@ -57,23 +91,141 @@ const std::vector<int>& BcfReader::hom_idxs() const{
   return m_hom_sample_id_idxs;
 }
 
+void BcfReader::set_collect_carriers(const bool collect){
+  m_collect_carriers = collect;
+}
+
+void BcfReader::carriers_at(const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                            std::vector<int>& het_out, std::vector<int>& hom_out) const{
+  if(m_collect_carriers){
+    for(int rank : het_ranks){ het_out.push_back(m_het_sample_id_idxs[rank]); }
+    for(int rank : hom_ranks){ hom_out.push_back(m_hom_sample_id_idxs[rank]); }
+    return;
+  }
+
+  locate_genotypes(gt_array.get(), m_num_gt, m_num_samples, het_ranks, hom_ranks, het_out, hom_out,
+                   best_gt_kernel());
+}
+
 bool BcfReader::next_variant(){
-  int read_status{bcf_read(infile, header, variant)};
+  while(true){
+    int read_status{region_itr ? read_region_record() : bcf_read(infile, header, variant)};
+
+    if(read_status == -1){
+      m_is_data_exhausted = true;
+      return false;
+    }else if(read_status < -1){
+      throw std::runtime_error(std::string("Error reading next variant."));
+    }
+    stage_lap(DECODE);
 
-  if(read_status == -1){
-    m_is_data_exhausted = true;
-    return false;
-  }else if(read_status < -1){
-    throw std::runtime_error(std::string("Error reading next variant."));
+    bool is_passing{!m_is_filtering || passes_filter()};
+    stage_lap(FILTER);
+    if(is_passing){ break; }
+    m_num_filtered++;
   }
 
   m_het_sample_id_idxs.clear();
   m_hom_sample_id_idxs.clear();
+  m_num_hets = 0;
+  m_num_homs = 0;
   parse_genotypes();
   parse_variant_core();
   return true;
 }
 
+int BcfReader::read_region_record(){
+  int read_status{0};
+
+  do{
+    if(tbx){
+      read_status = tbx_itr_next(infile, tbx, region_itr, &m_line);
+      if(read_status >= 0 && vcf_parse(&m_line, header, variant) < 0){
+        read_status = -2;
+      }
+    } else {
+      read_status = bcf_itr_next(infile, region_itr, variant);
+    }
+  } while(read_status >= 0 && variant->pos < m_region_beg);
+
+  // Unlike bcf_read and vcf_parse, bcf_itr_next leaves samples of --samples to be subset by the caller.
+  if(read_status >= 0 && !tbx && header->keep_samples && bcf_subset_format(header, variant) != 0){
+    read_status = -2;
+  }
+
+  return read_status;
+}
+
+bool BcfReader::load_index(){
+  if(has_index()){ return true; }
+
+  const htsFormat* format{hts_get_format(infile)};
+  if(format->format == bcf){
+    idx = bcf_index_load(m_in_path.c_str());
+  } else if(format->format == vcf && format->compression == bgzf){
+    tbx = tbx_index_load(m_in_path.c_str());
+  }
+
+  return has_index();
+}
+
+bool BcfReader::has_index() const{
+  return idx || tbx;
+}
+
+void BcfReader::set_region(const std::string& contig, const int64_t beg, const int64_t end){
+  if(!has_index()){
+    throw std::runtime_error(std::string("Region requires an index of ") + m_in_path);
+  }
+
+  if(region_itr){
+    hts_itr_destroy(region_itr);
+    region_itr = nullptr;
+  }
+
+  int tid{tbx ? tbx_name2id(tbx, contig.c_str()) : bcf_hdr_name2id(header, contig.c_str())};
+  if(tid < 0){
+    throw std::runtime_error(std::string("Contig not in index: ") + contig);
+  }
+
+  region_itr = tbx ? tbx_itr_queryi(tbx, tid, beg, end) : bcf_itr_queryi(idx, tid, beg, end);
+  if(!region_itr){
+    throw std::runtime_error(std::string("Failed to query region of ") + contig);
+  }
+
+  m_region_beg = beg;
+  m_is_data_exhausted = false;
+}
+
+std::vector<std::pair<std::string, int64_t>> BcfReader::indexed_contigs() const{
+  std::vector<std::pair<std::string, int64_t>> contigs{};
+  if(!has_index()){ return contigs; }
+
+  int n_names{0};
+  const char** names{tbx ? tbx_seqnames(tbx, &n_names) : bcf_index_seqnames(idx, header, &n_names)};
+
+  // Sort by the first file offset of each contig. Index order need not match file order.
+  std::vector<std::pair<uint64_t, int>> offsets{};
+  for(int name_idx{0}; name_idx < n_names; name_idx++){
+    int tid{tbx ? tbx_name2id(tbx, names[name_idx]) : bcf_hdr_name2id(header, names[name_idx])};
+    hts_itr_t* itr{tbx ? tbx_itr_queryi(tbx, tid, 0, HTS_POS_MAX) : bcf_itr_queryi(idx, tid, 0, HTS_POS_MAX)};
+    if(itr && itr->n_off > 0){
+      offsets.emplace_back(itr->off[0].u, name_idx);
+    }
+    hts_itr_destroy(itr);
+  }
+  std::sort(offsets.begin(), offsets.end());
+
+  for(auto& [offset, name_idx] : offsets){
+    int rid{bcf_hdr_name2id(header, names[name_idx])};
+    int64_t length{rid < 0 ? 0 : static_cast<int64_t>(header->id[BCF_DT_CTG][rid].val->info[0])};
+    contigs.emplace_back(names[name_idx], length);
+  }
+
+  free(names);
+  return contigs;
+}
+
 int BcfReader::n_samples() const {
   return m_num_samples;
 }
@@ -95,17 +247,14 @@ std::string BcfReader::variant_id() const{
 }
 
 void BcfReader::read_genotypes(){
-  /* init_ptr: Initial pointer and will be allocated GT data by htslib.
-   * num_gt_arr: Number of genotypes read will be filled in by htslib.
+  /* gt_ptr: Existing GT buffer. htslib reallocs it when m_gt_capacity is too small.
+   * Hand ownership to htslib for the call and take back whatever it returns.
    */
-  int32_t* init_ptr{nullptr};
-  int32_t num_gt_arr{0};
+  int32_t* gt_ptr{gt_array.release()};
 
-  // Fill in initial pointer
-  m_num_gt = bcf_get_genotypes(header, variant, &init_ptr, &num_gt_arr);
+  m_num_gt = bcf_get_genotypes(header, variant, &gt_ptr, &m_gt_capacity);
 
-  // Take responsibility using unique_ptr deleting any existing data
-  gt_array.reset(init_ptr);
+  gt_array.reset(gt_ptr);
 }
 
 void BcfReader::parse_variant_core(){
@@ -145,44 +294,149 @@ void BcfReader::parse_genotypes(){
   // No genotypes present
   if(m_num_gt <=0){ return; }
 
-  /* Genotype parsing variables
-   *
-   * max_ploidy: Number of alleles per sample.
-   * sample_idx: Index of data where sample alleles begin.
-   * allele_val: htslib representation of allele. Different than VCF 0-based index.
-   *             Use bcf_gte_allele(val) to translate.
-   * alt_count:  Count ALTs to determine if sample is het or hom.
-   * allele_idx: Index of given sample-allele into data.
-   */
-  int max_ploidy = m_num_gt / m_num_samples;
-  int sample_idx {0};
-  int allele_val {0};
-  int alt_count  {0};
-  int allele_idx {0};
+  if(m_sample_counts){
+    // Each INFO lookup unpacks and searches the record's INFO, so only look up what the strata use.
+    const CountStrata& strata{m_sample_counts->strata()};
+    const char* sv_type{strata.by_svtype ? info_sv_type() : nullptr};
+    int64_t sv_length{strata.size_bounds.empty() ? 0 : info_sv_length()};
+
+    // Tallying also counts and classifies the variant, so GT is decoded in one pass.
+    m_sample_counts->add(gt_array.get(), m_num_gt, sv_type ? sv_type : "NA", sv_length, m_num_hets, m_num_homs,
+                         m_collect_carriers ? &m_het_sample_id_idxs : nullptr,
+                         m_collect_carriers ? &m_hom_sample_id_idxs : nullptr);
+    return;
+  }
 
-  for(int sample_number=0; sample_number < m_num_samples; sample_number++){
-    sample_idx = sample_number * max_ploidy;
-    alt_count = 0;
+  // Counting alone avoids writing index lists when only a few carriers will be looked up.
+  if(!m_collect_carriers){
+    count_genotypes(gt_array.get(), m_num_gt, m_num_samples, m_num_hets, m_num_homs, best_gt_kernel());
+    return;
+  }
 
-    for(int allele_offset=0; allele_offset < max_ploidy; allele_offset++){
-      allele_idx = sample_idx + allele_offset;
-      allele_val = gt_array[allele_idx];
+  classify_genotypes(gt_array.get(), m_num_gt, m_num_samples, m_het_sample_id_idxs, m_hom_sample_id_idxs,
+                     best_gt_kernel());
+  m_num_hets = m_het_sample_id_idxs.size();
+  m_num_homs = m_hom_sample_id_idxs.size();
+}
 
-      if(bcf_gt_allele(allele_val) > 0){
-        alt_count++;
-      }
+void BcfReader::set_filter(const VariantFilter& filter){
+  m_filter = filter;
+  m_is_filtering = filter.is_active();
+
+  // Contigs absent from the header match no variant.
+  m_filter_region_rids.clear();
+  for(auto& region : m_filter.regions){
+    m_filter_region_rids.push_back(bcf_hdr_name2id(header, region.contig.c_str()));
+  }
+}
+
+void BcfReader::set_sample_counts(SampleCounts* counts){
+  m_sample_counts = counts;
+}
+
+const char* BcfReader::info_sv_type(){
+  char* str_ptr{m_info_str.release()};
+  int n_chars{bcf_get_info_string(header, variant, "SVTYPE", &str_ptr, &m_info_str_capacity)};
+  m_info_str.reset(str_ptr);
+
+  return n_chars > 0 ? str_ptr : nullptr;
+}
+
+int64_t BcfReader::info_sv_length(){
+  int32_t* int_ptr{m_info_ints.release()};
+  int n_vals{bcf_get_info_int32(header, variant, "SVLEN", &int_ptr, &m_info_ints_capacity)};
+  m_info_ints.reset(int_ptr);
+
+  // Reference length reflects INFO/END of symbolic alleles when SVLEN is absent.
+  return n_vals > 0 ? std::abs(static_cast<int64_t>(int_ptr[0])) : variant->rlen;
+}
+
+int64_t BcfReader::n_filtered() const{
+  return m_num_filtered;
+}
+
+bool BcfReader::passes_filter(){
+  // Position checks need no unpacking.
+  if(!m_filter.regions.empty()){
+    bool is_in_region{false};
+    for(size_t i{0}; i < m_filter.regions.size() && !is_in_region; i++){
+      is_in_region = variant->rid == m_filter_region_rids[i] &&
+                     variant->pos >= m_filter.regions[i].beg && variant->pos < m_filter.regions[i].end;
+    }
+    if(!is_in_region){ return false; }
+  }
+
+  // Shared fields only. FORMAT data stays packed until the record passes.
+  bcf_unpack(variant, BCF_UN_SHR);
+
+  if(m_filter.pass_only){
+    char pass_filter[]{"PASS"};
+    if(bcf_has_filter(header, variant, pass_filter) != 1){ return false; }
+  }
+
+  if(!m_filter.sv_types.empty()){
+    const char* sv_type_ptr{info_sv_type()};
+    if(!sv_type_ptr){ return false; }
+    std::string sv_type{sv_type_ptr};
+    if(std::find(m_filter.sv_types.begin(), m_filter.sv_types.end(), sv_type) == m_filter.sv_types.end()){
+      return false;
     }
+  }
+
+  if(m_filter.min_svlen > 0 || m_filter.max_svlen < std::numeric_limits<int64_t>::max()){
+    int64_t sv_length{info_sv_length()};
+    if(sv_length < m_filter.min_svlen || sv_length > m_filter.max_svlen){ return false; }
+  }
+
+  if(m_filter.min_ac > 0){
+    int32_t* int_ptr{m_info_ints.release()};
+    int n_vals{bcf_get_info_int32(header, variant, "AC", &int_ptr, &m_info_ints_capacity)};
+    m_info_ints.reset(int_ptr);
 
-    // Add sample id to list of het or hom sample indexes when appropriate.
-    switch(alt_count){
-      case 2:
-        m_hom_sample_id_idxs.insert(m_hom_sample_id_idxs.end(), sample_number);
-        break;
-      case 1:
-        m_het_sample_id_idxs.insert(m_het_sample_id_idxs.end(), sample_number);
-        break;
+    if(n_vals <= 0){
+      throw std::runtime_error(std::string("Minimum AC requires INFO/AC at ") +
+                               bcf_hdr_id2name(header, variant->rid) + ":" + std::to_string(variant->pos + 1));
     }
+    int64_t alt_count{0};
+    for(int i{0}; i < n_vals; i++){ alt_count += int_ptr[i]; }
+    if(alt_count < m_filter.min_ac){ return false; }
   }
+
+  if(m_filter.min_af > 0.0){
+    float* float_ptr{m_info_floats.release()};
+    int n_vals{bcf_get_info_float(header, variant, "AF", &float_ptr, &m_info_floats_capacity)};
+    m_info_floats.reset(float_ptr);
+
+    if(n_vals <= 0){
+      throw std::runtime_error(std::string("Minimum AF requires INFO/AF at ") +
+                               bcf_hdr_id2name(header, variant->rid) + ":" + std::to_string(variant->pos + 1));
+    }
+    bool has_common_alt{false};
+    for(int i{0}; i < n_vals; i++){ has_common_alt |= float_ptr[i] >= m_filter.min_af; }
+    if(!has_common_alt){ return false; }
+  }
+
+  return true;
+}
+
+void BcfReader::set_samples(const std::string& samples, const bool is_file){
+  int status{bcf_hdr_set_samples(header, samples.c_str(), is_file)};
+
+  if(status < 0){
+    throw std::runtime_error(std::string("Failed to select samples: ") + samples);
+  } else if(status > 0){
+    throw std::runtime_error(std::string("Sample ") + std::to_string(status) + " of " + samples +
+                             " is not in " + m_in_path);
+  }
+
+  m_num_samples = bcf_hdr_nsamples(header);
+  m_sample_names = SampleNameTable{header->samples, m_num_samples};
+  m_het_sample_id_idxs.reserve(m_num_samples);
+  m_hom_sample_id_idxs.reserve(m_num_samples);
+}
+
+std::vector<std::string> BcfReader::sample_ids() const{
+  return std::vector<std::string>(header->samples, header->samples + m_num_samples);
 }
 
 std::string BcfReader::sample_idx_to_id(const int& idx) const{
@@ -200,3 +454,7 @@ std::vector<std::string> BcfReader::sample_idxs_to_ids(const std::vector<int>& i
 
   return sample_ids;
 }
+
+const SampleNameTable& BcfReader::sample_names() const{
+  return m_sample_names;
+}
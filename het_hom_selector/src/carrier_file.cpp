@@ -0,0 +1,485 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "carrier_file.hpp"
+
+static constexpr char MAGIC[]{"HHSC"};
+static constexpr size_t MAGIC_SIZE{4};
+static constexpr uint8_t FORMAT_VERSION{1};
+static constexpr size_t TRAILER_SIZE{8 + 8 + MAGIC_SIZE};
+
+// Tags of the two carrier list encodings.
+static constexpr uint8_t DELTA_LIST{0};
+static constexpr uint8_t SPAN_BITMAP{1};
+
+/*******************
+ * Byte primitives *
+ ******************/
+static void put_varint(std::string& out, uint64_t value){
+  while(value >= 0x80){
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+static size_t varint_size(uint64_t value){
+  size_t size{1};
+  while(value >= 0x80){
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static void put_fixed(std::string& out, uint64_t value, const int n_bytes){
+  for(int i{0}; i < n_bytes; i++){
+    out.push_back(static_cast<char>(value & 0xff));
+    value >>= 8;
+  }
+}
+
+static void put_string(std::string& out, std::string_view text){
+  put_varint(out, text.size());
+  out.append(text);
+}
+
+/* Bounds checked reading of mapped or decompressed bytes. */
+class ByteCursor {
+  public:
+    ByteCursor(const unsigned char* data, const size_t size) : m_pos{data}, m_end{data + size} {}
+
+    uint64_t varint(){
+      uint64_t value{0};
+      for(int shift{0}; shift < 64; shift += 7){
+        uint8_t byte{next_byte()};
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80)){ return value; }
+      }
+      throw std::runtime_error(std::string("Malformed carrier file: varint too long."));
+    }
+
+    uint64_t fixed(const int n_bytes){
+      uint64_t value{0};
+      for(int i{0}; i < n_bytes; i++){
+        value |= static_cast<uint64_t>(next_byte()) << (8 * i);
+      }
+      return value;
+    }
+
+    std::string_view bytes(const uint64_t n){
+      if(n > static_cast<uint64_t>(m_end - m_pos)){
+        throw std::runtime_error(std::string("Malformed carrier file: truncated data."));
+      }
+      std::string_view view{reinterpret_cast<const char*>(m_pos), n};
+      m_pos += n;
+      return view;
+    }
+
+    std::string_view string(){
+      return bytes(varint());
+    }
+
+    uint8_t next_byte(){
+      if(m_pos >= m_end){
+        throw std::runtime_error(std::string("Malformed carrier file: truncated data."));
+      }
+      return *m_pos++;
+    }
+
+    size_t offset_from(const unsigned char* base) const{
+      return m_pos - base;
+    }
+
+  private:
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+};
+
+/*******************
+ * Carrier lists   *
+ ******************/
+/* Append ascending idxs as a delta list or as a bitmap from first to last carrier, whichever is smaller. */
+static void encode_carriers(std::string& out, const std::vector<int>& idxs){
+  if(idxs.empty()){
+    out.push_back(static_cast<char>(DELTA_LIST));
+    put_varint(out, 0);
+    return;
+  }
+
+  size_t list_size{varint_size(idxs.size())};
+  int prev{0};
+  for(int idx : idxs){
+    list_size += varint_size(idx - prev);
+    prev = idx;
+  }
+
+  uint64_t span{static_cast<uint64_t>(idxs.back() - idxs.front()) + 1};
+  size_t bitmap_size{varint_size(idxs.front()) + varint_size(span) + (span + 7) / 8};
+
+  if(list_size <= bitmap_size){
+    out.push_back(static_cast<char>(DELTA_LIST));
+    put_varint(out, idxs.size());
+    prev = 0;
+    for(int idx : idxs){
+      put_varint(out, idx - prev);
+      prev = idx;
+    }
+    return;
+  }
+
+  out.push_back(static_cast<char>(SPAN_BITMAP));
+  put_varint(out, idxs.front());
+  put_varint(out, span);
+  size_t bits_start{out.size()};
+  out.append((span + 7) / 8, '\0');
+  for(int idx : idxs){
+    uint64_t bit{static_cast<uint64_t>(idx - idxs.front())};
+    out[bits_start + bit / 8] |= static_cast<char>(1 << (bit % 8));
+  }
+}
+
+static void decode_carriers(ByteCursor& cursor, std::vector<int>& idxs, const size_t n_samples){
+  idxs.clear();
+  uint8_t tag{cursor.next_byte()};
+
+  if(tag == DELTA_LIST){
+    uint64_t n_idxs{cursor.varint()};
+    if(n_idxs > n_samples){
+      throw std::runtime_error(std::string("Malformed carrier file: more carriers than samples."));
+    }
+    uint64_t idx{0};
+    for(uint64_t i{0}; i < n_idxs; i++){
+      idx += cursor.varint();
+      idxs.push_back(idx);
+    }
+  } else if(tag == SPAN_BITMAP){
+    uint64_t first{cursor.varint()};
+    uint64_t span{cursor.varint()};
+    std::string_view bits{cursor.bytes((span + 7) / 8)};
+    for(uint64_t byte_idx{0}; byte_idx < bits.size(); byte_idx++){
+      unsigned char byte{static_cast<unsigned char>(bits[byte_idx])};
+      while(byte){
+        int bit{__builtin_ctz(byte)};
+        idxs.push_back(first + 8 * byte_idx + bit);
+        byte &= byte - 1;
+      }
+    }
+  } else {
+    throw std::runtime_error(std::string("Malformed carrier file: unknown carrier encoding."));
+  }
+
+  if(!idxs.empty() && static_cast<size_t>(idxs.back()) >= n_samples){
+    throw std::runtime_error(std::string("Malformed carrier file: sample index out of range."));
+  }
+}
+
+/*******************
+ * Writer          *
+ ******************/
+CarrierFileWriter::CarrierFileWriter(const std::string& path, const std::vector<std::string>& sample_ids,
+                                     const std::string& header_text, const bool emit_id, const size_t block_size)
+  : m_path{path},
+    m_out{path, std::ios::binary | std::ios::trunc},
+    m_block_size{block_size}
+{
+  if(!m_out){
+    throw std::runtime_error(std::string("Failed to open output ") + path);
+  }
+
+  std::string header{MAGIC, MAGIC_SIZE};
+  header.push_back(static_cast<char>(FORMAT_VERSION));
+  header.push_back(static_cast<char>(emit_id));
+  put_string(header, header_text);
+  put_varint(header, sample_ids.size());
+  for(auto& sample_id : sample_ids){
+    put_string(header, sample_id);
+  }
+  write_bytes(header);
+
+  m_block.reserve(m_block_size + (m_block_size >> 2));
+}
+
+CarrierFileWriter::~CarrierFileWriter(){
+  try{
+    close();
+  } catch(...){
+  }
+}
+
+void CarrierFileWriter::add(const std::string& chr, const int64_t pos, const std::string& id,
+                            const std::string& ref, const std::string& alt,
+                            const std::vector<int>& het_idxs, const std::vector<int>& hom_idxs){
+  auto [contig_it, is_new]{m_contig_idxs.try_emplace(chr, m_contigs.size())};
+  if(is_new){
+    m_contigs.push_back(chr);
+  }
+  uint64_t contig_idx{contig_it->second};
+
+  if(m_block_n_variants == 0){
+    m_blocks.push_back(BlockEntry{0, m_n_variants, contig_idx, static_cast<uint64_t>(pos)});
+  }
+
+  put_varint(m_block, contig_idx);
+  put_varint(m_block, pos);
+  put_string(m_block, id);
+  put_string(m_block, ref);
+  put_string(m_block, alt);
+  encode_carriers(m_block, het_idxs);
+  encode_carriers(m_block, hom_idxs);
+
+  m_block_n_variants++;
+  m_n_variants++;
+
+  if(m_block.size() >= m_block_size){
+    write_block();
+  }
+}
+
+void CarrierFileWriter::write_block(){
+  if(m_block_n_variants == 0){ return; }
+
+  uLongf compressed_size{compressBound(m_block.size())};
+  m_compressed.resize(compressed_size);
+  int status{compress2(reinterpret_cast<Bytef*>(m_compressed.data()), &compressed_size,
+                       reinterpret_cast<const Bytef*>(m_block.data()), m_block.size(), Z_DEFAULT_COMPRESSION)};
+  if(status != Z_OK){
+    throw std::runtime_error(std::string("Failed to compress block of ") + m_path);
+  }
+
+  m_blocks.back().offset = m_offset;
+
+  std::string block_header{};
+  put_fixed(block_header, m_block.size(), 4);
+  put_fixed(block_header, compressed_size, 4);
+  put_fixed(block_header, m_block_n_variants, 4);
+  write_bytes(block_header);
+  write_bytes(std::string_view{m_compressed.data(), compressed_size});
+
+  m_block.clear();
+  m_block_n_variants = 0;
+}
+
+void CarrierFileWriter::write_bytes(std::string_view bytes){
+  m_out.write(bytes.data(), bytes.size());
+  if(!m_out){
+    throw std::runtime_error(std::string("Failed to write ") + m_path);
+  }
+  m_offset += bytes.size();
+}
+
+void CarrierFileWriter::close(){
+  if(m_is_closed){ return; }
+  m_is_closed = true;
+
+  write_block();
+
+  uint64_t footer_offset{m_offset};
+  std::string footer{};
+  put_varint(footer, m_contigs.size());
+  for(auto& contig : m_contigs){
+    put_string(footer, contig);
+  }
+  put_varint(footer, m_blocks.size());
+  for(auto& block : m_blocks){
+    put_fixed(footer, block.offset, 8);
+    put_fixed(footer, block.first_variant, 8);
+    put_varint(footer, block.contig);
+    put_varint(footer, block.pos);
+  }
+  put_fixed(footer, footer_offset, 8);
+  put_fixed(footer, m_n_variants, 8);
+  footer.append(MAGIC, MAGIC_SIZE);
+  write_bytes(footer);
+
+  m_out.close();
+  if(!m_out){
+    throw std::runtime_error(std::string("Failed to close ") + m_path);
+  }
+}
+
+/*******************
+ * Reader          *
+ ******************/
+CarrierFileReader::CarrierFileReader(const std::string& path){
+  int fd{::open(path.c_str(), O_RDONLY)};
+  if(fd < 0){
+    throw std::runtime_error(std::string("Failed to open ") + path + ": " + std::strerror(errno));
+  }
+
+  struct stat file_stat{};
+  if(fstat(fd, &file_stat) < 0 || file_stat.st_size < static_cast<off_t>(MAGIC_SIZE + TRAILER_SIZE)){
+    ::close(fd);
+    throw std::runtime_error(std::string("Not a carrier file: ") + path);
+  }
+  m_size = file_stat.st_size;
+
+  void* mapped{mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  ::close(fd);
+  if(mapped == MAP_FAILED){
+    throw std::runtime_error(std::string("Failed to map ") + path + ": " + std::strerror(errno));
+  }
+  m_data = static_cast<const unsigned char*>(mapped);
+
+  try{
+    ByteCursor trailer{m_data + m_size - TRAILER_SIZE, TRAILER_SIZE};
+    uint64_t footer_offset{trailer.fixed(8)};
+    m_n_variants = trailer.fixed(8);
+    if(std::memcmp(m_data, MAGIC, MAGIC_SIZE) != 0 || trailer.bytes(MAGIC_SIZE) != std::string_view{MAGIC} ||
+       footer_offset > m_size - TRAILER_SIZE){
+      throw std::runtime_error(std::string("Not a carrier file: ") + path);
+    }
+
+    ByteCursor header{m_data + MAGIC_SIZE, footer_offset - MAGIC_SIZE};
+    if(header.next_byte() != FORMAT_VERSION){
+      throw std::runtime_error(std::string("Unsupported carrier file version: ") + path);
+    }
+    m_emit_id = header.next_byte() != 0;
+    m_header_text = header.string();
+    uint64_t n_samples{header.varint()};
+    for(uint64_t i{0}; i < n_samples; i++){
+      m_sample_ids.emplace_back(header.string());
+    }
+
+    ByteCursor footer{m_data + footer_offset, m_size - TRAILER_SIZE - footer_offset};
+    uint64_t n_contigs{footer.varint()};
+    for(uint64_t i{0}; i < n_contigs; i++){
+      m_contigs.emplace_back(footer.string());
+    }
+    uint64_t n_blocks{footer.varint()};
+    for(uint64_t i{0}; i < n_blocks; i++){
+      BlockEntry block{};
+      block.offset = footer.fixed(8);
+      block.first_variant = footer.fixed(8);
+      block.contig = footer.varint();
+      block.pos = footer.varint();
+      if(block.offset >= footer_offset || block.contig >= n_contigs){
+        throw std::runtime_error(std::string("Malformed carrier file index: ") + path);
+      }
+      m_blocks.push_back(block);
+    }
+  } catch(...){
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+    throw;
+  }
+}
+
+CarrierFileReader::~CarrierFileReader(){
+  munmap(const_cast<unsigned char*>(m_data), m_size);
+}
+
+const std::vector<std::string>& CarrierFileReader::sample_ids() const{ return m_sample_ids; }
+const std::string& CarrierFileReader::header_text() const{ return m_header_text; }
+bool CarrierFileReader::emit_id() const{ return m_emit_id; }
+uint64_t CarrierFileReader::n_variants() const{ return m_n_variants; }
+size_t CarrierFileReader::n_blocks() const{ return m_blocks.size(); }
+
+void CarrierFileReader::load_block(const size_t block_idx){
+  const BlockEntry& block{m_blocks[block_idx]};
+  ByteCursor cursor{m_data + block.offset, m_size - block.offset};
+  uLongf raw_size{cursor.fixed(4)};
+  uint64_t compressed_size{cursor.fixed(4)};
+  uint32_t n_variants{static_cast<uint32_t>(cursor.fixed(4))};
+  std::string_view compressed{cursor.bytes(compressed_size)};
+
+  m_block.resize(raw_size);
+  int status{uncompress(reinterpret_cast<Bytef*>(m_block.data()), &raw_size,
+                        reinterpret_cast<const Bytef*>(compressed.data()), compressed.size())};
+  if(status != Z_OK || raw_size != m_block.size()){
+    throw std::runtime_error(std::string("Malformed carrier file: block failed to decompress."));
+  }
+
+  // Next block to load follows this one.
+  m_block_idx = block_idx + 1;
+  m_block_pos = 0;
+  m_block_remaining = n_variants;
+}
+
+void CarrierFileReader::decode_record(CarrierRecord& record){
+  ByteCursor cursor{reinterpret_cast<const unsigned char*>(m_block.data()) + m_block_pos,
+                    m_block.size() - m_block_pos};
+
+  uint64_t contig_idx{cursor.varint()};
+  if(contig_idx >= m_contigs.size()){
+    throw std::runtime_error(std::string("Malformed carrier file: contig out of range."));
+  }
+  record.chr = m_contigs[contig_idx];
+  record.pos = cursor.varint();
+  record.id = cursor.string();
+  record.ref = cursor.string();
+  record.alt = cursor.string();
+  decode_carriers(cursor, record.het_idxs, m_sample_ids.size());
+  decode_carriers(cursor, record.hom_idxs, m_sample_ids.size());
+
+  m_block_pos += cursor.offset_from(reinterpret_cast<const unsigned char*>(m_block.data()) + m_block_pos);
+  m_block_remaining--;
+}
+
+bool CarrierFileReader::next(CarrierRecord& record){
+  while(m_block_remaining == 0){
+    if(m_block_idx >= m_blocks.size()){ return false; }
+    load_block(m_block_idx);
+  }
+
+  decode_record(record);
+  return true;
+}
+
+void CarrierFileReader::seek(const uint64_t variant_idx){
+  m_block_remaining = 0;
+  if(variant_idx >= m_n_variants){
+    m_block_idx = m_blocks.size();
+    return;
+  }
+
+  auto block_it{std::upper_bound(m_blocks.begin(), m_blocks.end(), variant_idx,
+      [](const uint64_t idx, const BlockEntry& block){ return idx < block.first_variant; })};
+  size_t block_idx{static_cast<size_t>(block_it - m_blocks.begin()) - 1};
+  load_block(block_idx);
+
+  CarrierRecord skipped{};
+  for(uint64_t i{m_blocks[block_idx].first_variant}; i < variant_idx; i++){
+    decode_record(skipped);
+  }
+}
+
+bool CarrierFileReader::seek(const std::string& contig, const int64_t pos){
+  auto contig_it{std::find(m_contigs.begin(), m_contigs.end(), contig)};
+  if(contig_it == m_contigs.end()){ return false; }
+
+  // Contigs are numbered in file order, so (contig, pos) orders sorted variants.
+  const std::pair<uint64_t, uint64_t> target{contig_it - m_contigs.begin(), std::max<int64_t>(pos, 0)};
+  auto block_it{std::upper_bound(m_blocks.begin(), m_blocks.end(), target,
+      [](const std::pair<uint64_t, uint64_t>& key, const BlockEntry& block){
+        return key < std::make_pair(block.contig, block.pos);
+      })};
+  size_t block_idx{block_it == m_blocks.begin() ? 0 : static_cast<size_t>(block_it - m_blocks.begin()) - 1};
+
+  m_block_remaining = 0;
+  m_block_idx = block_idx;
+
+  // Skip variants before target, leaving the first at or after it to be read next.
+  while(true){
+    while(m_block_remaining == 0){
+      if(m_block_idx >= m_blocks.size()){ return true; }
+      load_block(m_block_idx);
+    }
+
+    ByteCursor cursor{reinterpret_cast<const unsigned char*>(m_block.data()) + m_block_pos,
+                      m_block.size() - m_block_pos};
+    uint64_t contig_idx{cursor.varint()};
+    uint64_t variant_pos{cursor.varint()};
+    if(std::make_pair(contig_idx, variant_pos) >= target){ return true; }
+
+    CarrierRecord skipped{};
+    decode_record(skipped);
+  }
+}
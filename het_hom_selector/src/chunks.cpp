@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "htslib/hts.h"
+#include "bcf_reader.hpp"
+#include "tsv_writer.hpp"
+#include "sample_counts.hpp"
+#include "run_stats.hpp"
+#include "app.hpp"
+
+std::vector<VariantChunk> make_chunks(const BcfReader& bcf, const int64_t span){
+  std::vector<VariantChunk> chunks{};
+
+  for(auto& [contig, length] : bcf.indexed_contigs()){
+    // Last chunk of each contig is open ended in case records lie past the header length.
+    int64_t beg{0};
+    for(; beg + span < length; beg += span){
+      chunks.push_back(VariantChunk{contig, beg, beg + span});
+    }
+    chunks.push_back(VariantChunk{contig, beg, HTS_POS_MAX});
+  }
+
+  return chunks;
+}
+
+// Output of one chunk, handed to the emitter in pieces as it is produced.
+struct ChunkOutput {
+  std::deque<std::string> pieces{};
+  std::exception_ptr error{};
+  bool is_done{false};
+};
+
+void emit_chunks(const std::vector<VariantChunk>& chunks, const AppControlData& control, TsvWriter& out,
+                 SampleCounts* counts, const size_t max_buffered_bytes){
+  std::vector<ChunkOutput> outputs(chunks.size());
+  std::mutex mtx{};
+  std::condition_variable cv{};
+  size_t next_chunk{0};
+  size_t n_emitted{0};
+  size_t buffered_bytes{0};
+  bool is_aborted{false};
+
+  // Workers claim at most this many chunks ahead of the emitter.
+  const size_t n_workers{std::clamp<size_t>(control.threads, 1, std::max<size_t>(chunks.size(), 1))};
+  const size_t window{4 * n_workers};
+  // Output held by workers between hand offs, and pieces handed off just under the bound, each add about
+  //   a quarter of the bound.
+  const size_t piece_size{std::max<size_t>(1, max_buffered_bytes / (4 * n_workers))};
+
+  // Hand text of chunk_idx to the emitter. The worker of the chunk being emitted never waits, so the
+  //   emitter always makes progress. Others wait while buffered output is over the bound.
+  // False once aborted.
+  auto hand_off = [&](const size_t chunk_idx, std::string& text){
+    {
+      std::unique_lock<std::mutex> lock{mtx};
+      cv.wait(lock, [&](){
+        return is_aborted || chunk_idx == n_emitted || buffered_bytes < max_buffered_bytes;
+      });
+      if(is_aborted){ return false; }
+      buffered_bytes += text.size();
+      outputs[chunk_idx].pieces.push_back(std::move(text));
+    }
+    cv.notify_all();
+    text = std::string{};
+    return true;
+  };
+
+  auto worker = [&](){
+    // Each worker has its own reader whose region moves from chunk to chunk.
+    std::unique_ptr<BcfReader> reader{};
+    std::mt19937 rnd_gen{control.rnd_seed};
+    // Counts of this worker's chunks, merged into counts once all chunks are claimed.
+    std::unique_ptr<SampleCounts> worker_counts{};
+    int64_t n_variants{0};
+
+    while(true){
+      size_t chunk_idx{0};
+      {
+        std::unique_lock<std::mutex> lock{mtx};
+        cv.wait(lock, [&](){
+          return is_aborted || next_chunk >= chunks.size() || next_chunk < n_emitted + window;
+        });
+        if(is_aborted || next_chunk >= chunks.size()){ break; }
+        chunk_idx = next_chunk++;
+      }
+
+      std::string chunk_out{};
+      std::exception_ptr error{};
+      bool is_handed_off{true};
+      try{
+        if(!reader){
+          reader = open_input(control);
+          reader->load_index();
+          if(counts){
+            worker_counts = std::make_unique<SampleCounts>(reader->n_samples(), counts->strata());
+            reader->set_sample_counts(worker_counts.get());
+          }
+        }
+
+        const VariantChunk& chunk{chunks[chunk_idx]};
+        reader->set_region(chunk.contig, chunk.beg, chunk.end);
+        SampledLoop loop{};
+        for(loop.next_record(); reader->next_variant(); loop.next_record()){
+          stage_lap(DECODE);
+          select_variant(*reader, control, rnd_gen, chunk_out);
+          stage_lap(BUILD);
+          n_variants++;
+          if(chunk_out.size() >= piece_size){
+            is_handed_off = hand_off(chunk_idx, chunk_out);
+            if(!is_handed_off){ break; }
+          }
+        }
+        if(is_handed_off && !chunk_out.empty()){
+          is_handed_off = hand_off(chunk_idx, chunk_out);
+        }
+      } catch(...){
+        error = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock{mtx};
+        outputs[chunk_idx].error = error;
+        outputs[chunk_idx].is_done = true;
+      }
+      cv.notify_all();
+      if(!is_handed_off){ break; }
+    }
+
+    if(worker_counts){
+      std::lock_guard<std::mutex> lock{mtx};
+      counts->merge(*worker_counts);
+    }
+    if(reader){
+      count_variants(n_variants, reader->n_filtered());
+    }
+  };
+
+  std::vector<std::thread> workers{};
+  for(size_t i{0}; i < n_workers; i++){
+    workers.emplace_back(worker);
+  }
+
+  // Emit in chunk order, writing each piece of the current chunk as it arrives.
+  // Chunks are claimed in order, so every chunk before a failed one completes.
+  std::exception_ptr error{};
+  for(size_t chunk_idx{0}; chunk_idx < chunks.size() && !error; chunk_idx++){
+    while(true){
+      std::string text{};
+      {
+        std::unique_lock<std::mutex> lock{mtx};
+        ChunkOutput& output{outputs[chunk_idx]};
+        cv.wait(lock, [&](){ return !output.pieces.empty() || output.is_done; });
+        if(output.pieces.empty()){
+          error = output.error;
+          if(error){
+            is_aborted = true;
+          }else{
+            n_emitted++;
+          }
+          break;
+        }
+        text.swap(output.pieces.front());
+        output.pieces.pop_front();
+        buffered_bytes -= text.size();
+      }
+      cv.notify_all();
+
+      // A failed write stops the workers before they are joined, as a failed chunk does.
+      try{
+        StageTimer timer{EMIT};
+        out.write(text);
+      } catch(...){
+        error = std::current_exception();
+        std::lock_guard<std::mutex> lock{mtx};
+        is_aborted = true;
+        break;
+      }
+    }
+    cv.notify_all();
+  }
+
+  for(auto& thread : workers){
+    thread.join();
+  }
+
+  if(error){
+    std::rethrow_exception(error);
+  }
+}
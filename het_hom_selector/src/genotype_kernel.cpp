@@ -0,0 +1,713 @@
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "genotype_kernel.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// bcf_gt_allele(val) > 0 exactly when val > 3. REF, missing, and vector end values are all below.
+constexpr int32_t MAX_NON_ALT_GT{3};
+
+// Value of bcf_int32_vector_end, padding samples of lower ploidy.
+constexpr int32_t VECTOR_END_GT{INT32_MIN + 1};
+
+template<int PLOIDY>
+int count_alts(const int32_t* sample_gt){
+  int alt_count{0};
+  for(int allele_idx{0}; allele_idx < PLOIDY; allele_idx++){
+    alt_count += sample_gt[allele_idx] > MAX_NON_ALT_GT;
+  }
+  return alt_count;
+}
+
+int count_alts(const int32_t* sample_gt, const int ploidy){
+  int alt_count{0};
+  for(int allele_idx{0}; allele_idx < ploidy; allele_idx++){
+    alt_count += sample_gt[allele_idx] > MAX_NON_ALT_GT;
+  }
+  return alt_count;
+}
+
+template<int PLOIDY>
+void classify_fixed_ploidy(const int32_t* gt_data, const int first_sample, const int num_samples,
+                           std::vector<int>& het_idxs, std::vector<int>& hom_idxs){
+  for(int sample_idx{first_sample}; sample_idx < num_samples; sample_idx++){
+    int alt_count{count_alts<PLOIDY>(gt_data + static_cast<size_t>(sample_idx) * PLOIDY)};
+
+    if(alt_count == 2){
+      hom_idxs.push_back(sample_idx);
+    } else if(alt_count == 1){
+      het_idxs.push_back(sample_idx);
+    }
+  }
+}
+
+void classify_any_ploidy(const int32_t* gt_data, const int ploidy, const int num_samples,
+                         std::vector<int>& het_idxs, std::vector<int>& hom_idxs){
+  for(int sample_idx{0}; sample_idx < num_samples; sample_idx++){
+    int alt_count{count_alts(gt_data + static_cast<size_t>(sample_idx) * ploidy, ploidy)};
+
+    if(alt_count == 2){
+      hom_idxs.push_back(sample_idx);
+    } else if(alt_count == 1){
+      het_idxs.push_back(sample_idx);
+    }
+  }
+}
+
+template<int PLOIDY>
+void count_fixed_ploidy(const int32_t* gt_data, const int first_sample, const int num_samples,
+                        int& n_hets, int& n_homs){
+  for(int sample_idx{first_sample}; sample_idx < num_samples; sample_idx++){
+    int alt_count{count_alts<PLOIDY>(gt_data + static_cast<size_t>(sample_idx) * PLOIDY)};
+    n_homs += alt_count == 2;
+    n_hets += alt_count == 1;
+  }
+}
+
+void count_any_ploidy(const int32_t* gt_data, const int ploidy, const int num_samples,
+                      int& n_hets, int& n_homs){
+  for(int sample_idx{0}; sample_idx < num_samples; sample_idx++){
+    int alt_count{count_alts(gt_data + static_cast<size_t>(sample_idx) * ploidy, ploidy)};
+    n_homs += alt_count == 2;
+    n_hets += alt_count == 1;
+  }
+}
+
+// Allele values of missing calls: bcf_gt_missing, its phased form, and bcf_int32_missing. Vector end is not missing.
+inline bool is_missing_allele(const int32_t allele_val){
+  return allele_val <= 1 && allele_val != VECTOR_END_GT;
+}
+
+/* Per-sample counts to add one variant to, and its het and hom samples.
+ * Indexes are only appended when the lists are given.
+ */
+struct Tally {
+  uint32_t* het_counts;
+  uint32_t* hom_counts;
+  uint32_t* missing_counts;
+  int& n_hets;
+  int& n_homs;
+  std::vector<int>* het_idxs;
+  std::vector<int>* hom_idxs;
+
+  void add(const int sample_idx, const int alt_count, const bool has_missing){
+    het_counts[sample_idx] += alt_count == 1;
+    hom_counts[sample_idx] += alt_count == 2;
+    missing_counts[sample_idx] += alt_count == 0 && has_missing;
+    n_hets += alt_count == 1;
+    n_homs += alt_count == 2;
+
+    if(het_idxs && alt_count == 1){
+      het_idxs->push_back(sample_idx);
+    } else if(hom_idxs && alt_count == 2){
+      hom_idxs->push_back(sample_idx);
+    }
+  }
+};
+
+/* Add one to the het, hom, or missing count of each sample. Missing samples have a missing allele and no ALT. */
+template<int PLOIDY>
+void tally_fixed_ploidy(const int32_t* gt_data, const int first_sample, const int num_samples, Tally& tally){
+  for(int sample_idx{first_sample}; sample_idx < num_samples; sample_idx++){
+    const int32_t* sample_gt{gt_data + static_cast<size_t>(sample_idx) * PLOIDY};
+    bool has_missing{false};
+    for(int allele_idx{0}; allele_idx < PLOIDY; allele_idx++){
+      has_missing |= is_missing_allele(sample_gt[allele_idx]);
+    }
+    tally.add(sample_idx, count_alts<PLOIDY>(sample_gt), has_missing);
+  }
+}
+
+void tally_any_ploidy(const int32_t* gt_data, const int ploidy, const int num_samples, Tally& tally){
+  for(int sample_idx{0}; sample_idx < num_samples; sample_idx++){
+    const int32_t* sample_gt{gt_data + static_cast<size_t>(sample_idx) * ploidy};
+    bool has_missing{false};
+    for(int allele_idx{0}; allele_idx < ploidy; allele_idx++){
+      has_missing |= is_missing_allele(sample_gt[allele_idx]);
+    }
+    tally.add(sample_idx, count_alts(sample_gt, ploidy), has_missing);
+  }
+}
+
+/* Walks samples in order, keeping the samples at requested het and hom ranks. */
+class CarrierLocator {
+  public:
+    CarrierLocator(const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                   std::vector<int>& het_idxs, std::vector<int>& hom_idxs) :
+      m_het_ranks(het_ranks), m_hom_ranks(hom_ranks), m_het_idxs(het_idxs), m_hom_idxs(hom_idxs) {}
+
+    bool is_done() const{
+      return m_next_het == m_het_ranks.size() && m_next_hom == m_hom_ranks.size();
+    }
+
+    /* Would a block with these counts hold a requested sample. */
+    bool is_wanted(const int n_block_hets, const int n_block_homs) const{
+      return (m_next_het < m_het_ranks.size() && m_het_ranks[m_next_het] < m_het_rank + n_block_hets) ||
+             (m_next_hom < m_hom_ranks.size() && m_hom_ranks[m_next_hom] < m_hom_rank + n_block_homs);
+    }
+
+    void skip(const int n_block_hets, const int n_block_homs){
+      m_het_rank += n_block_hets;
+      m_hom_rank += n_block_homs;
+    }
+
+    void visit(const int sample_idx, const int alt_count){
+      if(alt_count == 1){
+        if(m_next_het < m_het_ranks.size() && m_het_ranks[m_next_het] == m_het_rank){
+          m_het_idxs.push_back(sample_idx);
+          m_next_het++;
+        }
+        m_het_rank++;
+      } else if(alt_count == 2){
+        if(m_next_hom < m_hom_ranks.size() && m_hom_ranks[m_next_hom] == m_hom_rank){
+          m_hom_idxs.push_back(sample_idx);
+          m_next_hom++;
+        }
+        m_hom_rank++;
+      }
+    }
+
+  private:
+    const std::vector<int>& m_het_ranks;
+    const std::vector<int>& m_hom_ranks;
+    std::vector<int>& m_het_idxs;
+    std::vector<int>& m_hom_idxs;
+    size_t m_next_het{0};
+    size_t m_next_hom{0};
+    int m_het_rank{0};
+    int m_hom_rank{0};
+};
+
+void locate_any_ploidy(const int32_t* gt_data, const int ploidy, const int first_sample, const int num_samples,
+                       CarrierLocator& locator){
+  for(int sample_idx{first_sample}; sample_idx < num_samples && !locator.is_done(); sample_idx++){
+    locator.visit(sample_idx, count_alts(gt_data + static_cast<size_t>(sample_idx) * ploidy, ploidy));
+  }
+}
+
+#ifdef GT_X86_KERNELS
+
+/*
+ * Stream compaction tables. Entry for a lane mask moves the selected lanes to the front, in order.
+ *   AVX2: lane numbers for _mm256_permutevar8x32_epi32 over 8 int32 lanes.
+ *   SSE4: byte shuffle for _mm_shuffle_epi8 over 4 int32 lanes.
+ */
+struct CompactTables {
+  alignas(32) int32_t avx2_lanes[256][8]{};
+  alignas(16) uint8_t sse4_bytes[16][16]{};
+
+  CompactTables(){
+    for(int mask{0}; mask < 256; mask++){
+      int n_packed{0};
+      for(int lane{0}; lane < 8; lane++){
+        if(mask & (1 << lane)){
+          avx2_lanes[mask][n_packed++] = lane;
+        }
+      }
+    }
+
+    for(int mask{0}; mask < 16; mask++){
+      int n_packed{0};
+      for(int lane{0}; lane < 4; lane++){
+        if(mask & (1 << lane)){
+          for(int byte{0}; byte < 4; byte++){
+            sse4_bytes[mask][4 * n_packed + byte] = 4 * lane + byte;
+          }
+          n_packed++;
+        }
+      }
+      for(int byte{4 * n_packed}; byte < 16; byte++){
+        sse4_bytes[mask][byte] = 0x80;
+      }
+    }
+  }
+};
+
+const CompactTables COMPACT_TABLES{};
+
+__attribute__((target("avx2")))
+void append_lanes_avx2(std::vector<int>& idxs, const __m256i sample_idxs, const unsigned mask){
+  alignas(32) int32_t packed[8];
+  const __m256i lanes{_mm256_load_si256(reinterpret_cast<const __m256i*>(COMPACT_TABLES.avx2_lanes[mask]))};
+
+  _mm256_store_si256(reinterpret_cast<__m256i*>(packed), _mm256_permutevar8x32_epi32(sample_idxs, lanes));
+  idxs.insert(idxs.end(), packed, packed + __builtin_popcount(mask));
+}
+
+/* Eight diploid samples per iteration. Scalar loop handles the remainder. */
+__attribute__((target("avx2")))
+void classify_diploid_avx2(const int32_t* gt_data, const int num_samples,
+                           std::vector<int>& het_idxs, std::vector<int>& hom_idxs){
+  const __m256i max_non_alt{_mm256_set1_epi32(MAX_NON_ALT_GT)};
+  const __m256i one_alt{_mm256_set1_epi32(-1)};
+  const __m256i two_alt{_mm256_set1_epi32(-2)};
+  const __m256i lane_offsets{_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+  int sample_idx{0};
+
+  for(; sample_idx + 8 <= num_samples; sample_idx += 8){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+
+    // Each allele is -1 when ALT, 0 otherwise.
+    __m256i lo_alts{_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), max_non_alt)};
+    __m256i hi_alts{_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 8)), max_non_alt)};
+
+    // Pairwise sums are negated ALT counts ordered s0 s1 s4 s5 | s2 s3 s6 s7. Restore sample order.
+    __m256i neg_alt_counts{_mm256_permute4x64_epi64(_mm256_hadd_epi32(lo_alts, hi_alts), 0xD8)};
+
+    unsigned het_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(neg_alt_counts, one_alt)));
+    unsigned hom_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(neg_alt_counts, two_alt)));
+
+    // Most samples of a typical variant are REF.
+    if((het_mask | hom_mask) == 0){ continue; }
+
+    __m256i sample_idxs{_mm256_add_epi32(_mm256_set1_epi32(sample_idx), lane_offsets)};
+    if(het_mask){ append_lanes_avx2(het_idxs, sample_idxs, het_mask); }
+    if(hom_mask){ append_lanes_avx2(hom_idxs, sample_idxs, hom_mask); }
+  }
+
+  classify_fixed_ploidy<2>(gt_data, sample_idx, num_samples, het_idxs, hom_idxs);
+}
+
+__attribute__((target("sse4.1")))
+void append_lanes_sse4(std::vector<int>& idxs, const __m128i sample_idxs, const unsigned mask){
+  alignas(16) int32_t packed[4];
+  const __m128i bytes{_mm_load_si128(reinterpret_cast<const __m128i*>(COMPACT_TABLES.sse4_bytes[mask]))};
+
+  _mm_store_si128(reinterpret_cast<__m128i*>(packed), _mm_shuffle_epi8(sample_idxs, bytes));
+  idxs.insert(idxs.end(), packed, packed + __builtin_popcount(mask));
+}
+
+/* Four diploid samples per iteration. Scalar loop handles the remainder. */
+__attribute__((target("sse4.1")))
+void classify_diploid_sse4(const int32_t* gt_data, const int num_samples,
+                           std::vector<int>& het_idxs, std::vector<int>& hom_idxs){
+  const __m128i max_non_alt{_mm_set1_epi32(MAX_NON_ALT_GT)};
+  const __m128i one_alt{_mm_set1_epi32(-1)};
+  const __m128i two_alt{_mm_set1_epi32(-2)};
+  const __m128i lane_offsets{_mm_setr_epi32(0, 1, 2, 3)};
+  int sample_idx{0};
+
+  for(; sample_idx + 4 <= num_samples; sample_idx += 4){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+
+    __m128i lo_alts{_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), max_non_alt)};
+    __m128i hi_alts{_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 4)), max_non_alt)};
+
+    // Negated ALT counts of s0 s1 s2 s3.
+    __m128i neg_alt_counts{_mm_hadd_epi32(lo_alts, hi_alts)};
+
+    unsigned het_mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(neg_alt_counts, one_alt)));
+    unsigned hom_mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(neg_alt_counts, two_alt)));
+
+    if((het_mask | hom_mask) == 0){ continue; }
+
+    __m128i sample_idxs{_mm_add_epi32(_mm_set1_epi32(sample_idx), lane_offsets)};
+    if(het_mask){ append_lanes_sse4(het_idxs, sample_idxs, het_mask); }
+    if(hom_mask){ append_lanes_sse4(hom_idxs, sample_idxs, hom_mask); }
+  }
+
+  classify_fixed_ploidy<2>(gt_data, sample_idx, num_samples, het_idxs, hom_idxs);
+}
+
+/* Negated ALT counts per sample accumulate in 32-bit lanes. Only masks leave the loop. */
+__attribute__((target("avx2")))
+void count_diploid_avx2(const int32_t* gt_data, const int num_samples, int& n_hets, int& n_homs){
+  const __m256i max_non_alt{_mm256_set1_epi32(MAX_NON_ALT_GT)};
+  const __m256i one_alt{_mm256_set1_epi32(-1)};
+  const __m256i two_alt{_mm256_set1_epi32(-2)};
+  __m256i het_counts{_mm256_setzero_si256()};
+  __m256i hom_counts{_mm256_setzero_si256()};
+  int sample_idx{0};
+
+  for(; sample_idx + 8 <= num_samples; sample_idx += 8){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+    __m256i lo_alts{_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), max_non_alt)};
+    __m256i hi_alts{_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 8)), max_non_alt)};
+    // Sample order does not matter for counts, so no permute.
+    __m256i neg_alt_counts{_mm256_hadd_epi32(lo_alts, hi_alts)};
+
+    het_counts = _mm256_sub_epi32(het_counts, _mm256_cmpeq_epi32(neg_alt_counts, one_alt));
+    hom_counts = _mm256_sub_epi32(hom_counts, _mm256_cmpeq_epi32(neg_alt_counts, two_alt));
+  }
+
+  alignas(32) int32_t lanes[8];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), het_counts);
+  for(int32_t lane : lanes){ n_hets += lane; }
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), hom_counts);
+  for(int32_t lane : lanes){ n_homs += lane; }
+
+  count_fixed_ploidy<2>(gt_data, sample_idx, num_samples, n_hets, n_homs);
+}
+
+__attribute__((target("sse4.1")))
+void count_diploid_sse4(const int32_t* gt_data, const int num_samples, int& n_hets, int& n_homs){
+  const __m128i max_non_alt{_mm_set1_epi32(MAX_NON_ALT_GT)};
+  const __m128i one_alt{_mm_set1_epi32(-1)};
+  const __m128i two_alt{_mm_set1_epi32(-2)};
+  __m128i het_counts{_mm_setzero_si128()};
+  __m128i hom_counts{_mm_setzero_si128()};
+  int sample_idx{0};
+
+  for(; sample_idx + 4 <= num_samples; sample_idx += 4){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+    __m128i lo_alts{_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), max_non_alt)};
+    __m128i hi_alts{_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 4)), max_non_alt)};
+    __m128i neg_alt_counts{_mm_hadd_epi32(lo_alts, hi_alts)};
+
+    het_counts = _mm_sub_epi32(het_counts, _mm_cmpeq_epi32(neg_alt_counts, one_alt));
+    hom_counts = _mm_sub_epi32(hom_counts, _mm_cmpeq_epi32(neg_alt_counts, two_alt));
+  }
+
+  alignas(16) int32_t lanes[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes), het_counts);
+  for(int32_t lane : lanes){ n_hets += lane; }
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes), hom_counts);
+  for(int32_t lane : lanes){ n_homs += lane; }
+
+  count_fixed_ploidy<2>(gt_data, sample_idx, num_samples, n_hets, n_homs);
+}
+
+/* Skip blocks of eight samples holding no requested sample. Visit the rest sample by sample. */
+__attribute__((target("avx2")))
+void locate_diploid_avx2(const int32_t* gt_data, const int num_samples, CarrierLocator& locator){
+  const __m256i max_non_alt{_mm256_set1_epi32(MAX_NON_ALT_GT)};
+  const __m256i one_alt{_mm256_set1_epi32(-1)};
+  const __m256i two_alt{_mm256_set1_epi32(-2)};
+  int sample_idx{0};
+
+  for(; sample_idx + 8 <= num_samples && !locator.is_done(); sample_idx += 8){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+    __m256i lo_alts{_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), max_non_alt)};
+    __m256i hi_alts{_mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 8)), max_non_alt)};
+    __m256i neg_alt_counts{_mm256_hadd_epi32(lo_alts, hi_alts)};
+
+    int n_hets{__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(neg_alt_counts, one_alt))))};
+    int n_homs{__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(neg_alt_counts, two_alt))))};
+
+    if(locator.is_wanted(n_hets, n_homs)){
+      locate_any_ploidy(gt_data, 2, sample_idx, sample_idx + 8, locator);
+    } else {
+      locator.skip(n_hets, n_homs);
+    }
+  }
+
+  locate_any_ploidy(gt_data, 2, sample_idx, num_samples, locator);
+}
+
+__attribute__((target("sse4.1")))
+void locate_diploid_sse4(const int32_t* gt_data, const int num_samples, CarrierLocator& locator){
+  const __m128i max_non_alt{_mm_set1_epi32(MAX_NON_ALT_GT)};
+  const __m128i one_alt{_mm_set1_epi32(-1)};
+  const __m128i two_alt{_mm_set1_epi32(-2)};
+  int sample_idx{0};
+
+  for(; sample_idx + 4 <= num_samples && !locator.is_done(); sample_idx += 4){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+    __m128i lo_alts{_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), max_non_alt)};
+    __m128i hi_alts{_mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 4)), max_non_alt)};
+    __m128i neg_alt_counts{_mm_hadd_epi32(lo_alts, hi_alts)};
+
+    int n_hets{__builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(neg_alt_counts, one_alt))))};
+    int n_homs{__builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(neg_alt_counts, two_alt))))};
+
+    if(locator.is_wanted(n_hets, n_homs)){
+      locate_any_ploidy(gt_data, 2, sample_idx, sample_idx + 4, locator);
+    } else {
+      locator.skip(n_hets, n_homs);
+    }
+  }
+
+  locate_any_ploidy(gt_data, 2, sample_idx, num_samples, locator);
+}
+
+/* Per-sample counts are updated eight lanes at a time with the comparison masks, which are -1 when true.
+ * Het and hom lanes are counted, and compacted into the index lists when given, from the same masks.
+ */
+__attribute__((target("avx2")))
+void tally_diploid_avx2(const int32_t* gt_data, const int num_samples, Tally& tally){
+  const __m256i max_non_alt{_mm256_set1_epi32(MAX_NON_ALT_GT)};
+  const __m256i min_called{_mm256_set1_epi32(2)};
+  const __m256i vector_end{_mm256_set1_epi32(VECTOR_END_GT)};
+  const __m256i one_alt{_mm256_set1_epi32(-1)};
+  const __m256i two_alt{_mm256_set1_epi32(-2)};
+  const __m256i zero{_mm256_setzero_si256()};
+  const __m256i lane_offsets{_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+  int sample_idx{0};
+
+  for(; sample_idx + 8 <= num_samples; sample_idx += 8){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+    __m256i lo{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block))};
+    __m256i hi{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 8))};
+
+    // Pairwise sums ordered s0 s1 s4 s5 | s2 s3 s6 s7. Restore sample order to match the count arrays.
+    __m256i neg_alt_counts{_mm256_permute4x64_epi64(
+        _mm256_hadd_epi32(_mm256_cmpgt_epi32(lo, max_non_alt), _mm256_cmpgt_epi32(hi, max_non_alt)), 0xD8)};
+    __m256i lo_missing{_mm256_andnot_si256(_mm256_cmpeq_epi32(lo, vector_end), _mm256_cmpgt_epi32(min_called, lo))};
+    __m256i hi_missing{_mm256_andnot_si256(_mm256_cmpeq_epi32(hi, vector_end), _mm256_cmpgt_epi32(min_called, hi))};
+    __m256i neg_missing_counts{_mm256_permute4x64_epi64(_mm256_hadd_epi32(lo_missing, hi_missing), 0xD8)};
+
+    __m256i is_het{_mm256_cmpeq_epi32(neg_alt_counts, one_alt)};
+    __m256i is_hom{_mm256_cmpeq_epi32(neg_alt_counts, two_alt)};
+    __m256i is_missing{_mm256_andnot_si256(_mm256_cmpeq_epi32(neg_missing_counts, zero),
+                                           _mm256_cmpeq_epi32(neg_alt_counts, zero))};
+
+    __m256i* hets{reinterpret_cast<__m256i*>(tally.het_counts + sample_idx)};
+    __m256i* homs{reinterpret_cast<__m256i*>(tally.hom_counts + sample_idx)};
+    __m256i* missing{reinterpret_cast<__m256i*>(tally.missing_counts + sample_idx)};
+    _mm256_storeu_si256(hets, _mm256_sub_epi32(_mm256_loadu_si256(hets), is_het));
+    _mm256_storeu_si256(homs, _mm256_sub_epi32(_mm256_loadu_si256(homs), is_hom));
+    _mm256_storeu_si256(missing, _mm256_sub_epi32(_mm256_loadu_si256(missing), is_missing));
+
+    unsigned het_mask = _mm256_movemask_ps(_mm256_castsi256_ps(is_het));
+    unsigned hom_mask = _mm256_movemask_ps(_mm256_castsi256_ps(is_hom));
+    if((het_mask | hom_mask) == 0){ continue; }
+
+    tally.n_hets += __builtin_popcount(het_mask);
+    tally.n_homs += __builtin_popcount(hom_mask);
+    if(tally.het_idxs){
+      __m256i sample_idxs{_mm256_add_epi32(_mm256_set1_epi32(sample_idx), lane_offsets)};
+      if(het_mask){ append_lanes_avx2(*tally.het_idxs, sample_idxs, het_mask); }
+      if(hom_mask){ append_lanes_avx2(*tally.hom_idxs, sample_idxs, hom_mask); }
+    }
+  }
+
+  tally_fixed_ploidy<2>(gt_data, sample_idx, num_samples, tally);
+}
+
+__attribute__((target("sse4.1")))
+void tally_diploid_sse4(const int32_t* gt_data, const int num_samples, Tally& tally){
+  const __m128i max_non_alt{_mm_set1_epi32(MAX_NON_ALT_GT)};
+  const __m128i min_called{_mm_set1_epi32(2)};
+  const __m128i vector_end{_mm_set1_epi32(VECTOR_END_GT)};
+  const __m128i one_alt{_mm_set1_epi32(-1)};
+  const __m128i two_alt{_mm_set1_epi32(-2)};
+  const __m128i zero{_mm_setzero_si128()};
+  const __m128i lane_offsets{_mm_setr_epi32(0, 1, 2, 3)};
+  int sample_idx{0};
+
+  for(; sample_idx + 4 <= num_samples; sample_idx += 4){
+    const int32_t* block{gt_data + 2 * static_cast<size_t>(sample_idx)};
+    __m128i lo{_mm_loadu_si128(reinterpret_cast<const __m128i*>(block))};
+    __m128i hi{_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 4))};
+
+    __m128i neg_alt_counts{_mm_hadd_epi32(_mm_cmpgt_epi32(lo, max_non_alt), _mm_cmpgt_epi32(hi, max_non_alt))};
+    __m128i lo_missing{_mm_andnot_si128(_mm_cmpeq_epi32(lo, vector_end), _mm_cmpgt_epi32(min_called, lo))};
+    __m128i hi_missing{_mm_andnot_si128(_mm_cmpeq_epi32(hi, vector_end), _mm_cmpgt_epi32(min_called, hi))};
+    __m128i neg_missing_counts{_mm_hadd_epi32(lo_missing, hi_missing)};
+
+    __m128i is_het{_mm_cmpeq_epi32(neg_alt_counts, one_alt)};
+    __m128i is_hom{_mm_cmpeq_epi32(neg_alt_counts, two_alt)};
+    __m128i is_missing{_mm_andnot_si128(_mm_cmpeq_epi32(neg_missing_counts, zero),
+                                        _mm_cmpeq_epi32(neg_alt_counts, zero))};
+
+    __m128i* hets{reinterpret_cast<__m128i*>(tally.het_counts + sample_idx)};
+    __m128i* homs{reinterpret_cast<__m128i*>(tally.hom_counts + sample_idx)};
+    __m128i* missing{reinterpret_cast<__m128i*>(tally.missing_counts + sample_idx)};
+    _mm_storeu_si128(hets, _mm_sub_epi32(_mm_loadu_si128(hets), is_het));
+    _mm_storeu_si128(homs, _mm_sub_epi32(_mm_loadu_si128(homs), is_hom));
+    _mm_storeu_si128(missing, _mm_sub_epi32(_mm_loadu_si128(missing), is_missing));
+
+    unsigned het_mask = _mm_movemask_ps(_mm_castsi128_ps(is_het));
+    unsigned hom_mask = _mm_movemask_ps(_mm_castsi128_ps(is_hom));
+    if((het_mask | hom_mask) == 0){ continue; }
+
+    tally.n_hets += __builtin_popcount(het_mask);
+    tally.n_homs += __builtin_popcount(hom_mask);
+    if(tally.het_idxs){
+      __m128i sample_idxs{_mm_add_epi32(_mm_set1_epi32(sample_idx), lane_offsets)};
+      if(het_mask){ append_lanes_sse4(*tally.het_idxs, sample_idxs, het_mask); }
+      if(hom_mask){ append_lanes_sse4(*tally.hom_idxs, sample_idxs, hom_mask); }
+    }
+  }
+
+  tally_fixed_ploidy<2>(gt_data, sample_idx, num_samples, tally);
+}
+
+#endif /* GT_X86_KERNELS */
+
+void count_diploid(const int32_t* gt_data, const int num_samples, int& n_hets, int& n_homs,
+                   const GtKernel kernel){
+  switch(kernel){
+#ifdef GT_X86_KERNELS
+    case GtKernel::AVX2:
+      count_diploid_avx2(gt_data, num_samples, n_hets, n_homs);
+      break;
+    case GtKernel::SSE4:
+      count_diploid_sse4(gt_data, num_samples, n_hets, n_homs);
+      break;
+#endif
+    default:
+      count_fixed_ploidy<2>(gt_data, 0, num_samples, n_hets, n_homs);
+  }
+}
+
+void classify_diploid(const int32_t* gt_data, const int num_samples,
+                      std::vector<int>& het_idxs, std::vector<int>& hom_idxs, const GtKernel kernel){
+  switch(kernel){
+#ifdef GT_X86_KERNELS
+    case GtKernel::AVX2:
+      classify_diploid_avx2(gt_data, num_samples, het_idxs, hom_idxs);
+      break;
+    case GtKernel::SSE4:
+      classify_diploid_sse4(gt_data, num_samples, het_idxs, hom_idxs);
+      break;
+#endif
+    default:
+      classify_fixed_ploidy<2>(gt_data, 0, num_samples, het_idxs, hom_idxs);
+  }
+}
+
+} // namespace
+
+bool is_gt_kernel_supported(const GtKernel kernel){
+  switch(kernel){
+#ifdef GT_X86_KERNELS
+    case GtKernel::AVX2:
+      return __builtin_cpu_supports("avx2");
+    case GtKernel::SSE4:
+      return __builtin_cpu_supports("sse4.1");
+#endif
+    case GtKernel::SCALAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+GtKernel best_gt_kernel(){
+  static const GtKernel best{
+    is_gt_kernel_supported(GtKernel::AVX2) ? GtKernel::AVX2 :
+    is_gt_kernel_supported(GtKernel::SSE4) ? GtKernel::SSE4 : GtKernel::SCALAR};
+  return best;
+}
+
+void classify_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                        std::vector<int>& het_idxs, std::vector<int>& hom_idxs,
+                        const GtKernel kernel){
+  if(num_gt <= 0 || num_samples <= 0){ return; }
+
+  if(!is_gt_kernel_supported(kernel)){
+    throw std::runtime_error(std::string("Genotype kernel not supported by this CPU."));
+  }
+
+  // Records are padded with vector end values to the max ploidy of any sample.
+  const int max_ploidy{num_gt / num_samples};
+
+  switch(max_ploidy){
+    case 1:
+      classify_fixed_ploidy<1>(gt_data, 0, num_samples, het_idxs, hom_idxs);
+      break;
+    case 2:
+      classify_diploid(gt_data, num_samples, het_idxs, hom_idxs, kernel);
+      break;
+    case 3:
+      classify_fixed_ploidy<3>(gt_data, 0, num_samples, het_idxs, hom_idxs);
+      break;
+    case 4:
+      classify_fixed_ploidy<4>(gt_data, 0, num_samples, het_idxs, hom_idxs);
+      break;
+    default:
+      classify_any_ploidy(gt_data, max_ploidy, num_samples, het_idxs, hom_idxs);
+  }
+}
+
+void count_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                     int& n_hets, int& n_homs, const GtKernel kernel){
+  n_hets = 0;
+  n_homs = 0;
+  if(num_gt <= 0 || num_samples <= 0){ return; }
+
+  if(!is_gt_kernel_supported(kernel)){
+    throw std::runtime_error(std::string("Genotype kernel not supported by this CPU."));
+  }
+
+  const int max_ploidy{num_gt / num_samples};
+
+  switch(max_ploidy){
+    case 1:
+      count_fixed_ploidy<1>(gt_data, 0, num_samples, n_hets, n_homs);
+      break;
+    case 2:
+      count_diploid(gt_data, num_samples, n_hets, n_homs, kernel);
+      break;
+    default:
+      count_any_ploidy(gt_data, max_ploidy, num_samples, n_hets, n_homs);
+  }
+}
+
+void locate_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                      const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                      std::vector<int>& het_idxs, std::vector<int>& hom_idxs, const GtKernel kernel){
+  if(num_gt <= 0 || num_samples <= 0){ return; }
+
+  if(!is_gt_kernel_supported(kernel)){
+    throw std::runtime_error(std::string("Genotype kernel not supported by this CPU."));
+  }
+
+  CarrierLocator locator{het_ranks, hom_ranks, het_idxs, hom_idxs};
+  const int max_ploidy{num_gt / num_samples};
+
+  switch(max_ploidy == 2 ? kernel : GtKernel::SCALAR){
+#ifdef GT_X86_KERNELS
+    case GtKernel::AVX2:
+      locate_diploid_avx2(gt_data, num_samples, locator);
+      break;
+    case GtKernel::SSE4:
+      locate_diploid_sse4(gt_data, num_samples, locator);
+      break;
+#endif
+    default:
+      locate_any_ploidy(gt_data, max_ploidy, 0, num_samples, locator);
+  }
+}
+
+void tally_genotypes(const int32_t* gt_data, const int num_gt, const int num_samples,
+                     uint32_t* het_counts, uint32_t* hom_counts, uint32_t* missing_counts,
+                     int& n_hets, int& n_homs, std::vector<int>* het_idxs, std::vector<int>* hom_idxs,
+                     const GtKernel kernel){
+  n_hets = 0;
+  n_homs = 0;
+  if(num_gt <= 0 || num_samples <= 0){ return; }
+
+  if(!is_gt_kernel_supported(kernel)){
+    throw std::runtime_error(std::string("Genotype kernel not supported by this CPU."));
+  }
+  if(!het_idxs != !hom_idxs){
+    throw std::runtime_error(std::string("Het and hom index lists must be given together."));
+  }
+
+  Tally tally{het_counts, hom_counts, missing_counts, n_hets, n_homs, het_idxs, hom_idxs};
+  const int max_ploidy{num_gt / num_samples};
+
+  switch(max_ploidy == 2 ? kernel : GtKernel::SCALAR){
+#ifdef GT_X86_KERNELS
+    case GtKernel::AVX2:
+      tally_diploid_avx2(gt_data, num_samples, tally);
+      return;
+    case GtKernel::SSE4:
+      tally_diploid_sse4(gt_data, num_samples, tally);
+      return;
+#endif
+    default:
+      break;
+  }
+
+  switch(max_ploidy){
+    case 1:
+      tally_fixed_ploidy<1>(gt_data, 0, num_samples, tally);
+      break;
+    case 2:
+      tally_fixed_ploidy<2>(gt_data, 0, num_samples, tally);
+      break;
+    default:
+      tally_any_ploidy(gt_data, max_ploidy, num_samples, tally);
+  }
+}
@@ -0,0 +1,484 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "het_hom_index.hpp"
+
+static constexpr char MAGIC[]{"HHSI"};
+static constexpr uint32_t FORMAT_VERSION{1};
+static constexpr uint32_t SUBSET_FLAG{1};
+
+// Carrier encodings of a site entry.
+static constexpr uint32_t SAMPLE_LIST{0};
+static constexpr uint32_t SAMPLE_BITSET{1};
+
+// Bits counted by each rank directory entry of a bitset.
+static constexpr uint64_t WORDS_PER_RANK{8};
+
+struct IndexHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t reserved;
+  uint64_t n_samples;
+  uint64_t n_variants;
+  uint64_t samples_offset;
+  uint64_t contigs_offset;
+  uint64_t strings_offset;
+  uint64_t sites_offset;
+  uint64_t file_size;
+};
+static_assert(sizeof(IndexHeader) == 72);
+
+struct IndexCarriers {
+  uint64_t offset;
+  uint32_t count;
+  uint32_t encoding;
+};
+
+struct IndexSite {
+  int64_t pos;
+  // id, ref, and alt back to back in the strings section
+  uint64_t strings_offset;
+  uint32_t contig;
+  uint32_t id_length;
+  uint32_t ref_length;
+  uint32_t alt_length;
+  IndexCarriers het;
+  IndexCarriers hom;
+};
+static_assert(sizeof(IndexSite) == 64);
+
+static uint64_t n_bitset_words(const uint64_t n_samples){
+  return (n_samples + 63) / 64;
+}
+
+static uint64_t n_rank_entries(const uint64_t n_samples){
+  return (n_bitset_words(n_samples) + WORDS_PER_RANK - 1) / WORDS_PER_RANK;
+}
+
+/* Position of the set bit of word with rank among its set bits. */
+static int select_in_word(uint64_t word, int rank){
+  for(; rank > 0; rank--){
+    word &= word - 1;
+  }
+  return __builtin_ctzll(word);
+}
+
+bool is_het_hom_index(const std::string& path){
+  if(path == "-"){ return false; }
+
+  std::ifstream in{path, std::ios::binary};
+  char magic[4]{};
+  in.read(magic, sizeof(magic));
+  return in && std::memcmp(magic, MAGIC, sizeof(magic)) == 0;
+}
+
+/*******************
+ * Writer          *
+ ******************/
+HetHomIndexWriter::HetHomIndexWriter(const std::string& path, const std::vector<std::string>& sample_ids,
+                                     const bool is_subset)
+  : m_path{path},
+    m_out{path, std::ios::binary | std::ios::trunc},
+    m_n_samples{sample_ids.size()},
+    m_is_subset{is_subset}
+{
+  if(!m_out){
+    throw std::runtime_error(std::string("Failed to open output ") + path);
+  }
+
+  // Header is rewritten with section offsets on close.
+  IndexHeader header{};
+  write_bytes(&header, sizeof(header));
+
+  // Names section: count, offset of each name and the end of the last, then characters.
+  std::vector<uint64_t> name_offsets{0};
+  for(auto& sample_id : sample_ids){
+    name_offsets.push_back(name_offsets.back() + sample_id.size());
+  }
+  uint64_t n_names{sample_ids.size()};
+  write_bytes(&n_names, sizeof(n_names));
+  write_bytes(name_offsets.data(), name_offsets.size() * sizeof(uint64_t));
+  for(auto& sample_id : sample_ids){
+    write_bytes(sample_id.data(), sample_id.size());
+  }
+  pad();
+
+  m_words.resize(n_bitset_words(m_n_samples));
+}
+
+HetHomIndexWriter::~HetHomIndexWriter(){
+  try{
+    close();
+  } catch(...){
+  }
+}
+
+void HetHomIndexWriter::write_bytes(const void* data, const size_t size){
+  m_out.write(static_cast<const char*>(data), size);
+  if(!m_out){
+    throw std::runtime_error(std::string("Failed to write ") + m_path);
+  }
+  m_offset += size;
+}
+
+void HetHomIndexWriter::pad(){
+  static constexpr char zeros[8]{};
+  if(m_offset % 8 != 0){
+    write_bytes(zeros, 8 - m_offset % 8);
+  }
+}
+
+std::pair<uint64_t, uint32_t> HetHomIndexWriter::write_carriers(const std::vector<int>& idxs){
+  uint64_t offset{m_offset};
+  uint64_t list_size{idxs.size() * sizeof(uint32_t)};
+  uint64_t bitset_size{m_words.size() * sizeof(uint64_t) + n_rank_entries(m_n_samples) * sizeof(uint32_t)};
+
+  if(list_size <= bitset_size){
+    std::vector<uint32_t> list(idxs.begin(), idxs.end());
+    write_bytes(list.data(), list_size);
+    pad();
+    return {offset, SAMPLE_LIST};
+  }
+
+  std::fill(m_words.begin(), m_words.end(), 0);
+  for(int idx : idxs){
+    m_words[idx / 64] |= uint64_t{1} << (idx % 64);
+  }
+
+  // Rank directory: carriers before each group of WORDS_PER_RANK words.
+  std::vector<uint32_t> ranks{};
+  uint32_t n_before{0};
+  for(size_t word_idx{0}; word_idx < m_words.size(); word_idx++){
+    if(word_idx % WORDS_PER_RANK == 0){ ranks.push_back(n_before); }
+    n_before += __builtin_popcountll(m_words[word_idx]);
+  }
+
+  write_bytes(m_words.data(), m_words.size() * sizeof(uint64_t));
+  write_bytes(ranks.data(), ranks.size() * sizeof(uint32_t));
+  pad();
+  return {offset, SAMPLE_BITSET};
+}
+
+void HetHomIndexWriter::add(const std::string& chr, const int64_t pos, const std::string& id,
+                            const std::string& ref, const std::string& alt,
+                            const std::vector<int>& het_idxs, const std::vector<int>& hom_idxs){
+  auto [contig_it, is_new]{m_contig_idxs.try_emplace(chr, m_contigs.size())};
+  if(is_new){
+    m_contigs.push_back(chr);
+  }
+
+  IndexSite site{};
+  site.pos = pos;
+  site.contig = contig_it->second;
+  site.strings_offset = m_strings.size();
+  site.id_length = id.size();
+  site.ref_length = ref.size();
+  site.alt_length = alt.size();
+  m_strings.append(id).append(ref).append(alt);
+
+  auto [het_offset, het_encoding]{write_carriers(het_idxs)};
+  site.het = IndexCarriers{het_offset, static_cast<uint32_t>(het_idxs.size()), het_encoding};
+  auto [hom_offset, hom_encoding]{write_carriers(hom_idxs)};
+  site.hom = IndexCarriers{hom_offset, static_cast<uint32_t>(hom_idxs.size()), hom_encoding};
+
+  m_sites.append(reinterpret_cast<const char*>(&site), sizeof(site));
+}
+
+void HetHomIndexWriter::close(){
+  if(m_is_closed){ return; }
+  m_is_closed = true;
+
+  IndexHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+  header.version = FORMAT_VERSION;
+  header.flags = m_is_subset ? SUBSET_FLAG : 0;
+  header.n_samples = m_n_samples;
+  header.n_variants = m_sites.size() / sizeof(IndexSite);
+  header.samples_offset = sizeof(IndexHeader);
+
+  header.contigs_offset = m_offset;
+  std::vector<uint64_t> name_offsets{0};
+  for(auto& contig : m_contigs){
+    name_offsets.push_back(name_offsets.back() + contig.size());
+  }
+  uint64_t n_names{m_contigs.size()};
+  write_bytes(&n_names, sizeof(n_names));
+  write_bytes(name_offsets.data(), name_offsets.size() * sizeof(uint64_t));
+  for(auto& contig : m_contigs){
+    write_bytes(contig.data(), contig.size());
+  }
+  pad();
+
+  header.strings_offset = m_offset;
+  write_bytes(m_strings.data(), m_strings.size());
+  pad();
+
+  header.sites_offset = m_offset;
+  write_bytes(m_sites.data(), m_sites.size());
+  header.file_size = m_offset;
+
+  m_out.seekp(0);
+  m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  m_out.close();
+  if(!m_out){
+    throw std::runtime_error(std::string("Failed to write ") + m_path);
+  }
+}
+
+/*******************
+ * Reader          *
+ ******************/
+/* Names section at offset: count, count + 1 offsets, then characters. */
+static std::vector<std::string> read_names(const unsigned char* data, const size_t size, const uint64_t offset){
+  if(offset + sizeof(uint64_t) > size){
+    throw std::runtime_error(std::string("Malformed het/hom index: names out of range."));
+  }
+  uint64_t n_names{};
+  std::memcpy(&n_names, data + offset, sizeof(n_names));
+  const uint64_t offsets_size{(n_names + 1) * sizeof(uint64_t)};
+  if(n_names > size || offset + sizeof(uint64_t) + offsets_size > size){
+    throw std::runtime_error(std::string("Malformed het/hom index: names out of range."));
+  }
+
+  const uint64_t* name_offsets{reinterpret_cast<const uint64_t*>(data + offset + sizeof(uint64_t))};
+  const char* chars{reinterpret_cast<const char*>(data + offset + sizeof(uint64_t) + offsets_size)};
+  if(offset + sizeof(uint64_t) + offsets_size + name_offsets[n_names] > size){
+    throw std::runtime_error(std::string("Malformed het/hom index: names out of range."));
+  }
+
+  std::vector<std::string> names{};
+  names.reserve(n_names);
+  for(uint64_t i{0}; i < n_names; i++){
+    names.emplace_back(chars + name_offsets[i], name_offsets[i + 1] - name_offsets[i]);
+  }
+  return names;
+}
+
+HetHomIndexReader::HetHomIndexReader(const std::string& path){
+  int fd{::open(path.c_str(), O_RDONLY)};
+  if(fd < 0){
+    throw std::runtime_error(std::string("Failed to open ") + path + ": " + std::strerror(errno));
+  }
+
+  struct stat file_stat{};
+  if(fstat(fd, &file_stat) < 0 || file_stat.st_size < static_cast<off_t>(sizeof(IndexHeader))){
+    ::close(fd);
+    throw std::runtime_error(std::string("Not a het/hom index: ") + path);
+  }
+  m_size = file_stat.st_size;
+
+  void* mapped{mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0)};
+  ::close(fd);
+  if(mapped == MAP_FAILED){
+    throw std::runtime_error(std::string("Failed to map ") + path + ": " + std::strerror(errno));
+  }
+  m_data = static_cast<const unsigned char*>(mapped);
+
+  try{
+    const IndexHeader* header{reinterpret_cast<const IndexHeader*>(m_data)};
+    if(std::memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0){
+      throw std::runtime_error(std::string("Not a het/hom index: ") + path);
+    }
+    if(header->version != FORMAT_VERSION){
+      throw std::runtime_error(std::string("Unsupported version or byte order of het/hom index: ") + path);
+    }
+    if(header->file_size != m_size || header->sites_offset > m_size ||
+       header->n_variants > (m_size - header->sites_offset) / sizeof(IndexSite)){
+      throw std::runtime_error(std::string("Truncated het/hom index: ") + path);
+    }
+
+    std::vector<std::string> sample_ids{read_names(m_data, m_size, header->samples_offset)};
+    m_contigs = read_names(m_data, m_size, header->contigs_offset);
+    if(sample_ids.size() != header->n_samples){
+      throw std::runtime_error(std::string("Malformed het/hom index: ") + path);
+    }
+
+    m_num_samples = sample_ids.size();
+    m_num_variants = header->n_variants;
+    m_is_subset = header->flags & SUBSET_FLAG;
+    m_sample_names = SampleNameTable{sample_ids};
+    m_strings = m_data + header->strings_offset;
+    m_sites = m_data + header->sites_offset;
+  } catch(...){
+    munmap(const_cast<unsigned char*>(m_data), m_size);
+    throw;
+  }
+
+  // Sites are read in order, so let the kernel read ahead on them. Carriers before them keep the
+  // default advice: selecting by rank reads only a few words of each bitset, which sequential
+  // read-ahead would inflate, and it would drop pages other readers of the index still use.
+  const uint64_t page_size{static_cast<uint64_t>(sysconf(_SC_PAGESIZE))};
+  const uint64_t sites_page{static_cast<uint64_t>(m_sites - m_data) / page_size * page_size};
+  madvise(const_cast<unsigned char*>(m_data) + sites_page, m_size - sites_page, MADV_SEQUENTIAL);
+
+  m_het_idxs.reserve(m_num_samples);
+  m_hom_idxs.reserve(m_num_samples);
+}
+
+HetHomIndexReader::~HetHomIndexReader(){
+  munmap(const_cast<unsigned char*>(m_data), m_size);
+}
+
+uint64_t HetHomIndexReader::n_variants() const{ return m_num_variants; }
+int HetHomIndexReader::n_samples() const{ return m_num_samples; }
+bool HetHomIndexReader::is_subset() const{ return m_is_subset; }
+const SampleNameTable& HetHomIndexReader::sample_names() const{ return m_sample_names; }
+
+std::vector<std::string> HetHomIndexReader::sample_ids() const{
+  std::vector<std::string> ids{};
+  ids.reserve(m_num_samples);
+  for(int idx{0}; idx < m_num_samples; idx++){
+    ids.emplace_back(m_sample_names[idx]);
+  }
+  return ids;
+}
+
+int HetHomIndexReader::n_hets() const{ return reinterpret_cast<const IndexSite*>(m_site)->het.count; }
+int HetHomIndexReader::n_homs() const{ return reinterpret_cast<const IndexSite*>(m_site)->hom.count; }
+int64_t HetHomIndexReader::pos() const{ return m_pos; }
+const std::string& HetHomIndexReader::chr() const{ return m_chr; }
+const std::string& HetHomIndexReader::id()  const{ return m_id;  }
+const std::string& HetHomIndexReader::ref() const{ return m_ref; }
+const std::string& HetHomIndexReader::alt() const{ return m_alt; }
+
+const std::vector<int>& HetHomIndexReader::het_idxs() const{ return m_het_idxs; }
+const std::vector<int>& HetHomIndexReader::hom_idxs() const{ return m_hom_idxs; }
+
+void HetHomIndexReader::set_collect_carriers(const bool collect){
+  m_collect_carriers = collect;
+}
+
+void HetHomIndexReader::seek(const uint64_t variant_idx){
+  m_next_variant = std::min(variant_idx, m_num_variants);
+}
+
+/* Append every carrier of an encoded list or bitset. */
+static void decode_carriers(const unsigned char* data, const IndexCarriers& carriers, const int n_samples,
+                            std::vector<int>& idxs){
+  if(carriers.encoding == SAMPLE_LIST){
+    const uint32_t* list{reinterpret_cast<const uint32_t*>(data + carriers.offset)};
+    idxs.insert(idxs.end(), list, list + carriers.count);
+    return;
+  }
+
+  const size_t n_before{idxs.size()};
+  const uint64_t* words{reinterpret_cast<const uint64_t*>(data + carriers.offset)};
+  for(uint64_t word_idx{0}; word_idx < n_bitset_words(n_samples); word_idx++){
+    uint64_t word{words[word_idx]};
+    while(word){
+      idxs.push_back(64 * word_idx + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+
+  if(idxs.size() - n_before != carriers.count){
+    throw std::runtime_error(std::string("Malformed het/hom index: carrier count does not match bitset."));
+  }
+}
+
+/* Append carriers at ascending ranks. Bitsets locate each rank from the rank directory.
+ * Throws runtime_error for ranks not below count, or when the bitset holds fewer carriers than
+ *   the rank directory and count claim, so a malformed index is never read past its bitset.
+ */
+static void select_carriers(const unsigned char* data, const IndexCarriers& carriers, const int n_samples,
+                            const std::vector<int>& ranks, std::vector<int>& idxs){
+  for(int rank : ranks){
+    if(rank < 0 || static_cast<uint32_t>(rank) >= carriers.count){
+      throw std::runtime_error(std::string("Carrier rank out of range: ") + std::to_string(rank));
+    }
+  }
+
+  if(carriers.encoding == SAMPLE_LIST){
+    const uint32_t* list{reinterpret_cast<const uint32_t*>(data + carriers.offset)};
+    for(int rank : ranks){ idxs.push_back(list[rank]); }
+    return;
+  }
+
+  const uint64_t n_words{n_bitset_words(n_samples)};
+  const uint64_t* words{reinterpret_cast<const uint64_t*>(data + carriers.offset)};
+  const uint32_t* rank_dir{reinterpret_cast<const uint32_t*>(words + n_words)};
+  const uint32_t* rank_end{rank_dir + n_rank_entries(n_samples)};
+
+  for(int rank : ranks){
+    // Last directory entry with at most rank carriers before it. The first entry is always 0.
+    const uint32_t* entry{std::upper_bound(rank_dir, rank_end, static_cast<uint32_t>(rank))};
+    if(entry == rank_dir){
+      throw std::runtime_error(std::string("Malformed het/hom index: rank directory does not start at 0."));
+    }
+    entry--;
+    uint64_t word_idx{static_cast<uint64_t>(entry - rank_dir) * WORDS_PER_RANK};
+    int remaining{rank - static_cast<int>(*entry)};
+
+    for(; word_idx < n_words; word_idx++){
+      int n_set{__builtin_popcountll(words[word_idx])};
+      if(remaining < n_set){ break; }
+      remaining -= n_set;
+    }
+    if(word_idx == n_words){
+      throw std::runtime_error(std::string("Malformed het/hom index: carrier count does not match bitset."));
+    }
+    idxs.push_back(64 * word_idx + select_in_word(words[word_idx], remaining));
+  }
+}
+
+void HetHomIndexReader::carriers_at(const std::vector<int>& het_ranks, const std::vector<int>& hom_ranks,
+                                    std::vector<int>& het_out, std::vector<int>& hom_out) const{
+  const IndexSite* site{reinterpret_cast<const IndexSite*>(m_site)};
+  select_carriers(m_data, site->het, m_num_samples, het_ranks, het_out);
+  select_carriers(m_data, site->hom, m_num_samples, hom_ranks, hom_out);
+}
+
+/* Bytes of an encoded list or bitset. */
+static uint64_t carriers_size(const IndexCarriers& carriers, const int n_samples){
+  if(carriers.encoding == SAMPLE_LIST){
+    return uint64_t{carriers.count} * sizeof(uint32_t);
+  }
+  return n_bitset_words(n_samples) * sizeof(uint64_t) + n_rank_entries(n_samples) * sizeof(uint32_t);
+}
+
+bool HetHomIndexReader::next_variant(){
+  if(m_next_variant >= m_num_variants){ return false; }
+
+  m_site = m_sites + m_next_variant * sizeof(IndexSite);
+  m_next_variant++;
+  const IndexSite* site{reinterpret_cast<const IndexSite*>(m_site)};
+
+  const uint64_t sites_offset{static_cast<uint64_t>(m_sites - m_data)};
+  for(const IndexCarriers* carriers : {&site->het, &site->hom}){
+    if(carriers->encoding > SAMPLE_BITSET || carriers->count > static_cast<uint32_t>(m_num_samples) ||
+       carriers->offset > sites_offset || carriers_size(*carriers, m_num_samples) > sites_offset - carriers->offset){
+      throw std::runtime_error(std::string("Malformed het/hom index: carriers out of range."));
+    }
+  }
+  const uint64_t strings_length{uint64_t{site->id_length} + site->ref_length + site->alt_length};
+  if(site->strings_offset + strings_length > sites_offset - static_cast<uint64_t>(m_strings - m_data)){
+    throw std::runtime_error(std::string("Malformed het/hom index: site strings out of range."));
+  }
+
+  if(site->contig >= m_contigs.size()){
+    throw std::runtime_error(std::string("Malformed het/hom index: contig out of range."));
+  }
+
+  const char* strings{reinterpret_cast<const char*>(m_strings + site->strings_offset)};
+  m_chr = m_contigs[site->contig];
+  m_pos = site->pos;
+  m_id.assign(strings, site->id_length);
+  m_ref.assign(strings + site->id_length, site->ref_length);
+  m_alt.assign(strings + site->id_length + site->ref_length, site->alt_length);
+
+  m_het_idxs.clear();
+  m_hom_idxs.clear();
+  if(m_collect_carriers){
+    decode_carriers(m_data, site->het, m_num_samples, m_het_idxs);
+    decode_carriers(m_data, site->hom, m_num_samples, m_hom_idxs);
+  }
+
+  return true;
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include "boost/algorithm/string/split.hpp"
+#include "boost/algorithm/string/classification.hpp"
+#include "sample_counts.hpp"
+
+namespace alg = boost::algorithm;
+
+std::vector<int64_t> parse_size_bounds(const std::string& bounds){
+  std::vector<std::string> fields{};
+  alg::split(fields, bounds, alg::is_any_of(","), alg::token_compress_on);
+
+  std::vector<int64_t> size_bounds{};
+  for(auto& field : fields){
+    int64_t bound{0};
+    auto [end, ec]{std::from_chars(field.data(), field.data() + field.size(), bound)};
+    if(ec != std::errc{} || end != field.data() + field.size() || bound <= 0 ||
+       (!size_bounds.empty() && bound <= size_bounds.back())){
+      throw std::runtime_error(std::string("Size bounds must be ascending positive integers: ") + bounds);
+    }
+    size_bounds.push_back(bound);
+  }
+  return size_bounds;
+}
+
+SampleCounts::SampleCounts(const int n_samples, const CountStrata& strata)
+  : m_num_samples{n_samples},
+    m_strata{strata},
+    m_kernel{best_gt_kernel()}
+{}
+
+const CountStrata& SampleCounts::strata() const{
+  return m_strata;
+}
+
+SampleCounts::Stratum& SampleCounts::stratum(const StratumKeyView key){
+  auto stratum_it{m_counts.find(key)};
+  if(stratum_it == m_counts.end()){
+    stratum_it = m_counts.emplace(StratumKey{key.first, key.second}, Stratum{}).first;
+    stratum_it->second.hets.resize(m_num_samples);
+    stratum_it->second.homs.resize(m_num_samples);
+    stratum_it->second.missing.resize(m_num_samples);
+  }
+  return stratum_it->second;
+}
+
+void SampleCounts::add(const int32_t* gt_data, const int num_gt, std::string_view sv_type,
+                       const int64_t sv_length){
+  int n_hets{0};
+  int n_homs{0};
+  add(gt_data, num_gt, sv_type, sv_length, n_hets, n_homs, nullptr, nullptr);
+}
+
+void SampleCounts::add(const int32_t* gt_data, const int num_gt, std::string_view sv_type,
+                       const int64_t sv_length, int& n_hets, int& n_homs,
+                       std::vector<int>* het_idxs, std::vector<int>* hom_idxs){
+  int bin{-1};
+  if(!m_strata.size_bounds.empty()){
+    const std::vector<int64_t>& bounds{m_strata.size_bounds};
+    bin = std::upper_bound(bounds.begin(), bounds.end(), sv_length) - bounds.begin();
+  }
+
+  Stratum& counts{stratum(StratumKeyView{m_strata.by_svtype ? sv_type : std::string_view{}, bin})};
+  tally_genotypes(gt_data, num_gt, m_num_samples, counts.hets.data(), counts.homs.data(), counts.missing.data(),
+                  n_hets, n_homs, het_idxs, hom_idxs, m_kernel);
+}
+
+void SampleCounts::merge(const SampleCounts& other){
+  for(auto& [key, other_counts] : other.m_counts){
+    Stratum& counts{stratum(key)};
+    for(int sample_idx{0}; sample_idx < m_num_samples; sample_idx++){
+      counts.hets[sample_idx] += other_counts.hets[sample_idx];
+      counts.homs[sample_idx] += other_counts.homs[sample_idx];
+      counts.missing[sample_idx] += other_counts.missing[sample_idx];
+    }
+  }
+}
+
+std::string SampleCounts::size_label(const int bin) const{
+  if(bin < 0){ return "ALL"; }
+
+  const std::vector<int64_t>& bounds{m_strata.size_bounds};
+  std::string lower{bin == 0 ? "0" : std::to_string(bounds[bin - 1])};
+  std::string upper{static_cast<size_t>(bin) == bounds.size() ? "inf" : std::to_string(bounds[bin])};
+  return "[" + lower + "," + upper + ")";
+}
+
+void SampleCounts::write(const SampleNameTable& names, TsvWriter& out) const{
+  out.write("#SAMPLE\tSVTYPE\tSIZE\tHET\tHOM\tMISSING\n");
+
+  // Largest uint32 is 10 digits.
+  char digits[10];
+  auto append_count = [&](std::string& buf, const uint32_t count){
+    auto [end, ec]{std::to_chars(digits, digits + sizeof(digits), count)};
+    buf.push_back('\t');
+    buf.append(digits, end);
+  };
+
+  for(auto& [key, counts] : m_counts){
+    const std::string sv_type{m_strata.by_svtype ? key.first : "ALL"};
+    const std::string size{size_label(key.second)};
+
+    for(int sample_idx{0}; sample_idx < m_num_samples; sample_idx++){
+      std::string& buf{out.buffer()};
+      buf.append(names[sample_idx]).push_back('\t');
+      buf.append(sv_type).push_back('\t');
+      buf.append(size);
+      append_count(buf, counts.hets[sample_idx]);
+      append_count(buf, counts.homs[sample_idx]);
+      append_count(buf, counts.missing[sample_idx]);
+      buf.push_back('\n');
+      out.flush_if_full();
+    }
+  }
+}
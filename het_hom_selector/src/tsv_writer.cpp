@@ -0,0 +1,119 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <htslib/bgzf.h>
+#include "tsv_writer.hpp"
+
+TsvWriter::TsvWriter(const std::string& path, const bool is_bgzf, const int threads){
+  m_buf.reserve(FLUSH_SIZE + (FLUSH_SIZE >> 2));
+
+  if(is_bgzf){
+    m_bgzf = path == "-" ? bgzf_dopen(STDOUT_FILENO, "w") : bgzf_open(path.c_str(), "w");
+    if(!m_bgzf){
+      throw std::runtime_error(std::string("Failed to open output ") + path);
+    }
+    if(threads > 1 && bgzf_mt(m_bgzf, threads, 256) < 0){
+      throw std::runtime_error(std::string("Failed to start compression threads for ") + path);
+    }
+    return;
+  }
+
+  if(path == "-"){
+    m_fd = STDOUT_FILENO;
+    return;
+  }
+
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(m_fd < 0){
+    throw std::runtime_error(std::string("Failed to open output ") + path + ": " + std::strerror(errno));
+  }
+  m_owns_fd = true;
+}
+
+TsvWriter::TsvWriter(std::ostream& out)
+  : m_stream{&out}
+{
+  m_buf.reserve(FLUSH_SIZE + (FLUSH_SIZE >> 2));
+}
+
+TsvWriter::~TsvWriter(){
+  try{
+    close();
+  } catch(...){
+  }
+}
+
+std::string& TsvWriter::buffer(){
+  return m_buf;
+}
+
+void TsvWriter::write(std::string_view text){
+  m_buf.append(text);
+  flush_if_full();
+}
+
+void TsvWriter::flush_if_full(){
+  if(m_buf.size() >= FLUSH_SIZE){
+    flush();
+  }
+}
+
+void TsvWriter::flush(){
+  if(m_buf.empty()){ return; }
+
+  if(m_bgzf){
+    if(bgzf_write(m_bgzf, m_buf.data(), m_buf.size()) < 0){
+      throw std::runtime_error(std::string("Failed to write compressed output."));
+    }
+  } else if(m_stream){
+    m_stream->write(m_buf.data(), m_buf.size());
+    if(!*m_stream){
+      throw std::runtime_error(std::string("Failed to write output."));
+    }
+  } else if(m_fd >= 0){
+    // write(2) may take less than the whole buffer, e.g. into a pipe.
+    const char* data{m_buf.data()};
+    size_t remaining{m_buf.size()};
+    while(remaining > 0){
+      ssize_t n_written{::write(m_fd, data, remaining)};
+      if(n_written < 0){
+        if(errno == EINTR){ continue; }
+        throw std::runtime_error(std::string("Failed to write output: ") + std::strerror(errno));
+      }
+      data += n_written;
+      remaining -= n_written;
+    }
+  }
+
+  m_buf.clear();
+}
+
+void TsvWriter::close(){
+  // Sinks are closed even if the final flush fails.
+  std::string error{};
+  try{
+    flush();
+  } catch(std::runtime_error& ex){
+    error = ex.what();
+    m_buf.clear();
+  }
+
+  if(m_bgzf && bgzf_close(m_bgzf) < 0 && error.empty()){
+    error = "Failed to close compressed output.";
+  }
+  if(m_owns_fd && ::close(m_fd) < 0 && error.empty()){
+    error = std::string("Failed to close output: ") + std::strerror(errno);
+  }
+
+  m_bgzf = nullptr;
+  m_owns_fd = false;
+  m_fd = -1;
+  m_stream = nullptr;
+
+  if(!error.empty()){
+    throw std::runtime_error(error);
+  }
+}
@@ -0,0 +1,59 @@
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "variant_filter.hpp"
+
+bool VariantFilter::is_active() const{
+  return !sv_types.empty() || min_svlen > 0 || max_svlen < std::numeric_limits<int64_t>::max() ||
+         pass_only || min_ac > 0 || min_af > 0.0 || !regions.empty();
+}
+
+/* Parse 1-based position. */
+static int64_t parse_position(const std::string& text, const std::string& region){
+  size_t n_parsed{0};
+  int64_t position{0};
+  try{
+    position = std::stoll(text, &n_parsed);
+  } catch(std::exception&){
+    n_parsed = 0;
+  }
+
+  if(text.empty() || n_parsed != text.size() || position < 1){
+    throw std::runtime_error(std::string("Malformed region: ") + region);
+  }
+  return position;
+}
+
+std::vector<SiteRegion> parse_site_regions(const std::string& regions){
+  std::vector<SiteRegion> parsed{};
+  std::stringstream region_stream{regions};
+  std::string region{};
+
+  while(std::getline(region_stream, region, ',')){
+    if(region.empty()){ continue; }
+
+    SiteRegion site_region{};
+    size_t colon{region.rfind(':')};
+    site_region.contig = region.substr(0, colon);
+
+    if(colon != std::string::npos){
+      std::string range{region.substr(colon + 1)};
+      size_t dash{range.find('-')};
+
+      site_region.beg = parse_position(range.substr(0, dash), region) - 1;
+      if(dash == std::string::npos){
+        site_region.end = site_region.beg + 1;
+      } else if(dash + 1 < range.size()){
+        site_region.end = parse_position(range.substr(dash + 1), region);
+      }
+    }
+
+    if(site_region.contig.empty() || site_region.end <= site_region.beg){
+      throw std::runtime_error(std::string("Malformed region: ") + region);
+    }
+    parsed.push_back(site_region);
+  }
+
+  return parsed;
+}
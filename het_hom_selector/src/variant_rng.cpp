@@ -0,0 +1,113 @@
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <set>
+#include <string>
+#include <vector>
+#include "variant_rng.hpp"
+
+namespace {
+
+constexpr uint32_t PHILOX_M0{0xD2511F53};
+constexpr uint32_t PHILOX_M1{0xCD9E8D57};
+constexpr uint32_t PHILOX_W0{0x9E3779B9};
+constexpr uint32_t PHILOX_W1{0xBB67AE85};
+
+constexpr uint64_t FNV_OFFSET{14695981039346656037ULL};
+constexpr uint64_t FNV_PRIME{1099511628211ULL};
+
+void fnv1a(uint64_t& hash, const uint8_t byte){
+  hash = (hash ^ byte) * FNV_PRIME;
+}
+
+void fnv1a(uint64_t& hash, const std::string& str){
+  for(char c : str){ fnv1a(hash, static_cast<uint8_t>(c)); }
+  // Terminator keeps ("AC","G") and ("A","CG") apart.
+  fnv1a(hash, 0);
+}
+
+/* Hash of variant fields, independent of host byte order. */
+uint64_t variant_hash(const std::string& chr, const int64_t pos, const std::string& ref, const std::string& alt){
+  uint64_t hash{FNV_OFFSET};
+  fnv1a(hash, chr);
+  for(int shift{0}; shift < 64; shift += 8){
+    fnv1a(hash, static_cast<uint8_t>(static_cast<uint64_t>(pos) >> shift));
+  }
+  fnv1a(hash, ref);
+  fnv1a(hash, alt);
+  return hash;
+}
+
+} // namespace
+
+VariantRng::VariantRng(const uint32_t seed, const std::string& chr, const int64_t pos,
+                       const std::string& ref, const std::string& alt, const uint32_t stream){
+  uint64_t hash{variant_hash(chr, pos, ref, alt)};
+
+  // Counter: variant hash, stream, block index. Key: seed.
+  m_counter = {static_cast<uint32_t>(hash), static_cast<uint32_t>(hash >> 32), stream, 0};
+  m_key = {seed, 0};
+}
+
+std::array<uint32_t, 4> VariantRng::philox(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key){
+  for(int round{0}; round < 10; round++){
+    uint64_t product0{static_cast<uint64_t>(PHILOX_M0) * counter[0]};
+    uint64_t product1{static_cast<uint64_t>(PHILOX_M1) * counter[2]};
+
+    counter = {
+      static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+      static_cast<uint32_t>(product1),
+      static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+      static_cast<uint32_t>(product0)};
+
+    key[0] += PHILOX_W0;
+    key[1] += PHILOX_W1;
+  }
+  return counter;
+}
+
+VariantRng::result_type VariantRng::operator()(){
+  if(m_block_idx == 4){
+    m_block = philox(m_counter, m_key);
+    m_counter[3]++;
+    m_block_idx = 0;
+  }
+  return m_block[m_block_idx++];
+}
+
+uint32_t VariantRng::uniform_below(const uint32_t n){
+  // Lemire's multiply and shift with rejection of the biased low range.
+  uint64_t product{static_cast<uint64_t>((*this)()) * n};
+  uint32_t low{static_cast<uint32_t>(product)};
+
+  if(low < n){
+    uint32_t threshold{static_cast<uint32_t>(-n) % n};
+    while(low < threshold){
+      product = static_cast<uint64_t>((*this)()) * n;
+      low = static_cast<uint32_t>(product);
+    }
+  }
+  return static_cast<uint32_t>(product >> 32);
+}
+
+std::vector<int> counter_positions(const int population, const int n, VariantRng& rng){
+  std::vector<int> positions{};
+  if(n <= 0 || population <= 0){ return positions; }
+
+  if(n >= population){
+    positions.resize(population);
+    std::iota(positions.begin(), positions.end(), 0);
+    return positions;
+  }
+
+  std::set<int> chosen{};
+  for(int j{population - n}; j < population; j++){
+    int t{static_cast<int>(rng.uniform_below(j + 1))};
+    if(!chosen.insert(t).second){
+      chosen.insert(j);
+    }
+  }
+
+  positions.assign(chosen.begin(), chosen.end());
+  return positions;
+}
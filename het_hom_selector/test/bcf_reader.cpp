@@ -133,3 +133,57 @@ TEST_F(StructVarTest, ExpectedHetsAndHomsIndexes){
   EXPECT_THAT(reader.hom_idxs(), testing::ElementsAre(3,4));
 }
 
+TEST_F(StructVarTest, CarriersAtMatchesCollectedIndexes){
+  BcfReader collected{test_data_path.string()};
+  BcfReader counted{test_data_path.string()};
+  counted.set_collect_carriers(false);
+
+  while(collected.next_variant()){
+    ASSERT_TRUE(counted.next_variant());
+    EXPECT_TRUE(counted.het_idxs().empty());
+    ASSERT_EQ(counted.n_hets(), collected.n_hets());
+    ASSERT_EQ(counted.n_homs(), collected.n_homs());
+
+    // Every other het and the last hom.
+    std::vector<int> het_ranks{};
+    for(int rank{0}; rank < collected.n_hets(); rank += 2){ het_ranks.push_back(rank); }
+    std::vector<int> hom_ranks{};
+    if(collected.n_homs() > 0){ hom_ranks.push_back(collected.n_homs() - 1); }
+
+    std::vector<int> expected_hets{}, expected_homs{}, het_idxs{}, hom_idxs{};
+    collected.carriers_at(het_ranks, hom_ranks, expected_hets, expected_homs);
+    counted.carriers_at(het_ranks, hom_ranks, het_idxs, hom_idxs);
+    EXPECT_EQ(het_idxs, expected_hets);
+    EXPECT_EQ(hom_idxs, expected_homs);
+  }
+}
+
+TEST_F(StructVarTest, SampleSubset){
+  BcfReader reader{test_data_path.string()};
+  reader.set_samples("EXAMPLE05,EXAMPLE02,EXAMPLE01", false);
+
+  // Subset follows header order.
+  EXPECT_EQ(reader.n_samples(), 3);
+  EXPECT_THAT(reader.sample_ids(), testing::ElementsAre("EXAMPLE01", "EXAMPLE02", "EXAMPLE05"));
+
+  reader.next_variant();
+  EXPECT_THAT(reader.sample_idxs_to_ids(reader.het_idxs()), testing::ElementsAre("EXAMPLE02"));
+  EXPECT_THAT(reader.sample_idxs_to_ids(reader.hom_idxs()), testing::ElementsAre("EXAMPLE01"));
+}
+
+TEST_F(StructVarTest, SampleExclusion){
+  BcfReader reader{test_data_path.string()};
+  reader.set_samples("^EXAMPLE01", false);
+
+  EXPECT_EQ(reader.n_samples(), 9);
+  EXPECT_EQ(reader.sample_idx_to_id(0), "EXAMPLE02");
+
+  reader.next_variant();
+  EXPECT_THAT(reader.sample_idxs_to_ids(reader.het_idxs()), testing::ElementsAre("EXAMPLE02", "EXAMPLE03"));
+  EXPECT_TRUE(reader.hom_idxs().empty());
+}
+
+TEST_F(StructVarTest, SampleSubsetUnknownSample){
+  BcfReader reader{test_data_path.string()};
+  EXPECT_THROW(reader.set_samples("EXAMPLE01,NOT_A_SAMPLE", false), std::runtime_error);
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "structvar_fixture.hpp"
+#include "app_control_data.hpp"
+#include "app.hpp"
+#include "carrier_file.hpp"
+
+TEST(CarrierFile, RoundTrip){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("round_trip.hhsc")};
+
+  // Sparse carriers suit delta lists and dense carriers suit bitmaps.
+  std::vector<int> sparse{3, 700, 9999};
+  std::vector<int> dense{};
+  for(int i{100}; i < 5000; i += 2){ dense.push_back(i); }
+
+  {
+    CarrierFileWriter writer{path.string(), numbered_samples(10000), "#HEADER\n", true};
+    writer.add("chr1", 10, "SV1", "A", "<DEL>", sparse, dense);
+    writer.add("chr1", 20, "SV2", "C", "<DUP>", {}, {0});
+    writer.add("chr2", 5, "SV3", "G", "<INV>", dense, {});
+    writer.close();
+  }
+
+  CarrierFileReader reader{path.string()};
+  EXPECT_EQ(reader.n_variants(), 3);
+  EXPECT_EQ(reader.sample_ids().size(), 10000);
+  EXPECT_EQ(reader.sample_ids()[9999], "S9999");
+  EXPECT_EQ(reader.header_text(), "#HEADER\n");
+  EXPECT_TRUE(reader.emit_id());
+
+  CarrierRecord record{};
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.chr, "chr1");
+  EXPECT_EQ(record.pos, 10);
+  EXPECT_EQ(record.id, "SV1");
+  EXPECT_EQ(record.alt, "<DEL>");
+  EXPECT_EQ(record.het_idxs, sparse);
+  EXPECT_EQ(record.hom_idxs, dense);
+
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_TRUE(record.het_idxs.empty());
+  EXPECT_THAT(record.hom_idxs, testing::ElementsAre(0));
+
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.chr, "chr2");
+  EXPECT_EQ(record.het_idxs, dense);
+  EXPECT_FALSE(reader.next(record));
+}
+
+TEST(CarrierFile, DenseCarriersAreSmallerThanIds){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("dense.hhsc")};
+  std::vector<int> carriers{};
+  for(int i{0}; i < 100000; i += 3){ carriers.push_back(i); }
+
+  {
+    CarrierFileWriter writer{path.string(), numbered_samples(100000)};
+    for(int i{0}; i < 100; i++){
+      writer.add("chr1", i, ".", "N", "<DEL>", carriers, {});
+    }
+  }
+
+  // A bitmap is 12.5 kB per variant before compression.
+  EXPECT_LT(fs::file_size(path), 100 * 12500);
+
+  CarrierFileReader reader{path.string()};
+  CarrierRecord record{};
+  int n_read{0};
+  while(reader.next(record)){
+    EXPECT_EQ(record.het_idxs, carriers);
+    n_read++;
+  }
+  EXPECT_EQ(n_read, 100);
+}
+
+TEST(CarrierFile, Seek){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("seek.hhsc")};
+
+  // Small blocks spread variants over many blocks.
+  {
+    CarrierFileWriter writer{path.string(), numbered_samples(50), "", false, 64};
+    for(int i{0}; i < 500; i++){
+      writer.add(i < 250 ? "chr1" : "chr2", 100 * (i % 250), "V" + std::to_string(i), "A", "T",
+                 {i % 50}, {});
+    }
+  }
+
+  CarrierFileReader reader{path.string()};
+  ASSERT_GT(reader.n_blocks(), 10);
+  CarrierRecord record{};
+
+  reader.seek(uint64_t{317});
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.id, "V317");
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.id, "V318");
+
+  reader.seek(uint64_t{500});
+  EXPECT_FALSE(reader.next(record));
+
+  // Between variants seeks to the following one.
+  ASSERT_TRUE(reader.seek("chr2", 1050));
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.id, "V261");
+
+  ASSERT_TRUE(reader.seek("chr1", 0));
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.id, "V0");
+
+  EXPECT_FALSE(reader.seek("chrX", 0));
+}
+
+TEST(CarrierFile, RejectsOtherFiles){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("not_carriers.txt")};
+  {
+    std::ofstream out{path};
+    out << "#CHROM\tPOS\tREF\tALT\tHOM\tHET\nchr1\t1\tA\tT\t\t\n";
+  }
+  EXPECT_THROW(CarrierFileReader{path.string()}, std::runtime_error);
+}
+
+TEST_F(StructVarTest, ConvertsBackToTsv){
+  fs::path tsv_path{temp_dir.path("all.tsv")};
+  fs::path carriers_path{temp_dir.path("all.hhsc")};
+  fs::path converted_path{temp_dir.path("converted.tsv")};
+
+  AppControlData control{};
+  control.input_path = test_data_path.string();
+  control.action = "all";
+  control.emit_id = true;
+  control.rnd_seed = 1;
+
+  control.output_path = tsv_path.string();
+  ASSERT_TRUE(run(control));
+
+  control.output_format = "carriers";
+  control.output_path = carriers_path.string();
+  ASSERT_TRUE(run(control));
+
+  AppControlData convert{};
+  convert.action = "to-tsv";
+  convert.input_path = carriers_path.string();
+  convert.output_path = converted_path.string();
+  ASSERT_TRUE(run(convert));
+
+  std::string expected{read_text(tsv_path)};
+  EXPECT_NE(expected.find("EXAMPLE02,EXAMPLE03"), std::string::npos);
+  EXPECT_EQ(read_text(converted_path), expected);
+}
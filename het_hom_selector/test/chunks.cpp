@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "structvar_fixture.hpp"
+#include "app_control_data.hpp"
+#include "app.hpp"
+#include "bcf_reader.hpp"
+#include "tsv_writer.hpp"
+#include "htslib/vcf.h"
+
+/* Copy test VCF to an indexed BCF at bcf_path. */
+static std::string indexed_bcf_copy(const fs::path& vcf_path, const fs::path& bcf_path){
+
+  htsFile* in{bcf_open(vcf_path.c_str(), "r")};
+  htsFile* out{bcf_open(bcf_path.c_str(), "wb")};
+  bcf_hdr_t* hdr{bcf_hdr_read(in)};
+  bcf1_t* rec{bcf_init()};
+
+  EXPECT_EQ(bcf_hdr_write(out, hdr), 0);
+  while(bcf_read(in, hdr, rec) == 0){
+    EXPECT_EQ(bcf_write(out, hdr, rec), 0);
+  }
+
+  bcf_destroy(rec);
+  bcf_hdr_destroy(hdr);
+  hts_close(in);
+  hts_close(out);
+
+  EXPECT_EQ(bcf_index_build(bcf_path.c_str(), 14), 0);
+  return bcf_path.string();
+}
+
+/* Output of reading every variant of control's input in order on one thread. */
+static std::string sequential_output(const AppControlData& control){
+  std::unique_ptr<BcfReader> bcf{open_input(control)};
+  std::mt19937 rnd_gen{control.rnd_seed};
+  std::string out{};
+  while(bcf->next_variant()){
+    select_variant(*bcf, control, rnd_gen, out);
+  }
+  return out;
+}
+
+TEST_F(StructVarTest, UnindexedInputHasNoChunks){
+  BcfReader bcf{test_data_path.string()};
+
+  EXPECT_FALSE(bcf.load_index());
+  EXPECT_TRUE(make_chunks(bcf).empty());
+}
+
+TEST_F(StructVarTest, ChunksSplitIndexedContigs){
+  BcfReader bcf{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  ASSERT_TRUE(bcf.load_index());
+
+  // Only chr1 has records. Its header length is 248956422.
+  std::vector<VariantChunk> chunks{make_chunks(bcf, 100000000)};
+  ASSERT_EQ(chunks.size(), 3);
+  EXPECT_EQ(chunks[0].contig, "chr1");
+  EXPECT_EQ(chunks[0].beg, 0);
+  EXPECT_EQ(chunks[1].beg, 100000000);
+  EXPECT_EQ(chunks[2].end, HTS_POS_MAX);
+}
+
+TEST_F(StructVarTest, RegionSkipsRecordsStartingBeforeIt){
+  BcfReader bcf{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  ASSERT_TRUE(bcf.load_index());
+
+  // Inversion at 2972402 (0-based) spans this region, but starts before it.
+  bcf.set_region("chr1", 5346000, 5353000);
+  ASSERT_TRUE(bcf.next_variant());
+  EXPECT_EQ(bcf.pos(), 5346987);
+  ASSERT_TRUE(bcf.next_variant());
+  EXPECT_EQ(bcf.pos(), 5352167);
+  EXPECT_FALSE(bcf.next_variant());
+}
+
+TEST_F(StructVarTest, ChunkedOutputMatchesSequential){
+  std::string bcf_path{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  AppControlData control{};
+  control.input_path = bcf_path;
+  control.action = "all";
+  control.emit_id = true;
+
+  std::string expected{sequential_output(control)};
+  ASSERT_FALSE(expected.empty());
+
+  BcfReader bcf{bcf_path};
+  ASSERT_TRUE(bcf.load_index());
+
+  // Small spans put many long variants across chunk boundaries.
+  for(int64_t span : {1000000, 250000, 10000000}){
+    for(int threads : {1, 3, 8}){
+      control.threads = threads;
+      std::ostringstream out{};
+      TsvWriter writer{out};
+      emit_chunks(make_chunks(bcf, span), control, writer);
+      writer.close();
+      EXPECT_EQ(out.str(), expected) << "span " << span << ", threads " << threads;
+    }
+  }
+}
+
+TEST_F(StructVarTest, BoundedBufferOutputMatchesSequential){
+  std::string bcf_path{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  AppControlData control{};
+  control.input_path = bcf_path;
+  control.action = "all";
+  control.emit_id = true;
+
+  std::string expected{sequential_output(control)};
+
+  BcfReader bcf{bcf_path};
+  ASSERT_TRUE(bcf.load_index());
+
+  // A bound smaller than one line hands off every line and keeps workers ahead of the emitter waiting.
+  for(int threads : {1, 3, 8}){
+    control.threads = threads;
+    std::ostringstream out{};
+    TsvWriter writer{out};
+    emit_chunks(make_chunks(bcf, 250000), control, writer, nullptr, 16);
+    writer.close();
+    EXPECT_EQ(out.str(), expected) << "threads " << threads;
+  }
+}
+
+TEST_F(StructVarTest, CounterRngOutputMatchesSequential){
+  std::string bcf_path{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  AppControlData control{};
+  control.input_path = bcf_path;
+  control.action = "rnd";
+  control.rng_mode = "counter";
+  control.num_rnd_samples = 2;
+  control.rnd_seed = 11;
+
+  std::string expected{sequential_output(control)};
+
+  BcfReader bcf{bcf_path};
+  ASSERT_TRUE(bcf.load_index());
+
+  control.threads = 4;
+  std::ostringstream out{};
+  TsvWriter writer{out};
+  emit_chunks(make_chunks(bcf, 250000), control, writer);
+  writer.close();
+  EXPECT_EQ(out.str(), expected);
+}
+
+TEST_F(StructVarTest, ChunkedSampleSubsetMatchesSequential){
+  std::string bcf_path{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  AppControlData control{};
+  control.input_path = bcf_path;
+  control.action = "all";
+  control.emit_id = true;
+
+  std::string all_samples{sequential_output(control)};
+  control.samples = "EXAMPLE09,EXAMPLE02,EXAMPLE05";
+  std::string expected{sequential_output(control)};
+  ASSERT_FALSE(expected.empty());
+  ASSERT_NE(expected, all_samples);
+
+  BcfReader bcf{bcf_path};
+  ASSERT_TRUE(bcf.load_index());
+
+  // Region queries of indexed BCF must subset samples the same as sequential reads.
+  for(int threads : {1, 4}){
+    control.threads = threads;
+    std::ostringstream out{};
+    TsvWriter writer{out};
+    emit_chunks(make_chunks(bcf, 250000), control, writer);
+    writer.close();
+    EXPECT_EQ(out.str(), expected) << "threads " << threads;
+  }
+}
+
+TEST_F(StructVarTest, ChunkedWriteErrorStopsWorkers){
+  std::string bcf_path{indexed_bcf_copy(test_data_path, temp_dir.path("chunks.bcf"))};
+  AppControlData control{};
+  control.input_path = bcf_path;
+  control.action = "all";
+  control.threads = 4;
+
+  BcfReader bcf{bcf_path};
+  ASSERT_TRUE(bcf.load_index());
+
+  // A stream without a buffer fails every write. A nearly full buffer makes the first chunk flush.
+  std::ostream failing{nullptr};
+  TsvWriter writer{failing};
+  writer.buffer().append(TsvWriter::FLUSH_SIZE - 1, 'x');
+  EXPECT_THROW(emit_chunks(make_chunks(bcf, 250000), control, writer), std::runtime_error);
+}
@@ -72,3 +72,86 @@ TEST(OptionParsing, ActionRequired){
   EXPECT_TRUE(parse_success);
   EXPECT_EQ(app_ctl.action, "rnd");
 }
+
+TEST(OptionParsing, RngMode){
+  const char* argv[]{"testing_app", "--rng", "counter"};
+  const int argc{3};
+
+  AppControlData app_ctl{};
+  EXPECT_EQ(app_ctl.rng_mode, "legacy");
+  EXPECT_TRUE(parse_cli_args(argc, argv, app_ctl));
+  EXPECT_EQ(app_ctl.rng_mode, "counter");
+
+  const char* bad_argv[]{"testing_app", "--rng", "dice"};
+  AppControlData bad_ctl{};
+  EXPECT_FALSE(parse_cli_args(argc, bad_argv, bad_ctl));
+}
+
+TEST(Sampling, RanksMatchLegacySample){
+  std::vector<int> idxs{3, 9, 14, 20, 21, 35, 40, 41, 57};
+
+  for(int n : {0, 2, 5, 9, 12}){
+    std::mt19937 sample_gen{123};
+    std::mt19937 rank_gen{123};
+
+    std::vector<int> expected{};
+    std::sample(idxs.begin(), idxs.end(), std::back_inserter(expected), n, sample_gen);
+
+    std::vector<int> sampled{};
+    for(int rank : random_ranks(rank_gen, idxs.size(), n)){
+      sampled.push_back(idxs[rank]);
+    }
+
+    EXPECT_EQ(sampled, expected) << n;
+    EXPECT_EQ(sample_gen(), rank_gen()) << n;
+  }
+}
+
+TEST(OptionParsing, SampleSubset){
+  const char* argv[]{"testing_app", "--samples", "^A,B"};
+  AppControlData app_ctl{};
+  EXPECT_TRUE(parse_cli_args(3, argv, app_ctl));
+  EXPECT_EQ(app_ctl.samples, "^A,B");
+  EXPECT_FALSE(app_ctl.is_samples_file);
+
+  const char* file_argv[]{"testing_app", "--samples-file", "cohort.txt"};
+  AppControlData file_ctl{};
+  EXPECT_TRUE(parse_cli_args(3, file_argv, file_ctl));
+  EXPECT_EQ(file_ctl.samples, "cohort.txt");
+  EXPECT_TRUE(file_ctl.is_samples_file);
+
+  const char* both_argv[]{"testing_app", "--samples", "A", "--samples-file", "cohort.txt"};
+  AppControlData both_ctl{};
+  EXPECT_FALSE(parse_cli_args(5, both_argv, both_ctl));
+}
+
+TEST(OptionParsing, CarrierFormat){
+  const char* argv[]{"testing_app", "all", "--format", "carriers", "--output", "out.hhsc"};
+  AppControlData app_ctl{};
+  EXPECT_TRUE(parse_cli_args(6, argv, app_ctl));
+  EXPECT_EQ(app_ctl.output_format, "carriers");
+
+  const char* rnd_argv[]{"testing_app", "rnd", "--format", "carriers", "--output", "out.hhsc"};
+  AppControlData rnd_ctl{};
+  EXPECT_FALSE(parse_cli_args(6, rnd_argv, rnd_ctl));
+
+  const char* stdout_argv[]{"testing_app", "all", "--format", "carriers"};
+  AppControlData stdout_ctl{};
+  EXPECT_FALSE(parse_cli_args(4, stdout_argv, stdout_ctl));
+}
+
+TEST(OptionParsing, SampleCountStrata){
+  const char* argv[]{"testing_app", "stats", "--count-by-svtype", "--size-bins", "50,1000"};
+  AppControlData app_ctl{};
+  EXPECT_TRUE(parse_cli_args(5, argv, app_ctl));
+  EXPECT_TRUE(app_ctl.count_strata.by_svtype);
+  EXPECT_EQ(app_ctl.count_strata.size_bounds, (std::vector<int64_t>{50, 1000}));
+
+  const char* bad_argv[]{"testing_app", "stats", "--size-bins", "1000,50"};
+  AppControlData bad_ctl{};
+  EXPECT_FALSE(parse_cli_args(4, bad_argv, bad_ctl));
+
+  const char* twice_argv[]{"testing_app", "stats", "--sample-counts", "counts.tsv"};
+  AppControlData twice_ctl{};
+  EXPECT_FALSE(parse_cli_args(4, twice_argv, twice_ctl));
+}
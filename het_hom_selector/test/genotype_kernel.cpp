@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <random>
+#include <vector>
+#include "genotype_kernel.hpp"
+#include "htslib/vcf.h"
+
+/*****************************************************
+ * Each kernel supported by the CPU gives same lists *
+ *****************************************************/
+class GenotypeKernel : public testing::TestWithParam<GtKernel> {
+  protected:
+    void SetUp() override {
+      if(!is_gt_kernel_supported(GetParam())){
+        GTEST_SKIP() << "Kernel not supported by this CPU";
+      }
+    }
+};
+
+TEST_P(GenotypeKernel, DiploidHetHom){
+  std::vector<int32_t> gt_data{
+    bcf_gt_unphased(0), bcf_gt_unphased(0),
+    bcf_gt_unphased(0), bcf_gt_phased(1),
+    bcf_gt_unphased(1), bcf_gt_unphased(1),
+    bcf_gt_missing,     bcf_gt_missing,
+    bcf_gt_unphased(1), bcf_gt_unphased(0),
+    bcf_gt_unphased(0), bcf_gt_missing};
+  std::vector<int> het_idxs{};
+  std::vector<int> hom_idxs{};
+
+  classify_genotypes(gt_data.data(), gt_data.size(), 6, het_idxs, hom_idxs, GetParam());
+
+  EXPECT_THAT(het_idxs, testing::ElementsAre(1, 4));
+  EXPECT_THAT(hom_idxs, testing::ElementsAre(2));
+}
+
+TEST_P(GenotypeKernel, MatchesScalarOnRandomGenotypes){
+  std::mt19937 rng{7};
+  const std::vector<int32_t> allele_vals{
+    bcf_gt_unphased(0), bcf_gt_phased(0), bcf_gt_unphased(1), bcf_gt_phased(1),
+    bcf_gt_unphased(2), bcf_gt_missing, bcf_int32_missing, bcf_int32_vector_end};
+  std::uniform_int_distribution<size_t> val_dist{0, allele_vals.size() - 1};
+
+  // Sample counts that are not multiples of the vector widths exercise the remainder loops.
+  for(int num_samples : {1, 3, 4, 7, 8, 9, 17, 1001}){
+    for(int ploidy : {1, 2, 3, 5}){
+      std::vector<int32_t> gt_data(num_samples * ploidy);
+      for(auto& val : gt_data){ val = allele_vals[val_dist(rng)]; }
+
+      std::vector<int> het_idxs{}, hom_idxs{}, expected_hets{}, expected_homs{};
+      classify_genotypes(gt_data.data(), gt_data.size(), num_samples, het_idxs, hom_idxs, GetParam());
+      classify_genotypes(gt_data.data(), gt_data.size(), num_samples, expected_hets, expected_homs,
+                         GtKernel::SCALAR);
+
+      // Scalar kernel is the reference loop of bcf_gt_allele(val) > 0 per allele.
+      std::vector<int> reference_hets{}, reference_homs{};
+      for(int sample_idx{0}; sample_idx < num_samples; sample_idx++){
+        int alt_count{0};
+        for(int allele_idx{0}; allele_idx < ploidy; allele_idx++){
+          alt_count += bcf_gt_allele(gt_data[sample_idx * ploidy + allele_idx]) > 0;
+        }
+        if(alt_count == 2){ reference_homs.push_back(sample_idx); }
+        if(alt_count == 1){ reference_hets.push_back(sample_idx); }
+      }
+
+      EXPECT_EQ(expected_hets, reference_hets) << num_samples << " samples, ploidy " << ploidy;
+      EXPECT_EQ(expected_homs, reference_homs) << num_samples << " samples, ploidy " << ploidy;
+      EXPECT_EQ(het_idxs, expected_hets) << num_samples << " samples, ploidy " << ploidy;
+      EXPECT_EQ(hom_idxs, expected_homs) << num_samples << " samples, ploidy " << ploidy;
+    }
+  }
+}
+
+TEST_P(GenotypeKernel, AppendsToExistingLists){
+  std::vector<int32_t> gt_data(2 * 16, bcf_gt_unphased(1));
+  std::vector<int> het_idxs{-1};
+  std::vector<int> hom_idxs{-1};
+
+  classify_genotypes(gt_data.data(), gt_data.size(), 16, het_idxs, hom_idxs, GetParam());
+
+  EXPECT_EQ(het_idxs.size(), 1);
+  ASSERT_EQ(hom_idxs.size(), 17);
+  EXPECT_EQ(hom_idxs.front(), -1);
+  EXPECT_EQ(hom_idxs.back(), 15);
+}
+
+TEST_P(GenotypeKernel, CountAndLocateMatchClassify){
+  std::mt19937 rng{3};
+  std::uniform_int_distribution<int> allele_dist{0, 9};
+
+  for(int num_samples : {5, 16, 1003}){
+    for(int ploidy : {1, 2, 3}){
+      // Mostly REF alleles, some ALT, a few missing.
+      std::vector<int32_t> gt_data(num_samples * ploidy);
+      for(auto& val : gt_data){
+        int draw{allele_dist(rng)};
+        val = draw == 0 ? bcf_gt_missing : bcf_gt_unphased(draw < 4 ? 1 : 0);
+      }
+
+      std::vector<int> het_idxs{}, hom_idxs{};
+      classify_genotypes(gt_data.data(), gt_data.size(), num_samples, het_idxs, hom_idxs, GtKernel::SCALAR);
+
+      int n_hets{-1}, n_homs{-1};
+      count_genotypes(gt_data.data(), gt_data.size(), num_samples, n_hets, n_homs, GetParam());
+      EXPECT_EQ(n_hets, het_idxs.size());
+      EXPECT_EQ(n_homs, hom_idxs.size());
+
+      std::vector<int> het_ranks{}, hom_ranks{};
+      for(int rank{1}; rank < n_hets; rank += 3){ het_ranks.push_back(rank); }
+      if(n_homs > 0){ hom_ranks = {0, n_homs - 1}; }
+      if(n_homs == 1){ hom_ranks = {0}; }
+
+      std::vector<int> located_hets{}, located_homs{};
+      locate_genotypes(gt_data.data(), gt_data.size(), num_samples, het_ranks, hom_ranks,
+                       located_hets, located_homs, GetParam());
+      ASSERT_EQ(located_hets.size(), het_ranks.size());
+      ASSERT_EQ(located_homs.size(), hom_ranks.size());
+      for(size_t i{0}; i < het_ranks.size(); i++){
+        EXPECT_EQ(located_hets[i], het_idxs[het_ranks[i]]);
+      }
+      for(size_t i{0}; i < hom_ranks.size(); i++){
+        EXPECT_EQ(located_homs[i], hom_idxs[hom_ranks[i]]);
+      }
+    }
+  }
+}
+
+TEST_P(GenotypeKernel, TallyMatchesReference){
+  std::mt19937 rng{11};
+  const std::vector<int32_t> allele_vals{
+    bcf_gt_unphased(0), bcf_gt_phased(0), bcf_gt_unphased(1), bcf_gt_phased(2),
+    bcf_gt_missing, bcf_gt_missing | 1, bcf_int32_missing, bcf_int32_vector_end};
+  std::uniform_int_distribution<size_t> val_dist{0, allele_vals.size() - 1};
+
+  for(int num_samples : {1, 4, 9, 17, 1001}){
+    for(int ploidy : {1, 2, 3}){
+      std::vector<int32_t> gt_data(num_samples * ploidy);
+      for(auto& val : gt_data){ val = allele_vals[val_dist(rng)]; }
+
+      // Counts start from earlier variants and accumulate.
+      std::vector<uint32_t> hets(num_samples, 1), homs(num_samples, 2), missing(num_samples, 3);
+      int n_hets{-1}, n_homs{-1};
+      std::vector<int> het_idxs{}, hom_idxs{};
+      tally_genotypes(gt_data.data(), gt_data.size(), num_samples, hets.data(), homs.data(), missing.data(),
+                      n_hets, n_homs, &het_idxs, &hom_idxs, GetParam());
+
+      // Same pass counts and classifies as the other kernels do.
+      std::vector<int> expected_hets{}, expected_homs{};
+      classify_genotypes(gt_data.data(), gt_data.size(), num_samples, expected_hets, expected_homs,
+                         GtKernel::SCALAR);
+      EXPECT_EQ(het_idxs, expected_hets) << num_samples << " samples, ploidy " << ploidy;
+      EXPECT_EQ(hom_idxs, expected_homs) << num_samples << " samples, ploidy " << ploidy;
+      EXPECT_EQ(n_hets, expected_hets.size()) << num_samples << " samples, ploidy " << ploidy;
+      EXPECT_EQ(n_homs, expected_homs.size()) << num_samples << " samples, ploidy " << ploidy;
+
+      for(int sample_idx{0}; sample_idx < num_samples; sample_idx++){
+        int alt_count{0};
+        bool has_missing{false};
+        for(int allele_idx{0}; allele_idx < ploidy; allele_idx++){
+          int32_t val{gt_data[sample_idx * ploidy + allele_idx]};
+          alt_count += bcf_gt_allele(val) > 0;
+          has_missing |= val != bcf_int32_vector_end && (val == bcf_int32_missing || bcf_gt_is_missing(val));
+        }
+        EXPECT_EQ(hets[sample_idx], 1 + (alt_count == 1)) << sample_idx << ", ploidy " << ploidy;
+        EXPECT_EQ(homs[sample_idx], 2 + (alt_count == 2)) << sample_idx << ", ploidy " << ploidy;
+        EXPECT_EQ(missing[sample_idx], 3 + (alt_count == 0 && has_missing)) << sample_idx << ", ploidy " << ploidy;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, GenotypeKernel,
+    testing::Values(GtKernel::SCALAR, GtKernel::SSE4, GtKernel::AVX2));
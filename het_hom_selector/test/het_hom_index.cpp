@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "structvar_fixture.hpp"
+#include "app_control_data.hpp"
+#include "app.hpp"
+#include "het_hom_index.hpp"
+
+TEST(HetHomIndex, RoundTripListsAndBitsets){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("round_trip.hhi")};
+  const int n_samples{3000};
+
+  // Few carriers are stored as lists and many as bitsets.
+  std::vector<int> sparse{5, 64, 2999};
+  std::vector<int> dense{};
+  std::mt19937 gen{3};
+  for(int i{0}; i < n_samples; i++){
+    if(gen() % 3 == 0){ dense.push_back(i); }
+  }
+
+  {
+    HetHomIndexWriter writer{path.string(), numbered_samples(n_samples)};
+    writer.add("chr1", 100, "SV1", "A", "<DEL>", sparse, dense);
+    writer.add("chr2", 7, ".", "C", "<DUP>", {}, {});
+    writer.close();
+  }
+  EXPECT_TRUE(is_het_hom_index(path.string()));
+
+  HetHomIndexReader reader{path.string()};
+  EXPECT_EQ(reader.n_variants(), 2);
+  EXPECT_EQ(reader.n_samples(), n_samples);
+  EXPECT_FALSE(reader.is_subset());
+  EXPECT_EQ(reader.sample_names()[2999], "S2999");
+
+  ASSERT_TRUE(reader.next_variant());
+  EXPECT_EQ(reader.chr(), "chr1");
+  EXPECT_EQ(reader.pos(), 100);
+  EXPECT_EQ(reader.id(), "SV1");
+  EXPECT_EQ(reader.ref(), "A");
+  EXPECT_EQ(reader.alt(), "<DEL>");
+  EXPECT_EQ(reader.n_hets(), sparse.size());
+  EXPECT_EQ(reader.n_homs(), dense.size());
+  EXPECT_EQ(reader.het_idxs(), sparse);
+  EXPECT_EQ(reader.hom_idxs(), dense);
+
+  ASSERT_TRUE(reader.next_variant());
+  EXPECT_EQ(reader.chr(), "chr2");
+  EXPECT_EQ(reader.n_hets(), 0);
+  EXPECT_TRUE(reader.hom_idxs().empty());
+  EXPECT_FALSE(reader.next_variant());
+}
+
+TEST(HetHomIndex, CarriersAtRanks){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("ranks.hhi")};
+  const int n_samples{5000};
+
+  std::vector<int> dense{};
+  std::vector<int> sparse{};
+  std::mt19937 gen{7};
+  for(int i{0}; i < n_samples; i++){
+    if(gen() % 2 == 0){ dense.push_back(i); }
+    if(gen() % 500 == 0){ sparse.push_back(i); }
+  }
+  {
+    HetHomIndexWriter writer{path.string(), numbered_samples(n_samples)};
+    writer.add("chr1", 1, ".", "A", "T", dense, sparse);
+  }
+
+  HetHomIndexReader reader{path.string()};
+  reader.set_collect_carriers(false);
+  ASSERT_TRUE(reader.next_variant());
+  EXPECT_TRUE(reader.het_idxs().empty());
+
+  // Every rank, including the first and last of each rank directory entry.
+  std::vector<int> het_ranks(dense.size());
+  std::iota(het_ranks.begin(), het_ranks.end(), 0);
+  std::vector<int> hom_ranks(sparse.size());
+  std::iota(hom_ranks.begin(), hom_ranks.end(), 0);
+
+  std::vector<int> het_out{};
+  std::vector<int> hom_out{};
+  reader.carriers_at(het_ranks, hom_ranks, het_out, hom_out);
+  EXPECT_EQ(het_out, dense);
+  EXPECT_EQ(hom_out, sparse);
+}
+
+TEST(HetHomIndex, Seek){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("seek.hhi")};
+  {
+    HetHomIndexWriter writer{path.string(), numbered_samples(10)};
+    for(int i{0}; i < 20; i++){
+      writer.add("chr1", i, "V" + std::to_string(i), "A", "T", {i % 10}, {});
+    }
+  }
+
+  HetHomIndexReader reader{path.string()};
+  reader.seek(13);
+  ASSERT_TRUE(reader.next_variant());
+  EXPECT_EQ(reader.id(), "V13");
+  EXPECT_THAT(reader.het_idxs(), testing::ElementsAre(3));
+
+  reader.seek(20);
+  EXPECT_FALSE(reader.next_variant());
+}
+
+/* Overwrite a 32-bit field of the last site of the index at path. Sites are 64 bytes at the end of the file. */
+static void patch_last_site(const fs::path& path, const size_t field_offset, const uint32_t value){
+  std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+  file.seekp(fs::file_size(path) - 64 + field_offset);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Field offsets within a site.
+static constexpr size_t SITE_CONTIG{16};
+static constexpr size_t SITE_HET_COUNT{40};
+
+TEST(HetHomIndex, RejectsSiteWithUnknownContig){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("bad_contig.hhi")};
+  {
+    HetHomIndexWriter writer{path.string(), numbered_samples(10)};
+    writer.add("chr1", 1, ".", "A", "T", {1}, {});
+  }
+  patch_last_site(path, SITE_CONTIG, 7);
+
+  HetHomIndexReader reader{path.string()};
+  EXPECT_THROW(reader.next_variant(), std::runtime_error);
+}
+
+TEST(HetHomIndex, RejectsCountBeyondBitset){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("bad_count.hhi")};
+  const int n_samples{5000};
+  std::vector<int> dense(n_samples / 2);
+  std::iota(dense.begin(), dense.end(), 0);
+  {
+    HetHomIndexWriter writer{path.string(), numbered_samples(n_samples)};
+    writer.add("chr1", 1, ".", "A", "T", dense, {});
+  }
+  // One more carrier than the bitset holds.
+  patch_last_site(path, SITE_HET_COUNT, dense.size() + 1);
+
+  HetHomIndexReader reader{path.string()};
+  EXPECT_THROW(reader.next_variant(), std::runtime_error);
+
+  reader.seek(0);
+  reader.set_collect_carriers(false);
+  ASSERT_TRUE(reader.next_variant());
+  std::vector<int> het_out{};
+  std::vector<int> hom_out{};
+  EXPECT_THROW(reader.carriers_at({static_cast<int>(dense.size())}, {}, het_out, hom_out), std::runtime_error);
+  // Ranks at or past the count are rejected before the bitset is read.
+  EXPECT_THROW(reader.carriers_at({static_cast<int>(dense.size()) + 1}, {}, het_out, hom_out),
+               std::runtime_error);
+}
+
+TEST(HetHomIndex, RejectsOtherFiles){
+  TestTempDir temp_dir{};
+  fs::path path{temp_dir.path("not_index.txt")};
+  {
+    std::ofstream out{path};
+    out << "#CHROM\tPOS\tREF\tALT\tHOM\tHET\n";
+  }
+  EXPECT_FALSE(is_het_hom_index(path.string()));
+  EXPECT_THROW(HetHomIndexReader{path.string()}, std::runtime_error);
+}
+
+/* Output of run with control, read back from out_path. */
+static std::string run_output(AppControlData control, const fs::path& out_path){
+  control.output_path = out_path.string();
+  EXPECT_TRUE(run(control));
+  return read_text(out_path);
+}
+
+TEST_F(StructVarTest, IndexOutputMatchesBcf){
+  fs::path index_path{temp_dir.path("structvar.hhi")};
+
+  AppControlData build{};
+  build.action = "index";
+  build.input_path = test_data_path.string();
+  build.output_path = index_path.string();
+  ASSERT_TRUE(run(build));
+
+  for(std::string action : {"all", "rnd"}){
+    for(std::string rng_mode : {"legacy", "counter"}){
+      AppControlData control{};
+      control.action = action;
+      control.rng_mode = rng_mode;
+      control.rnd_seed = 42;
+      control.num_rnd_samples = 2;
+      control.emit_id = true;
+
+      control.input_path = test_data_path.string();
+      std::string expected{run_output(control, temp_dir.path("run.tsv"))};
+      control.input_path = index_path.string();
+      EXPECT_EQ(run_output(control, temp_dir.path("run.tsv")), expected) << action << " " << rng_mode;
+    }
+  }
+}
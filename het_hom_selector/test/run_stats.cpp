@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include "structvar_fixture.hpp"
+#include "app_control_data.hpp"
+#include "app.hpp"
+#include "run_stats.hpp"
+
+/* Seconds of a stage in stats JSON, or -1 if absent. */
+static double stage_wall_s(const std::string& json, const std::string& stage){
+  const std::string key{"\"" + stage + "\": {\"wall_s\": "};
+  size_t key_pos{json.find(key)};
+  if(key_pos == std::string::npos){ return -1; }
+  return std::stod(json.substr(key_pos + key.size()));
+}
+
+TEST_F(StructVarTest, RunWritesStats){
+  fs::path out_path{temp_dir.path("stats_out.tsv")};
+  fs::path stats_path{temp_dir.path("run_stats.json")};
+
+  AppControlData control{};
+  control.input_path = test_data_path.string();
+  control.action = "all";
+  control.output_path = out_path.string();
+  control.stats_path = stats_path.string();
+  control.filter.pass_only = true;
+  ASSERT_TRUE(run(control));
+
+  std::string json{read_text(stats_path)};
+  EXPECT_NE(json.find("\"tool\": \"het_hom_sel\""), std::string::npos);
+  EXPECT_NE(json.find("\"records\": 23"), std::string::npos);
+  EXPECT_NE(json.find("\"filtered\": "), std::string::npos);
+  EXPECT_GT(stage_wall_s(json, "decode"), 0);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <htslib/vcf.h>
+#include "structvar_fixture.hpp"
+#include "app_control_data.hpp"
+#include "app.hpp"
+#include "bcf_reader.hpp"
+#include "sample_counts.hpp"
+#include "tsv_writer.hpp"
+
+// Genotypes of three diploid samples: het, hom alt, missing.
+static const std::vector<int32_t> het_hom_missing{
+  bcf_gt_unphased(0), bcf_gt_unphased(1),
+  bcf_gt_unphased(1), bcf_gt_unphased(1),
+  bcf_gt_missing, bcf_gt_missing};
+
+static std::string write_counts(const SampleCounts& counts){
+  std::ostringstream text{};
+  {
+    TsvWriter out{text};
+    counts.write(SampleNameTable{std::vector<std::string>{"A", "B", "C"}}, out);
+  }
+  return text.str();
+}
+
+TEST(SampleCounts, Unstratified){
+  SampleCounts counts{3};
+  counts.add(het_hom_missing.data(), het_hom_missing.size(), "DEL", 100);
+  counts.add(het_hom_missing.data(), het_hom_missing.size(), "DUP", 5000);
+
+  EXPECT_EQ(write_counts(counts),
+            "#SAMPLE\tSVTYPE\tSIZE\tHET\tHOM\tMISSING\n"
+            "A\tALL\tALL\t2\t0\t0\n"
+            "B\tALL\tALL\t0\t2\t0\n"
+            "C\tALL\tALL\t0\t0\t2\n");
+}
+
+TEST(SampleCounts, StrataAndMerge){
+  CountStrata strata{true, parse_size_bounds("50,1000")};
+  SampleCounts counts{3, strata};
+  SampleCounts other{3, strata};
+  counts.add(het_hom_missing.data(), het_hom_missing.size(), "DEL", 100);
+  other.add(het_hom_missing.data(), het_hom_missing.size(), "DEL", 999);
+  other.add(het_hom_missing.data(), het_hom_missing.size(), "DEL", 1000);
+  other.add(het_hom_missing.data(), het_hom_missing.size(), "DUP", 10);
+  counts.merge(other);
+
+  EXPECT_EQ(write_counts(counts),
+            "#SAMPLE\tSVTYPE\tSIZE\tHET\tHOM\tMISSING\n"
+            "A\tDEL\t[50,1000)\t2\t0\t0\n"
+            "B\tDEL\t[50,1000)\t0\t2\t0\n"
+            "C\tDEL\t[50,1000)\t0\t0\t2\n"
+            "A\tDEL\t[1000,inf)\t1\t0\t0\n"
+            "B\tDEL\t[1000,inf)\t0\t1\t0\n"
+            "C\tDEL\t[1000,inf)\t0\t0\t1\n"
+            "A\tDUP\t[0,50)\t1\t0\t0\n"
+            "B\tDUP\t[0,50)\t0\t1\t0\n"
+            "C\tDUP\t[0,50)\t0\t0\t1\n");
+}
+
+TEST(SampleCounts, SizeBoundsMustAscend){
+  EXPECT_EQ(parse_size_bounds("50,1000,100000"), (std::vector<int64_t>{50, 1000, 100000}));
+  EXPECT_THROW(parse_size_bounds("1000,50"), std::runtime_error);
+  EXPECT_THROW(parse_size_bounds("50,x"), std::runtime_error);
+  EXPECT_THROW(parse_size_bounds("0"), std::runtime_error);
+}
+
+TEST_F(StructVarTest, CountsMatchAcrossActions){
+  fs::path stats_path{temp_dir.path("stats.tsv")};
+  fs::path all_path{temp_dir.path("stats_all.tsv")};
+  fs::path counts_path{temp_dir.path("stats_counts.tsv")};
+
+  AppControlData stats{};
+  stats.input_path = test_data_path.string();
+  stats.action = "stats";
+  stats.output_path = stats_path.string();
+  ASSERT_TRUE(run(stats));
+
+  // One pass of action all also writes the counts.
+  AppControlData all{};
+  all.input_path = test_data_path.string();
+  all.action = "all";
+  all.output_path = all_path.string();
+  all.sample_counts_path = counts_path.string();
+  ASSERT_TRUE(run(all));
+
+  std::vector<std::string> stats_lines{read_lines(stats_path)};
+  ASSERT_EQ(stats_lines.size(), 11);
+  EXPECT_THAT(stats_lines[1], testing::StartsWith("EXAMPLE01\tALL\tALL\t"));
+  EXPECT_EQ(read_lines(counts_path), stats_lines);
+}
+
+/* Counts of reading every variant at path into strata. */
+static std::string read_counts(const std::string& path, const CountStrata& strata){
+  BcfReader reader{path};
+  SampleCounts counts{reader.n_samples(), strata};
+  reader.set_sample_counts(&counts);
+  while(reader.next_variant()){}
+
+  std::ostringstream text{};
+  {
+    TsvWriter out{text};
+    counts.write(reader.sample_names(), out);
+  }
+  return text.str();
+}
+
+TEST_F(StructVarTest, ReaderStrataComeFromInfo){
+  std::string by_type{read_counts(test_data_path.string(), CountStrata{true, {}})};
+  EXPECT_THAT(by_type, testing::HasSubstr("EXAMPLE01\tDEL\tALL\t"));
+  EXPECT_THAT(by_type, testing::HasSubstr("EXAMPLE01\tINV\tALL\t"));
+  EXPECT_THAT(by_type, testing::Not(testing::HasSubstr("\tNA\t")));
+
+  std::string by_size{read_counts(test_data_path.string(), CountStrata{false, parse_size_bounds("10000,6000000")})};
+  EXPECT_THAT(by_size, testing::HasSubstr("EXAMPLE01\tALL\t[0,10000)\t"));
+  EXPECT_THAT(by_size, testing::HasSubstr("EXAMPLE01\tALL\t[6000000,inf)\t"));
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include "structvar_fixture.hpp"
+#include "app.hpp"
+#include "bcf_reader.hpp"
+#include "tsv_writer.hpp"
+#include "htslib/bgzf.h"
+
+TEST(TsvWriter, BuffersUntilFlush){
+  std::ostringstream out{};
+  TsvWriter writer{out};
+
+  writer.write("a\tb\n");
+  writer.buffer().append("c\td\n");
+  writer.flush_if_full();
+  EXPECT_EQ(out.str(), "");
+
+  writer.close();
+  EXPECT_EQ(out.str(), "a\tb\nc\td\n");
+}
+
+TEST(TsvWriter, FlushesLargeOutput){
+  std::ostringstream out{};
+  TsvWriter writer{out};
+
+  std::string line(1000, 'x');
+  line.push_back('\n');
+  size_t n_lines{TsvWriter::FLUSH_SIZE / line.size() + 1};
+  for(size_t i{0}; i < n_lines; i++){
+    writer.write(line);
+  }
+  EXPECT_GE(out.str().size(), TsvWriter::FLUSH_SIZE);
+
+  writer.close();
+  EXPECT_EQ(out.str().size(), n_lines * line.size());
+}
+
+TEST(TsvWriter, WritesFile){
+  TestTempDir temp_dir{};
+  fs::path out_path{temp_dir.path("writer.tsv")};
+  {
+    TsvWriter writer{out_path.string()};
+    writer.write("chr1\t1\n");
+  }
+
+  EXPECT_EQ(read_text(out_path), "chr1\t1\n");
+}
+
+TEST(TsvWriter, WritesBgzf){
+  TestTempDir temp_dir{};
+  fs::path out_path{temp_dir.path("writer.tsv.gz")};
+  std::string expected{};
+  for(int i{0}; i < 100000; i++){
+    expected.append("chr1\t").append(std::to_string(i)).append("\tEXAMPLE01,EXAMPLE02\n");
+  }
+
+  TsvWriter writer{out_path.string(), true, 3};
+  writer.write(expected);
+  writer.close();
+
+  BGZF* in{bgzf_open(out_path.c_str(), "r")};
+  ASSERT_NE(in, nullptr);
+  std::string text(expected.size() + 1, '\0');
+  ssize_t n_read{bgzf_read(in, text.data(), text.size())};
+  bgzf_close(in);
+
+  ASSERT_EQ(n_read, expected.size());
+  text.resize(n_read);
+  EXPECT_EQ(text, expected);
+}
+
+TEST(TsvWriter, UnwritablePathThrows){
+  EXPECT_THROW(TsvWriter{"/nonexistent_dir/out.tsv"}, std::runtime_error);
+}
+
+TEST_F(StructVarTest, SampleNameTable){
+  BcfReader reader{test_data_path.string()};
+  const SampleNameTable& names{reader.sample_names()};
+
+  ASSERT_EQ(names.size(), 10);
+  EXPECT_EQ(names[0], "EXAMPLE01");
+  EXPECT_EQ(names[9], "EXAMPLE10");
+
+  reader.set_samples("EXAMPLE03,EXAMPLE07", false);
+  ASSERT_EQ(reader.sample_names().size(), 2);
+  EXPECT_EQ(reader.sample_names()[1], "EXAMPLE07");
+}
+
+TEST_F(StructVarTest, EmitSelection){
+  BcfReader reader{test_data_path.string()};
+  ASSERT_TRUE(reader.next_variant());
+
+  std::string out{};
+  emit_selection(reader, reader.het_idxs(), reader.hom_idxs(), false, out);
+  EXPECT_EQ(out, "chr1\t2972402\tC\t<INV>\tEXAMPLE01\tEXAMPLE02,EXAMPLE03\n");
+
+  out.clear();
+  emit_selection(reader, {}, {}, true, out);
+  EXPECT_EQ(out, "chr1\t2972402\tINV_1:2972403-10562308\tC\t<INV>\t\t\n");
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "structvar_fixture.hpp"
+#include "bcf_reader.hpp"
+#include "variant_filter.hpp"
+
+/* Count variants of test data passing filter. */
+static int count_passing(const std::string& path, const VariantFilter& filter, int64_t& n_filtered){
+  BcfReader reader{path};
+  reader.set_filter(filter);
+
+  int n_variants{0};
+  while(reader.next_variant()){ n_variants++; }
+  n_filtered = reader.n_filtered();
+  return n_variants;
+}
+
+TEST(SiteRegions, Parse){
+  std::vector<SiteRegion> regions{parse_site_regions("chr1:100-200,chr2,chrUn_KI270302v1:5")};
+
+  ASSERT_EQ(regions.size(), 3);
+  EXPECT_EQ(regions[0].contig, "chr1");
+  EXPECT_EQ(regions[0].beg, 99);
+  EXPECT_EQ(regions[0].end, 200);
+  EXPECT_EQ(regions[1].contig, "chr2");
+  EXPECT_EQ(regions[1].beg, 0);
+  EXPECT_EQ(regions[2].beg, 4);
+  EXPECT_EQ(regions[2].end, 5);
+
+  EXPECT_THROW(parse_site_regions("chr1:abc"), std::runtime_error);
+  EXPECT_THROW(parse_site_regions("chr1:200-100"), std::runtime_error);
+  EXPECT_THROW(parse_site_regions(":1-5"), std::runtime_error);
+}
+
+TEST(SiteRegions, DefaultFilterInactive){
+  VariantFilter filter{};
+  EXPECT_FALSE(filter.is_active());
+
+  filter.pass_only = true;
+  EXPECT_TRUE(filter.is_active());
+}
+
+TEST_F(StructVarTest, FilterSiteFields){
+  int64_t n_filtered{0};
+  VariantFilter filter{};
+
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 23);
+  EXPECT_EQ(n_filtered, 0);
+
+  filter.pass_only = true;
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 11);
+  EXPECT_EQ(n_filtered, 12);
+
+  filter.sv_types = {"DEL"};
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 3);
+
+  filter = VariantFilter{};
+  filter.min_svlen = 100000;
+  filter.max_svlen = 1000000;
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 3);
+
+  filter = VariantFilter{};
+  filter.min_ac = 2;
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 5);
+
+  filter = VariantFilter{};
+  filter.min_af = 0.1;
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 7);
+
+  filter = VariantFilter{};
+  filter.regions = parse_site_regions("chr1:5000000-6000000,chr2");
+  EXPECT_EQ(count_passing(test_data_path.string(), filter, n_filtered), 2);
+}
+
+TEST_F(StructVarTest, FilteredVariantsKeepGenotypes){
+  BcfReader reader{test_data_path.string()};
+  VariantFilter filter{};
+  filter.regions = parse_site_regions("chr1:2972403,chr1:5352168");
+  reader.set_filter(filter);
+
+  // First and third variants of test data. The second, skipped without decoding, has no carriers.
+  ASSERT_TRUE(reader.next_variant());
+  EXPECT_EQ(reader.pos(), 2972402);
+  EXPECT_THAT(reader.het_idxs(), testing::ElementsAre(1, 2));
+  EXPECT_THAT(reader.hom_idxs(), testing::ElementsAre(0));
+
+  ASSERT_TRUE(reader.next_variant());
+  EXPECT_EQ(reader.pos(), 5352167);
+  EXPECT_THAT(reader.het_idxs(), testing::ElementsAre(5, 6, 7, 8, 9));
+  EXPECT_THAT(reader.hom_idxs(), testing::ElementsAre(3, 4));
+  EXPECT_EQ(reader.n_filtered(), 1);
+
+  EXPECT_FALSE(reader.next_variant());
+}
+
+TEST(VariantFilterTags, MissingTagIsError){
+  TestTempDir temp_dir{};
+  fs::path vcf_path{temp_dir.path("no_ac.vcf")};
+  std::ofstream{vcf_path}
+    << "##fileformat=VCFv4.2\n"
+    << "##contig=<ID=chr1,length=1000>\n"
+    << "##INFO=<ID=AC,Number=A,Type=Integer,Description=\"Allele count\">\n"
+    << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+    << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tS1\n"
+    << "chr1\t10\tv1\tA\tT\t.\tPASS\tAC=1\tGT\t0/1\n"
+    << "chr1\t20\tv2\tA\tT\t.\tPASS\t.\tGT\t0/1\n";
+
+  BcfReader reader{vcf_path.string()};
+  VariantFilter filter{};
+  filter.min_ac = 1;
+  reader.set_filter(filter);
+
+  EXPECT_TRUE(reader.next_variant());
+  EXPECT_THROW(reader.next_variant(), std::runtime_error);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <algorithm>
+#include <vector>
+#include "variant_rng.hpp"
+
+TEST(VariantRng, PhiloxKnownAnswers){
+  // Known answer tests of the Random123 reference implementation.
+  EXPECT_THAT(VariantRng::philox({0, 0, 0, 0}, {0, 0}),
+              testing::ElementsAre(0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8));
+  EXPECT_THAT(VariantRng::philox({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+              testing::ElementsAre(0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd));
+  EXPECT_THAT(VariantRng::philox({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+              testing::ElementsAre(0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1));
+}
+
+TEST(VariantRng, StreamDependsOnlyOnKey){
+  VariantRng first{42, "chr1", 1000, "A", "<DEL>", VariantRng::HET_STREAM};
+  VariantRng again{42, "chr1", 1000, "A", "<DEL>", VariantRng::HET_STREAM};
+  VariantRng hom_stream{42, "chr1", 1000, "A", "<DEL>", VariantRng::HOM_STREAM};
+  VariantRng other_pos{42, "chr1", 1001, "A", "<DEL>", VariantRng::HET_STREAM};
+  VariantRng other_seed{43, "chr1", 1000, "A", "<DEL>", VariantRng::HET_STREAM};
+
+  std::vector<uint32_t> draws(10), again_draws(10), hom_draws(10), pos_draws(10), seed_draws(10);
+  std::generate(draws.begin(), draws.end(), first);
+  std::generate(again_draws.begin(), again_draws.end(), again);
+  std::generate(hom_draws.begin(), hom_draws.end(), hom_stream);
+  std::generate(pos_draws.begin(), pos_draws.end(), other_pos);
+  std::generate(seed_draws.begin(), seed_draws.end(), other_seed);
+
+  EXPECT_EQ(draws, again_draws);
+  EXPECT_NE(draws, hom_draws);
+  EXPECT_NE(draws, pos_draws);
+  EXPECT_NE(draws, seed_draws);
+}
+
+TEST(VariantRng, UniformBelowInRange){
+  VariantRng rng{7, "chr2", 5, "C", "T", VariantRng::HET_STREAM};
+  std::vector<int> counts(3, 0);
+
+  for(int i{0}; i < 3000; i++){
+    uint32_t val{rng.uniform_below(3)};
+    ASSERT_LT(val, 3);
+    counts[val]++;
+  }
+  for(int count : counts){
+    EXPECT_GT(count, 800);
+  }
+}
+
+TEST(VariantRng, CounterPositions){
+  VariantRng rng{1, "chr1", 10, "G", "<INV>", VariantRng::HOM_STREAM};
+  std::vector<int> positions{counter_positions(50, 5, rng)};
+  ASSERT_EQ(positions.size(), 5);
+  EXPECT_TRUE(std::is_sorted(positions.begin(), positions.end()));
+  EXPECT_EQ(std::adjacent_find(positions.begin(), positions.end()), positions.end());
+  EXPECT_GE(positions.front(), 0);
+  EXPECT_LT(positions.back(), 50);
+
+  VariantRng same{1, "chr1", 10, "G", "<INV>", VariantRng::HOM_STREAM};
+  EXPECT_EQ(counter_positions(50, 5, same), positions);
+
+  // Fewer candidates than requested keeps all of them.
+  EXPECT_EQ(counter_positions(2, 5, rng), std::vector<int>({0, 1}));
+  EXPECT_TRUE(counter_positions(50, 0, rng).empty());
+}